@@ -0,0 +1,126 @@
+#pragma once
+
+#include "pch.h"
+
+#include <unordered_map>
+
+#include "iir/structure.h"
+#include "iir/regions.h"
+
+namespace IIR {
+	/// What an 8-byte slot looked like across every sample taken so far.
+	enum class SlotKind {
+		unknown, // Not enough samples, or nothing fits consistently.
+		padding, // Always zero.
+		vtable, // Points at a table of code pointers inside a module.
+		pointer,
+		f64,
+		text, // Printable ASCII.
+		halves // Classified as two separate 4-byte values, see SlotGuess::halves.
+	};
+
+	enum class HalfKind {
+		unknown,
+		zero,
+		boolean, // Only ever 0 or 1.
+		i32, // Small integers.
+		f32
+	};
+
+	struct SlotGuess {
+		size_t offset = 0;
+		SlotKind kind = SlotKind::unknown;
+		HalfKind halves[2] = { HalfKind::unknown, HalfKind::unknown };
+		bool changes = false; // The value was seen to change between samples.
+	};
+
+	/// <summary>
+	/// A layout for the analyzed class built from the slot guesses.
+	/// Only slots still covered entirely by untyped fields are touched, everything the user typed is kept as is.
+	/// </summary>
+	struct LayoutProposal {
+		size_t classIndex = 0;
+		FieldList basis; // The layout the proposal was built from, it only applies while that is still current.
+		size_t samples = 0;
+		std::vector<SlotGuess> slots;
+		std::vector<Field> fields;
+		size_t changedSlots = 0; // How many slots the proposal would retype.
+	};
+
+	/// <summary>
+	/// Samples the object being viewed on a background thread and guesses the type of each 8-byte slot from how its
+	/// value behaves over time. Statistics are updated incrementally with every sample, so the history costs a few
+	/// counters per slot rather than a copy of every snapshot. Pointer checks go through the RegionMap.
+	/// </summary>
+	class FieldAnalyzer {
+	public:
+		static FieldAnalyzer& GetInstance();
+
+		void Init();
+
+		/// <summary>
+		/// Tells the analyzer what to look at. Call every frame while the results are wanted, sampling pauses shortly after the calls stop.
+		/// The history is thrown away when the object or class changes.
+		/// </summary>
+		void SetTarget(uintptr_t base, size_t classIndex, FieldList layout);
+
+		/// Throws away the history and starts over.
+		void Reset() { resetRequested = true; }
+
+		/// The latest proposal, or nullptr if there is none yet. Safe to call from any thread.
+		std::shared_ptr<const LayoutProposal> GetProposal() const { return proposal.load(); }
+
+	private:
+		FieldAnalyzer();
+		~FieldAnalyzer();
+		FieldAnalyzer(const FieldAnalyzer&) = delete;
+		FieldAnalyzer& operator=(const FieldAnalyzer&) = delete;
+
+		// Samples needed before a slot is classified at all
+		static constexpr uint32_t minSamples = 8;
+		static constexpr auto sampleInterval = std::chrono::milliseconds(25);
+		// Sampling stops when SetTarget has not been called for this long
+		static constexpr auto idleTimeout = std::chrono::milliseconds(500);
+
+		struct SlotStats {
+			uint32_t samples = 0;
+			uint32_t zero = 0;
+			uint32_t pointers = 0;
+			uint32_t vtables = 0;
+			uint32_t doubles = 0;
+			uint32_t text = 0;
+			uint32_t halfZero[2] = {};
+			uint32_t halfBool[2] = {};
+			uint32_t halfInt[2] = {};
+			uint32_t halfFloat[2] = {};
+			uint64_t last = 0;
+			bool changes = false;
+		};
+
+		struct Target {
+			uintptr_t base = 0;
+			size_t classIndex = 0;
+			FieldList layout;
+			std::chrono::steady_clock::time_point lastSeen;
+		};
+
+		void UpdateFunction();
+		void Sample(HANDLE handle, const RegionSnapshot& regions, const std::vector<uint8_t>& bytes);
+		bool IsVtable(HANDLE handle, const RegionSnapshot& regions, uintptr_t value);
+		std::shared_ptr<LayoutProposal> Propose(const Target& target) const;
+		static SlotGuess Classify(const SlotStats& stats, size_t offset);
+
+		std::mutex targetMtx;
+		Target target;
+
+		// Analyzer thread only
+		std::vector<SlotStats> stats;
+		std::unordered_map<uintptr_t, bool> vtableCache; // Whether a value was found to point at a vtable.
+
+		std::atomic<std::shared_ptr<const LayoutProposal>> proposal;
+		std::atomic<bool> resetRequested = false;
+
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+	};
+}
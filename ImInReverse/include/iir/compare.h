@@ -0,0 +1,49 @@
+#pragma once
+
+#include "pch.h"
+
+#include <span>
+
+#include "iir/structure.h"
+#include "iir/reader.h"
+
+namespace IIR {
+	/// <summary>
+	/// How one field varies across the compared instances.
+	/// </summary>
+	struct FieldComparison {
+		size_t fieldIndex = 0;
+		bool differs = false; // Some readable instance does not match the first one.
+		size_t distinct = 0; // Distinct values among the readable instances.
+
+		// Smallest and largest value, ordered by the field's type. Only set for fields of 8 bytes or less.
+		bool hasRange = false;
+		MemoryData min{};
+		MemoryData max{};
+	};
+
+	/// <summary>
+	/// One class applied to many base addresses, diffed against the first readable instance.
+	/// </summary>
+	struct Comparison {
+		uint64_t generation = 0; // Of the snapshot the bytes came from.
+		FieldList layout; // The layout the statistics are for.
+		size_t instances = 0;
+		size_t readable = 0; // Instances whose bytes were all in the snapshot.
+
+		std::vector<uint8_t> byteDiffers; // Per byte of the class, non-zero if any readable instance differs there.
+		std::vector<FieldComparison> fields; // One per field of the layout, in order.
+	};
+
+	/// <summary>
+	/// Compares every instance in `bases` using bytes from `snapshot`, which must hold `size` bytes at each base (see RequestInstances).
+	/// Bytes are diffed 16 at a time and only fields with differing bytes pay for sorting their values, so comparing
+	/// a thousand instances of a large class is cheap enough to redo for every snapshot.
+	/// </summary>
+	Comparison CompareInstances(const MemorySnapshot& snapshot, std::span<const uintptr_t> bases, const FieldList& layout, size_t size);
+
+	/// Asks the reader for `size` bytes at every base. The reader coalesces them into as few reads as it can.
+	inline void RequestInstances(MemoryReader& reader, std::span<const uintptr_t> bases, size_t size) {
+		for (uintptr_t base : bases) reader.Request(base, size);
+	}
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "pch.h"
+
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+
+#include "iir/structure.h"
+#include "iir/mappedfile.h"
+
+namespace IIR {
+	/// <summary>
+	/// Type layouts from the DWARF debug info of an ELF file (an executable, shared object or separate .debug file).
+	/// </summary>
+	/// <remarks>
+	/// The file is mapped, not read, and opening it only walks the compilation unit headers. The name index is built one
+	/// unit at a time, either until a lookup finds what it wants or in small slices from the UI, so pages of a multi-GB
+	/// debug file are only touched once something needs them.
+	/// Supports DWARF 2 to 5, 32 and 64-bit DWARF and 32 and 64-bit little endian ELF. Compressed sections are not supported.
+	/// Neither is .debug_types, types that DWARF 4 moved into type units there are not found.
+	/// Not thread safe, use it from one thread.
+	/// </remarks>
+	class DwarfFile {
+	public:
+		/// <returns>The file, or nullptr if it is not an ELF file or has no debug info.</returns>
+		static std::shared_ptr<DwarfFile> Open(const std::filesystem::path& path);
+
+		DwarfFile(const DwarfFile&) = delete;
+		DwarfFile& operator=(const DwarfFile&) = delete;
+
+		size_t UnitCount() const { return units.size(); }
+		size_t IndexedUnitCount() const { return nextUnit; }
+		bool FullyIndexed() const { return nextUnit == units.size(); }
+
+		/// <summary>
+		/// Indexes units until every unit is done or `budget` runs out, call it once a frame to index in the background.
+		/// </summary>
+		/// <returns>True once every unit is indexed.</returns>
+		bool IndexUnits(std::chrono::microseconds budget);
+
+		/// <summary>
+		/// Finds a struct, class or union by its qualified name (e.g. `game::Player`), indexing more units until it is found.
+		/// Typedefs of anonymous structs are found by the typedef's name.
+		/// </summary>
+		/// <returns>The offset of its DIE in .debug_info.</returns>
+		std::optional<uint64_t> FindType(std::string_view name);
+
+		/// <summary>
+		/// Names in the index so far that contain `needle`, ignoring case, sorted.
+		/// </summary>
+		std::vector<std::string_view> Search(std::string_view needle, size_t maxResults) const;
+
+		/// <summary>
+		/// Adds a type and every type it embeds (members and base classes) to the project as new classes.
+		/// Pointer fields point at their class when the pointee was imported as well.
+		/// </summary>
+		/// <returns>The index of the new class, or nullopt if the type was not found.</returns>
+		std::optional<size_t> Import(StructureManager& sm, std::string_view name);
+
+	private:
+		DwarfFile() = default;
+
+		struct Section {
+			const uint8_t* data = nullptr;
+			uint64_t size = 0;
+		};
+
+		struct Unit {
+			uint64_t offset = 0; // Of the unit header in .debug_info.
+			uint64_t dieOffset = 0; // First DIE.
+			uint64_t end = 0;
+			uint64_t abbrevOffset = 0;
+			uint64_t strOffsetsBase = 0;
+			uint16_t version = 0;
+			uint8_t addressSize = 0;
+			bool is64 = false; // 64-bit DWARF, section offsets are 8 bytes.
+			bool prepared = false; // strOffsetsBase has been read from the unit DIE.
+		};
+
+		struct AttributeSpec {
+			uint16_t name;
+			uint16_t form;
+			int64_t implicitConst;
+		};
+
+		struct Abbrev {
+			uint16_t tag = 0; // 0 if the code is not used.
+			bool hasChildren = false;
+			std::vector<AttributeSpec> attributes;
+		};
+
+		/// The attributes of one DIE the importer cares about, everything else is skipped.
+		struct Die {
+			uint64_t offset = 0;
+			uint16_t tag = 0; // 0 for the null entry that ends a list of children.
+			bool hasChildren = false;
+			std::string_view name;
+			std::optional<uint64_t> byteSize;
+			std::optional<uint64_t> memberLocation;
+			std::optional<uint64_t> dataBitOffset;
+			std::optional<uint64_t> bitOffset; // DWARF 3 style, counted from the most significant bit of the storage.
+			std::optional<uint64_t> bitSize;
+			std::optional<uint64_t> count; // From DW_AT_count or DW_AT_upper_bound.
+			uint64_t type = 0; // Offset of the type DIE, 0 if there is none.
+			uint64_t sibling = 0;
+			uint64_t specification = 0; // The declaration this DIE defines, which says what scope it is in.
+			uint64_t signature = 0; // Where the definition of a type declared here is, when it lives in a type unit.
+			uint64_t encoding = 0;
+			bool declaration = false;
+		};
+
+		class DieReader;
+		class Importer;
+
+		Unit* FindUnit(uint64_t dieOffset);
+		bool ReadDie(uint64_t offset, Die& die);
+		const std::vector<Abbrev>* GetAbbrevs(uint64_t offset);
+		void IndexUnit(Unit& unit);
+		/// The qualified name of the record declared at `offset`, indexing units up to the one it is in if needed.
+		std::optional<std::string_view> DeclarationName(uint64_t offset);
+
+		std::shared_ptr<const MappedFile> file;
+		Section info, abbrev, str, lineStr, strOffsets;
+
+		std::vector<Unit> units;
+		size_t nextUnit = 0; // Units before this one are in the index.
+
+		std::unordered_map<uint64_t, std::vector<Abbrev>> abbrevTables; // By offset in .debug_abbrev, indexed by code.
+		std::unordered_map<uint64_t, uint64_t> typeSignatures; // Type unit signature to the offset of its type DIE.
+		std::unordered_map<std::string, uint64_t> index; // Qualified name to DIE offset, the first definition wins.
+		std::unordered_map<uint64_t, std::string> declarationNames; // Record declaration DIE offset to its qualified name.
+	};
+}
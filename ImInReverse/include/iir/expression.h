@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace IIR {
+	/// <summary>
+	/// One pointer-sized read in a batch handed to the reader.
+	/// </summary>
+	struct ScatterRead {
+		uintptr_t address = 0;
+		uintptr_t value = 0;
+		bool valid = false;
+	};
+
+	/// <summary>
+	/// An address expression compiled to bytecode, e.g. "[[game.exe+10]+20]+8".
+	/// Numbers are hex (with or without 0x), names are looked up when evaluated (modules, "module!symbol" for exports,
+	/// "+10" is relative to the executable),
+	/// brackets read a pointer, and +, - and * work as usual with parentheses for grouping.
+	/// Each dereference gets its own small program; they are grouped by how deeply they are nested so every read at
+	/// one depth, across any number of expressions, can be issued as a single batch.
+	/// </summary>
+	class AddressExpression {
+	public:
+		/// <summary>
+		/// Compiles `text`.
+		/// </summary>
+		/// <returns>The compiled expression, or nullopt with `error` describing what is wrong.</returns>
+		static std::optional<AddressExpression> Compile(std::string_view text, std::string& error);
+
+		const std::string& Text() const { return text; }
+		bool HasDereferences() const { return !derefs.empty(); }
+		bool UsesNames() const { return !names.empty(); }
+
+		/// Looks up a name, nullopt if it does not exist (yet). An empty name stands for the executable.
+		using Resolver = std::function<std::optional<uintptr_t>(std::string_view name)>;
+		/// Fills in `value` and `valid` of every read in the batch.
+		using Reader = std::function<void(std::span<ScatterRead> reads)>;
+
+		/// <summary>
+		/// Evaluates `expressions` together. Reads at the same depth across all of them go to `read` in one batch, nearest first.
+		/// </summary>
+		/// <param name="out">One result per expression, nullopt if a name was unknown or a read failed.</param>
+		static void Evaluate(std::span<const AddressExpression* const> expressions, const Resolver& resolve, const Reader& read,
+			std::span<std::optional<uintptr_t>> out);
+
+		std::optional<uintptr_t> Evaluate(const Resolver& resolve, const Reader& read) const {
+			const AddressExpression* self = this;
+			std::optional<uintptr_t> result;
+			Evaluate(std::span(&self, 1), resolve, read, std::span(&result, 1));
+			return result;
+		}
+
+	private:
+		enum class Op : uint8_t {
+			constant, // Pushes constants[operand].
+			name, // Pushes the address of names[operand].
+			load, // Pushes the value read by derefs[operand].
+			add,
+			subtract,
+			multiply,
+			negate,
+		};
+
+		struct Instruction {
+			Op op;
+			uint32_t operand = 0;
+		};
+
+		/// A run of `code`, leaves one value on the stack.
+		struct Program {
+			uint32_t begin = 0, end = 0;
+		};
+
+		struct Deref {
+			Program address;
+			uint32_t level; // 1 if the address reads nothing, otherwise one more than the deepest read it uses.
+		};
+
+		// Deep enough for anything typed by hand, Compile rejects expressions needing more.
+		static constexpr size_t maxStack = 32;
+
+		std::string text;
+		std::vector<Instruction> code;
+		std::vector<uint64_t> constants;
+		std::vector<std::string> names;
+		std::vector<Deref> derefs; // Sorted by level.
+		uint32_t levels = 0;
+		Program result;
+
+		class Compiler;
+
+		/// Runs `program`. `nameValues` and `slots` hold the resolved names and the values read so far.
+		std::optional<uintptr_t> Run(Program program, std::span<const std::optional<uintptr_t>> nameValues, std::span<const uintptr_t> slots) const;
+	};
+}
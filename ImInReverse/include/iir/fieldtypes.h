@@ -0,0 +1,325 @@
+#pragma once
+
+#include "pch.h"
+
+#include <charconv>
+#include <utility>
+
+#include "iir/textformat.h"
+
+namespace IIR {
+	enum class FieldType {
+		u8,
+		u16,
+		u32,
+		u64,
+		i8,
+		i16,
+		i32,
+		i64,
+		f32,
+		f64,
+		boolean,
+		str, // char*, the pointer value is the field, the text lives wherever it points.
+		vec2,
+		vec3,
+		vec4,
+		mat3x4,
+		mat4x4,
+		unk,
+		instance, // Another class embedded inline, `classIndex` says which.
+		pointer // Pointer to an instance of `classIndex`, or an untyped pointer if it is -1.
+	};
+
+	constexpr size_t fieldTypeCount = static_cast<size_t>(FieldType::pointer) + 1;
+
+	/// <summary>
+	/// Everything the UI needs to know about a field type, one entry per FieldType.
+	/// Types with a size of 0 take whatever size the field has.
+	/// </summary>
+	struct FieldTypeInfo {
+		const char* name;
+		int size;
+		int alignment;
+
+		/// Writes the value of `size` bytes at `data` as text. Returns the number of characters written.
+		int (*format)(const uint8_t* data, int size, char* out, size_t outSize);
+		/// Parses `text` into `size` bytes at `out`. Returns false if the text is not a valid value. Null for types that cannot be edited.
+		bool (*parse)(std::string_view text, int size, uint8_t* out);
+	};
+
+	/// <summary>
+	/// Compile-time description of a field type. Specialise this for every FieldType, the dispatch table below is built from it.
+	/// A specialisation provides `name`, `size`, `alignment`, `Format` and optionally `Parse` with the signatures of FieldTypeInfo.
+	/// </summary>
+	template<FieldType Type>
+	struct FieldTypeTraits;
+
+	namespace detail {
+		inline std::string_view Trim(std::string_view text) {
+			while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+			while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+			return text;
+		}
+
+		/// Parses a whole string as a number, integers may be given in hex with a 0x prefix.
+		template<typename T>
+		bool ParseNumber(std::string_view text, T& value) {
+			text = Trim(text);
+			const char* first = text.data();
+			const char* last = first + text.size();
+
+			std::from_chars_result result;
+			if constexpr (std::is_floating_point_v<T>) {
+				result = std::from_chars(first, last, value);
+			}
+			else {
+				bool negative = std::is_signed_v<T> && first != last && *first == '-';
+				if (negative) first++;
+
+				int base = 10;
+				if (last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X')) {
+					base = 16;
+					first += 2;
+				}
+
+				// Read through the unsigned type so 0xFF works for an i8
+				std::make_unsigned_t<T> bits = 0;
+				result = std::from_chars(first, last, bits, base);
+				value = static_cast<T>(negative ? 0 - bits : bits);
+			}
+
+			return result.ec == std::errc() && result.ptr == last;
+		}
+
+		template<typename T>
+		T Read(const uint8_t* data) {
+			T value;
+			std::memcpy(&value, data, sizeof(T));
+			return value;
+		}
+
+		template<typename T>
+		struct IntegerTraits {
+			static constexpr int size = sizeof(T);
+			static constexpr int alignment = alignof(T);
+
+			static int Format(const uint8_t* data, int, char* out, size_t outSize) {
+				T value = Read<T>(data);
+				TextWriter text(out, outSize);
+				text.Int(value).Put(" (0x").Hex(static_cast<std::make_unsigned_t<T>>(value), static_cast<int>(sizeof(T) * 2)).Put(')');
+				return text.Length();
+			}
+
+			/// Also accepts the formatted text back, the hex in parentheses is ignored.
+			static bool Parse(std::string_view text, int, uint8_t* out) {
+				T value;
+				if (!ParseNumber(text.substr(0, text.find('(')), value)) return false;
+				std::memcpy(out, &value, sizeof(T));
+				return true;
+			}
+		};
+
+		template<typename T>
+		struct FloatTraits {
+			static constexpr int size = sizeof(T);
+			static constexpr int alignment = alignof(T);
+
+			static int Format(const uint8_t* data, int, char* out, size_t outSize) {
+				TextWriter text(out, outSize);
+				text.Float(static_cast<double>(Read<T>(data)), std::is_same_v<T, float> ? 7 : 15);
+				return text.Length();
+			}
+
+			static bool Parse(std::string_view text, int, uint8_t* out) {
+				T value;
+				if (!ParseNumber(text, value)) return false;
+				std::memcpy(out, &value, sizeof(T));
+				return true;
+			}
+		};
+
+		/// `Rows` rows of `Columns` floats, a vector is a single row.
+		template<int Columns, int Rows = 1>
+		struct FloatArrayTraits {
+			static constexpr int size = static_cast<int>(sizeof(float)) * Columns * Rows;
+			static constexpr int alignment = alignof(float);
+
+			static int Format(const uint8_t* data, int, char* out, size_t outSize) {
+				TextWriter text(out, outSize);
+				for (int row = 0; row < Rows; row++) {
+					text.Put(Rows > 1 ? '[' : '(');
+					for (int col = 0; col < Columns; col++) {
+						if (col) text.Put(", ");
+						text.Float(static_cast<double>(Read<float>(data + (row * Columns + col) * sizeof(float))), 4);
+					}
+					text.Put(Rows > 1 ? (row + 1 < Rows ? "] " : "]") : ")");
+				}
+				return text.Length();
+			}
+
+			/// Accepts the components separated by commas and/or whitespace, brackets are ignored.
+			static bool Parse(std::string_view text, int, uint8_t* out) {
+				float values[Columns * Rows];
+				int count = 0;
+
+				size_t pos = 0;
+				while (pos < text.size()) {
+					size_t end = text.find_first_of(", \t()[]", pos);
+					if (end == std::string_view::npos) end = text.size();
+
+					if (end > pos) {
+						if (count == Columns * Rows || !ParseNumber(text.substr(pos, end - pos), values[count])) return false;
+						count++;
+					}
+					pos = end + 1;
+				}
+
+				if (count != Columns * Rows) return false;
+				std::memcpy(out, values, sizeof(values));
+				return true;
+			}
+		};
+
+		/// Shared by the pointer-sized types, the value is an address in the target.
+		struct AddressTraits {
+			static constexpr int size = sizeof(uintptr_t);
+			static constexpr int alignment = alignof(uintptr_t);
+
+			static int Format(const uint8_t* data, int, char* out, size_t outSize) {
+				TextWriter text(out, outSize);
+				text.Put("-> ").Hex(Read<uintptr_t>(data));
+				return text.Length();
+			}
+
+			static bool Parse(std::string_view text, int, uint8_t* out) {
+				text = Trim(text);
+				if (text.starts_with("->")) text.remove_prefix(2);
+				text = Trim(text);
+				if (text.starts_with("0x") || text.starts_with("0X")) text.remove_prefix(2);
+
+				uintptr_t value = 0;
+				auto result = std::from_chars(text.data(), text.data() + text.size(), value, 16);
+				if (text.empty() || result.ec != std::errc() || result.ptr != text.data() + text.size()) return false;
+				std::memcpy(out, &value, sizeof(value));
+				return true;
+			}
+		};
+	}
+
+	template<> struct FieldTypeTraits<FieldType::u8> : detail::IntegerTraits<uint8_t> { static constexpr const char* name = "u8"; };
+	template<> struct FieldTypeTraits<FieldType::u16> : detail::IntegerTraits<uint16_t> { static constexpr const char* name = "u16"; };
+	template<> struct FieldTypeTraits<FieldType::u32> : detail::IntegerTraits<uint32_t> { static constexpr const char* name = "u32"; };
+	template<> struct FieldTypeTraits<FieldType::u64> : detail::IntegerTraits<uint64_t> { static constexpr const char* name = "u64"; };
+	template<> struct FieldTypeTraits<FieldType::i8> : detail::IntegerTraits<int8_t> { static constexpr const char* name = "i8"; };
+	template<> struct FieldTypeTraits<FieldType::i16> : detail::IntegerTraits<int16_t> { static constexpr const char* name = "i16"; };
+	template<> struct FieldTypeTraits<FieldType::i32> : detail::IntegerTraits<int32_t> { static constexpr const char* name = "i32"; };
+	template<> struct FieldTypeTraits<FieldType::i64> : detail::IntegerTraits<int64_t> { static constexpr const char* name = "i64"; };
+	template<> struct FieldTypeTraits<FieldType::f32> : detail::FloatTraits<float> { static constexpr const char* name = "f32"; };
+	template<> struct FieldTypeTraits<FieldType::f64> : detail::FloatTraits<double> { static constexpr const char* name = "f64"; };
+	template<> struct FieldTypeTraits<FieldType::vec2> : detail::FloatArrayTraits<2> { static constexpr const char* name = "vec2"; };
+	template<> struct FieldTypeTraits<FieldType::vec3> : detail::FloatArrayTraits<3> { static constexpr const char* name = "vec3"; };
+	template<> struct FieldTypeTraits<FieldType::vec4> : detail::FloatArrayTraits<4> { static constexpr const char* name = "vec4"; };
+	template<> struct FieldTypeTraits<FieldType::mat3x4> : detail::FloatArrayTraits<4, 3> { static constexpr const char* name = "mat3x4"; };
+	template<> struct FieldTypeTraits<FieldType::mat4x4> : detail::FloatArrayTraits<4, 4> { static constexpr const char* name = "mat4x4"; };
+	template<> struct FieldTypeTraits<FieldType::str> : detail::AddressTraits { static constexpr const char* name = "char*"; };
+	template<> struct FieldTypeTraits<FieldType::pointer> : detail::AddressTraits { static constexpr const char* name = "ptr"; };
+
+	template<>
+	struct FieldTypeTraits<FieldType::boolean> {
+		static constexpr const char* name = "bool";
+		static constexpr int size = sizeof(bool);
+		static constexpr int alignment = alignof(bool);
+
+		static int Format(const uint8_t* data, int, char* out, size_t outSize) {
+			TextWriter text(out, outSize);
+			text.Put(data[0] ? "true" : "false");
+			// Anything but 0 or 1 is suspicious, show the raw byte too
+			if (data[0] > 1) text.Put(" (0x").Hex(data[0], 2).Put(')');
+			return text.Length();
+		}
+
+		static bool Parse(std::string_view text, int, uint8_t* out) {
+			text = detail::Trim(text.substr(0, text.find('(')));
+			if (text == "true" || text == "1") out[0] = 1;
+			else if (text == "false" || text == "0") out[0] = 0;
+			else return false;
+			return true;
+		}
+	};
+
+	/// Untyped bytes, shown as an integer when the size allows it.
+	template<>
+	struct FieldTypeTraits<FieldType::unk> {
+		static constexpr const char* name = "hex";
+		static constexpr int size = 0;
+		static constexpr int alignment = 1;
+
+		static int Format(const uint8_t* data, int size, char* out, size_t outSize) {
+			switch (size) {
+			case 1: return FieldTypeTraits<FieldType::i8>::Format(data, size, out, outSize);
+			case 2: return FieldTypeTraits<FieldType::i16>::Format(data, size, out, outSize);
+			case 4: return FieldTypeTraits<FieldType::i32>::Format(data, size, out, outSize);
+			case 8: return FieldTypeTraits<FieldType::i64>::Format(data, size, out, outSize);
+			default: {
+				TextWriter text(out, outSize);
+				text.Put('(').Int(size).Put(" bytes)");
+				return text.Length();
+			}
+			}
+		}
+
+		static bool Parse(std::string_view text, int size, uint8_t* out) {
+			switch (size) {
+			case 1: return FieldTypeTraits<FieldType::i8>::Parse(text, size, out);
+			case 2: return FieldTypeTraits<FieldType::i16>::Parse(text, size, out);
+			case 4: return FieldTypeTraits<FieldType::i32>::Parse(text, size, out);
+			case 8: return FieldTypeTraits<FieldType::i64>::Parse(text, size, out);
+			default: return false;
+			}
+		}
+	};
+
+	template<>
+	struct FieldTypeTraits<FieldType::instance> {
+		static constexpr const char* name = "instance";
+		static constexpr int size = 0;
+		static constexpr int alignment = 1;
+
+		static int Format(const uint8_t*, int size, char* out, size_t outSize) {
+			TextWriter text(out, outSize);
+			text.Put('(').Int(size).Put(" bytes)");
+			return text.Length();
+		}
+	};
+
+	namespace detail {
+		template<FieldType Type>
+		constexpr FieldTypeInfo MakeFieldTypeInfo() {
+			using Traits = FieldTypeTraits<Type>;
+			static_assert(Traits::size >= 0 && Traits::alignment > 0, "Invalid field type traits");
+			if constexpr (requires { &Traits::Parse; })
+				return FieldTypeInfo{ Traits::name, Traits::size, Traits::alignment, &Traits::Format, &Traits::Parse };
+			else
+				return FieldTypeInfo{ Traits::name, Traits::size, Traits::alignment, &Traits::Format, nullptr };
+		}
+
+		template<size_t... I>
+		constexpr std::array<FieldTypeInfo, sizeof...(I)> MakeFieldTypeTable(std::index_sequence<I...>) {
+			return { MakeFieldTypeInfo<static_cast<FieldType>(I)>()... };
+		}
+	}
+
+	/// Dispatch table indexed by FieldType, built at compile time from the FieldTypeTraits specialisations.
+	inline constexpr std::array<FieldTypeInfo, fieldTypeCount> fieldTypeTable = detail::MakeFieldTypeTable(std::make_index_sequence<fieldTypeCount>{});
+
+	constexpr const FieldTypeInfo& GetFieldTypeInfo(FieldType type) {
+		return fieldTypeTable[static_cast<size_t>(type)];
+	}
+
+	/// True if a field of `size` bytes can hold a value of `type`.
+	constexpr bool FitsType(FieldType type, int size) {
+		int typeSize = GetFieldTypeInfo(type).size;
+		return typeSize == 0 || typeSize == size;
+	}
+}
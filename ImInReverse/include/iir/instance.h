@@ -0,0 +1,44 @@
+#pragma once
+
+#include "pch.h"
+
+#include "iir/structure.h"
+#include "iir/reader.h"
+
+namespace IIR {
+	/// <summary>
+	/// An instance bound to the layout of its class and to the snapshot its bytes come from.
+	/// The layout shares its nodes with the class, so binding many instances of one class copies no fields.
+	/// </summary>
+	struct InstanceView {
+		FieldList layout;
+		uintptr_t base = 0;
+		std::shared_ptr<const MemorySnapshot> snapshot;
+
+		size_t Size() const {
+			if (layout.Empty()) return 0;
+			const auto& last = layout.Back();
+			return last.offset + last.size;
+		}
+
+		/// The bytes of `field` in this instance, or nullptr if they were not read.
+		const uint8_t* Read(const Field& field) const {
+			return snapshot->Find(base + field.offset, field.size);
+		}
+
+		/// The bytes of the whole instance, or nullptr if any of them were not read.
+		const uint8_t* Bytes() const {
+			return snapshot->Find(base, Size());
+		}
+	};
+
+	/// Binds `instance` to the current layout of its class and to this frame's snapshot.
+	inline InstanceView BindInstance(const StructureManager& sm, const MemoryReader& reader, const Instance& instance) {
+		return { sm.GetClass(instance.classIndex).fields, instance.base, reader.FrameHandle() };
+	}
+
+	/// Asks the reader for every byte of each instance, the reader coalesces neighbouring instances into a single read.
+	inline void RequestInstances(MemoryReader& reader, const StructureManager& sm, std::span<const Instance> instances) {
+		for (const auto& instance : instances) reader.Request(instance.base, sm.GetClass(instance.classIndex).TotalSize());
+	}
+}
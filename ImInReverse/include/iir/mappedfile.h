@@ -0,0 +1,68 @@
+#pragma once
+
+#include "pch.h"
+
+#include <filesystem>
+
+namespace IIR {
+	/// <summary>
+	/// A whole file mapped read-only into our address space. Pages are only read from disk when they are touched,
+	/// so mapping a multi-GB file is as cheap as mapping a small one.
+	/// </summary>
+	class MappedFile {
+	public:
+		/// <returns>The mapped file, or nullptr if it could not be opened or is empty.</returns>
+		static std::shared_ptr<const MappedFile> Open(const std::filesystem::path& path) {
+			std::shared_ptr<MappedFile> mapped(new MappedFile());
+
+			mapped->file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (mapped->file == INVALID_HANDLE_VALUE) {
+				spdlog::error("Failed to open {}: {}", path.string(), GetLastError());
+				return nullptr;
+			}
+
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(mapped->file, &fileSize) || fileSize.QuadPart == 0) {
+				spdlog::error("{} is empty", path.string());
+				return nullptr;
+			}
+			mapped->size = static_cast<uint64_t>(fileSize.QuadPart);
+
+			mapped->mapping = CreateFileMappingA(mapped->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapped->mapping) {
+				mapped->view = static_cast<const uint8_t*>(MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0));
+			}
+			if (!mapped->view) {
+				spdlog::error("Failed to map {}: {}", path.string(), GetLastError());
+				return nullptr;
+			}
+
+			return mapped;
+		}
+
+		~MappedFile() {
+			if (view) UnmapViewOfFile(view);
+			if (mapping) CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* Data() const { return view; }
+		uint64_t Size() const { return size; }
+
+		/// True if [offset, offset + length) lies inside the file.
+		bool Contains(uint64_t offset, uint64_t length) const {
+			return offset <= size && length <= size - offset;
+		}
+
+	private:
+		MappedFile() = default;
+
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+		const uint8_t* view = nullptr;
+		uint64_t size = 0;
+	};
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "pch.h"
+
+#include <unordered_map>
+
+namespace IIR {
+	/// <summary>
+	/// One image loaded in the target.
+	/// </summary>
+	struct Module {
+		std::string name; // File name, e.g. "ntdll.dll".
+		uintptr_t base = 0;
+		size_t size = 0;
+		std::string path;
+		std::string buildId; // PDB GUID and age from the CodeView record, the key symbol servers use. Empty if the image has none.
+		uint32_t timeDateStamp = 0; // Link time from the PE header, tells another image loaded at the same base apart.
+	};
+
+	/// <summary>
+	/// Every module of the target at one point in time, sorted by base address.
+	/// Address lookups are a binary search, so symbolizing a screen of pointers costs no more than a few microseconds.
+	/// </summary>
+	struct ModuleSnapshot {
+		uint64_t version = 0; // Bumped whenever a module is loaded or unloaded.
+		std::vector<Module> modules;
+		size_t mainModule = SIZE_MAX; // Index of the executable, the module `+offset` is relative to.
+		std::unordered_map<std::string, size_t> byName; // Lowercase file name to index.
+
+		/// Returns the module containing `address`, or nullptr if it is not inside one.
+		const Module* Find(uintptr_t address) const {
+			auto it = std::upper_bound(modules.begin(), modules.end(), address,
+				[](uintptr_t addr, const Module& module) { return addr < module.base; });
+			if (it == modules.begin()) return nullptr;
+
+			const Module& module = *std::prev(it);
+			return address < module.base + module.size ? &module : nullptr;
+		}
+
+		/// Returns the module called `name`, ignoring case. The extension can be left out, "ntdll" finds "ntdll.dll".
+		const Module* FindByName(std::string_view name) const;
+
+		const Module* Main() const { return mainModule < modules.size() ? &modules[mainModule] : nullptr; }
+
+		/// The base of the module called `name`, or of the executable if it is empty. Resolves names in address expressions.
+		std::optional<uintptr_t> Resolve(std::string_view name) const {
+			const Module* module = name.empty() ? Main() : FindByName(name);
+			if (!module) return std::nullopt;
+			return module->base;
+		}
+	};
+
+	/// <summary>
+	/// Keeps the list of modules loaded in the target up to date on a background thread.
+	/// Each refresh is one EnumProcessModulesEx call plus a read of the PE header of every module that was there last time,
+	/// to notice another image loaded at the same base. Only new modules are queried for their size, path and build ID,
+	/// so nothing is published unless something was loaded or unloaded.
+	/// </summary>
+	class ModuleMap {
+	public:
+		static ModuleMap& GetInstance();
+
+		void Init();
+
+		/// The latest module list. Safe to call from any thread, the snapshot never changes once published.
+		std::shared_ptr<const ModuleSnapshot> Get() const { return latest.load(); }
+
+		/// Asks for the list to be refreshed as soon as possible, e.g. when a module that was asked for is missing.
+		void Invalidate() { stale = true; }
+
+	private:
+		ModuleMap();
+		~ModuleMap();
+		ModuleMap(const ModuleMap&) = delete;
+		ModuleMap& operator=(const ModuleMap&) = delete;
+
+		static constexpr auto refreshInterval = std::chrono::milliseconds(500);
+
+		void UpdateFunction();
+
+		/// Builds a new snapshot if the modules differ from `previous`, reusing what is known about the ones still loaded.
+		/// Returns nullptr if nothing changed.
+		std::shared_ptr<ModuleSnapshot> Refresh(HANDLE handle, const ModuleSnapshot& previous);
+
+		std::vector<HMODULE> handles; // Reused between refreshes, only touched by the update thread.
+
+		std::atomic<std::shared_ptr<const ModuleSnapshot>> latest;
+		std::atomic<bool> stale = true;
+
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+	};
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "pch.h"
+
+#include <list>
+#include <unordered_map>
+
+#include "iir/regions.h"
+
+namespace IIR {
+	/// <summary>
+	/// One page of target memory as it was when last read. Never changes once stored, a re-read stores a new one.
+	/// </summary>
+	struct MemoryPage {
+		static constexpr uintptr_t size = 0x1000;
+
+		uintptr_t address = 0;
+		std::vector<uint8_t> data; // Empty if the page could not be read.
+
+		bool IsReadable() const { return !data.empty(); }
+	};
+
+	/// <summary>
+	/// Reads whole pages of the target on demand on a background thread and keeps the most recently used ones, up to a
+	/// fixed number, so views can scroll through regions far larger than anything the MemoryReader would poll.
+	/// Views say every frame which pages they show and which way they are scrolling: those pages are read first and kept
+	/// up to date, the ones after them in the scroll direction are read ahead once.
+	/// </summary>
+	class PageCache {
+	public:
+		// Pages kept before the least recently used ones are dropped, 32 MB
+		static constexpr size_t capacity = 8192;
+		// Pages read ahead of a view in the direction it is scrolling
+		static constexpr size_t prefetchPages = 64;
+
+		/// <summary>
+		/// What one view wants read. Pages are never read outside [limitBegin, limitEnd), the region or module the view shows.
+		/// </summary>
+		struct Request {
+			uintptr_t first = 0; // First visible page.
+			uintptr_t last = 0; // Last visible page, inclusive.
+			int direction = 0; // 1 when scrolling down, -1 up and 0 to read ahead both ways.
+			uintptr_t limitBegin = 0;
+			uintptr_t limitEnd = 0;
+		};
+
+		static PageCache& GetInstance();
+
+		void Init();
+
+		/// <summary>
+		/// Tells the cache what `owner` is showing, replacing what it asked for before. Call every frame while the pages
+		/// are wanted, they stop being refreshed shortly after the calls stop.
+		/// </summary>
+		void Want(const void* owner, const Request& request);
+
+		/// The page starting at `address`, or nullptr if it has not been read yet. Counts as a use of the page.
+		std::shared_ptr<const MemoryPage> Get(uintptr_t address);
+
+		/// Bumped whenever a page is stored with different contents, or the cache is emptied. Safe to call from any thread.
+		uint64_t Version() const { return version.load(std::memory_order_acquire); }
+
+		static uintptr_t PageOf(uintptr_t address) { return address & ~(MemoryPage::size - 1); }
+
+	private:
+		PageCache();
+		~PageCache();
+		PageCache(const PageCache&) = delete;
+		PageCache& operator=(const PageCache&) = delete;
+
+		// Visible pages are read again this often
+		static constexpr auto refreshInterval = std::chrono::milliseconds(250);
+		// A view's request is dropped when Want has not been called for this long
+		static constexpr auto idleTimeout = std::chrono::seconds(2);
+		// Pages read per batch before looking at the requests again, so a view that moved on is served quickly
+		static constexpr size_t batchPages = 16;
+
+		struct Entry {
+			std::shared_ptr<const MemoryPage> page;
+			std::chrono::steady_clock::time_point readAt;
+		};
+
+		struct Wanted {
+			Request request;
+			std::chrono::steady_clock::time_point lastSeen;
+		};
+
+		void UpdateFunction();
+		/// Picks the next pages to read: stale visible ones first, then missing ones ahead of each view.
+		std::vector<uintptr_t> NextBatch(std::chrono::steady_clock::time_point now);
+		/// Reads `count` consecutive pages, in one call if they are all readable.
+		void ReadPages(HANDLE handle, const RegionSnapshot* regions, uintptr_t first, size_t count, std::vector<std::shared_ptr<const MemoryPage>>& out);
+		void Store(std::vector<std::shared_ptr<const MemoryPage>>& read, std::chrono::steady_clock::time_point now);
+		void Clear();
+
+		std::mutex mtx; // Guards everything below up to the thread.
+		std::list<Entry> lru; // Most recently used first.
+		std::unordered_map<uintptr_t, std::list<Entry>::iterator> pages;
+		std::unordered_map<const void*, Wanted> requests;
+
+		std::atomic<uint64_t> version = 0;
+
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+	};
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "pch.h"
+
+#include <initializer_list>
+#include <span>
+
+namespace IIR {
+	/// <summary>
+	/// An immutable, ordered sequence backed by a path-copying treap.
+	/// Every edit returns a new sequence that shares all untouched nodes with the old one, so keeping
+	/// old versions around (undo history, the reader thread's view of the layout) costs O(log n) nodes per edit
+	/// and copying a version is a single reference count increment.
+	/// </summary>
+	template<typename T>
+	class PersistentSequence {
+	public:
+		struct Node {
+			T value;
+			uint32_t priority;
+			size_t count;
+			std::shared_ptr<const Node> left, right;
+		};
+		using NodePtr = std::shared_ptr<const Node>;
+
+		PersistentSequence() = default;
+		PersistentSequence(std::initializer_list<T> values) {
+			for (const auto& value : values)
+				root = Merge(root, MakeLeaf(value));
+		}
+
+		size_t Size() const { return Count(root); }
+		bool Empty() const { return root == nullptr; }
+
+		/// Returns the element at the given index. The index must be in range.
+		const T& At(size_t index) const {
+			const Node* node = root.get();
+			while (node) {
+				size_t leftCount = Count(node->left);
+				if (index < leftCount) {
+					node = node->left.get();
+				}
+				else if (index == leftCount) {
+					return node->value;
+				}
+				else {
+					index -= leftCount + 1;
+					node = node->right.get();
+				}
+			}
+
+			assert(false && "PersistentSequence index out of range");
+			return root->value;
+		}
+
+		const T& operator[](size_t index) const { return At(index); }
+		const T& Back() const { return At(Size() - 1); }
+
+		/// <summary>
+		/// Returns the index of the first element for which `pred` is false, assuming the sequence is partitioned by it
+		/// (e.g. `[](const Field& f) { return f.offset < x; }` on a list sorted by offset).
+		/// </summary>
+		template<typename Pred>
+		size_t PartitionPoint(Pred pred) const {
+			size_t index = 0;
+			const Node* node = root.get();
+			while (node) {
+				if (pred(node->value)) {
+					index += Count(node->left) + 1;
+					node = node->right.get();
+				}
+				else {
+					node = node->left.get();
+				}
+			}
+			return index;
+		}
+
+		/// Calls `fn` for each element in [first, last) in order.
+		template<typename Fn>
+		void ForEach(size_t first, size_t last, Fn&& fn) const {
+			ForEachImpl(root.get(), 0, first, last, fn);
+		}
+
+		template<typename Fn>
+		void ForEach(Fn&& fn) const { ForEach(0, Size(), fn); }
+
+		/// Returns a new sequence where [first, first + count) is replaced with `values`.
+		PersistentSequence Replace(size_t first, size_t count, std::span<const T> values) const {
+			auto [head, rest] = Split(root, first);
+			auto [removed, tail] = Split(rest, count);
+			(void)removed;
+
+			NodePtr middle = nullptr;
+			for (const auto& value : values)
+				middle = Merge(middle, MakeLeaf(value));
+
+			return PersistentSequence(Merge(Merge(head, middle), tail));
+		}
+
+		PersistentSequence Set(size_t index, const T& value) const {
+			return Replace(index, 1, std::span<const T>(&value, 1));
+		}
+
+		PersistentSequence Insert(size_t index, std::span<const T> values) const {
+			return Replace(index, 0, values);
+		}
+
+		PersistentSequence Erase(size_t first, size_t count = 1) const {
+			return Replace(first, count, {});
+		}
+
+		PersistentSequence PushBack(const T& value) const {
+			return PersistentSequence(Merge(root, MakeLeaf(value)));
+		}
+
+		/// True if both sequences are the same version (not merely equal contents).
+		bool SameVersion(const PersistentSequence& other) const { return root == other.root; }
+
+	private:
+		explicit PersistentSequence(NodePtr root) : root(std::move(root)) {}
+
+		NodePtr root = nullptr;
+
+		static size_t Count(const NodePtr& node) { return node ? node->count : 0; }
+
+		static uint32_t NextPriority() {
+			// xorshift32; priorities only need to be well distributed, not secure.
+			static thread_local uint32_t state = 0x9E3779B9u ^ static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		static NodePtr MakeNode(const T& value, uint32_t priority, NodePtr left, NodePtr right) {
+			size_t count = Count(left) + Count(right) + 1;
+			return std::make_shared<const Node>(Node{ value, priority, count, std::move(left), std::move(right) });
+		}
+
+		static NodePtr MakeLeaf(const T& value) {
+			return MakeNode(value, NextPriority(), nullptr, nullptr);
+		}
+
+		static NodePtr Merge(const NodePtr& a, const NodePtr& b) {
+			if (!a) return b;
+			if (!b) return a;
+
+			if (a->priority > b->priority)
+				return MakeNode(a->value, a->priority, a->left, Merge(a->right, b));
+			return MakeNode(b->value, b->priority, Merge(a, b->left), b->right);
+		}
+
+		/// Splits into ([0, index), [index, size)).
+		static std::pair<NodePtr, NodePtr> Split(const NodePtr& node, size_t index) {
+			if (!node) return { nullptr, nullptr };
+			if (index == 0) return { nullptr, node };
+			if (index >= node->count) return { node, nullptr };
+
+			size_t leftCount = Count(node->left);
+			if (index <= leftCount) {
+				auto [l, r] = Split(node->left, index);
+				return { l, MakeNode(node->value, node->priority, r, node->right) };
+			}
+
+			auto [l, r] = Split(node->right, index - leftCount - 1);
+			return { MakeNode(node->value, node->priority, node->left, l), r };
+		}
+
+		template<typename Fn>
+		static void ForEachImpl(const Node* node, size_t base, size_t first, size_t last, Fn& fn) {
+			if (!node || first >= last) return;
+
+			size_t leftCount = Count(node->left);
+			size_t index = base + leftCount;
+			if (first < index)
+				ForEachImpl(node->left.get(), base, first, last, fn);
+			if (index >= first && index < last)
+				fn(node->value);
+			if (last > index + 1)
+				ForEachImpl(node->right.get(), index + 1, first, last, fn);
+		}
+	};
+}
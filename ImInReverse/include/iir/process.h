@@ -9,19 +9,43 @@
 #include <mutex>
 #include <atomic>
 
-#pragma comment(lib, "wbemuuid.lib")
+#include "iir/procevents.h"
 
 namespace IIR {
-	struct Process {
-		std::string name;
-		DWORD pid;
+	class TimingSeries;
+	class Counter;
+
+	/// <summary>
+	/// The profiler series and counters one user of TimedRead records into.
+	/// </summary>
+	struct ReadMetrics {
+		TimingSeries& latency;
+		Counter& reads;
+		Counter& bytes;
+		Counter& failedPages;
+	};
+
+	/// <summary>
+	/// ReadProcessMemory that records itself into `metrics`, fails unless all `size` bytes were read.
+	/// `retried` reads are read again in parts when they fail, their failed pages are counted by those reads instead.
+	/// </summary>
+	bool TimedRead(HANDLE handle, uintptr_t address, void* out, size_t size, const ReadMetrics& metrics, bool retried = false);
+
+	/// <summary>
+	/// An immutable version of the process list. New versions are built on the event thread and swapped in whole,
+	/// readers keep whichever version they loaded for as long as they hold on to it.
+	/// </summary>
+	struct ProcessList {
+		uint64_t version = 0;
+		std::vector<Process> processes;
 	};
 
 	class ProcessManager {
 	public:
 		static ProcessManager& GetInstance();
 
-		const std::vector<Process>& GetProcesses();
+		/// The latest process list. Cheap to call, hold on to the result for the rest of the frame.
+		std::shared_ptr<const ProcessList> GetProcesses() const { return processList.load(); }
 
 		bool OpenProcess(DWORD pid);
 		bool OpenProcess(const Process& process) { return OpenProcess(process.pid); }
@@ -29,13 +53,15 @@ namespace IIR {
 		bool IsProcessSuspended();
 		HANDLE GetHandle() { return this->processHandle; }
 
+		/// Writes `size` bytes to the target, returns false if the write failed or wrote less.
+		bool WriteMemory(uintptr_t address, const void* data, size_t size);
+
 		void SuspendProcess();
 		void ResumeProcess();
 
 		void CloseProcess();
 
 		void Init() {
-			InitCOM();
 			StartListening();
 		}
 
@@ -45,20 +71,39 @@ namespace IIR {
 		ProcessManager(const ProcessManager&) = delete;
 		ProcessManager& operator=(const ProcessManager&) = delete;
 
-		void InitCOM();
 		void StartListening();
-		void PerformInitialScan();
+		void OnProcessEvents(std::span<const ProcessEvent> events);
 
 		HANDLE processHandle = nullptr;
 		std::optional<Process> selectedProcess = std::nullopt;
 
-		IWbemLocator* pLoc = nullptr;
-		IWbemServices* pSvc = nullptr;
-		IWbemObjectSink* sink = nullptr;
+		std::unique_ptr<ProcessWatcher> watcher;
 
-		std::mutex processMtx;
-		std::vector<Process> processes;
+		/// Publishes a copy of the current list with `edit` applied. Writers are serialized, readers never wait.
+		template <typename Fn>
+		void UpdateProcesses(Fn&& edit) {
+			std::lock_guard<std::mutex> lock(writeMtx);
+			auto current = processList.load();
+			auto next = std::make_shared<ProcessList>(*current);
+			next->version = current->version + 1;
+			edit(next->processes);
+			processList.store(std::move(next));
+		}
+
+		using ListEdit = std::function<void(std::vector<Process>&)>;
+
+		/// Applies `edit` like UpdateProcesses, or holds it back while the first scan runs so it can be replayed onto the scan's result.
+		void EditProcesses(ListEdit edit) {
+			std::lock_guard<std::mutex> lock(scanMtx);
+			if (scanning) heldEdits.push_back(std::move(edit));
+			else UpdateProcesses(edit);
+		}
+
+		std::mutex scanMtx; // Guards `scanning` and `heldEdits`, taken before writeMtx.
+		bool scanning = false;
+		std::vector<ListEdit> heldEdits; // Events received during the first scan, in order.
 
-		class EventSink;
+		std::mutex writeMtx;
+		std::atomic<std::shared_ptr<const ProcessList>> processList = std::make_shared<const ProcessList>();
 	};
 }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace IIR {
+	enum class RunState {
+		unknown, // The process could not be queried.
+		running,
+		partial, // Some threads are suspended, others run.
+		suspended, // Every thread is suspended.
+	};
+
+	/// <summary>
+	/// Reads whether the threads of `pid` are suspended. Only looks, unlike suspending and resuming each thread to read its count.
+	/// </summary>
+	RunState QueryRunState(uint32_t pid);
+
+	/// Suspends every thread of `pid` in one call, returns false if that failed.
+	bool FreezeProcess(uint32_t pid);
+
+	/// Undoes FreezeProcess.
+	bool ThawProcess(uint32_t pid);
+}
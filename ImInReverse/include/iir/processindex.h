@@ -0,0 +1,82 @@
+#pragma once
+
+#include "pch.h"
+
+#include <span>
+#include <unordered_map>
+
+#include "iir/process.h"
+
+namespace IIR {
+	/// <summary>
+	/// Searches the process list by name, PID and command line. Kept up to date with each new version of the list,
+	/// only processes that started, exited or changed are re-indexed. UI thread only.
+	/// </summary>
+	class ProcessIndex {
+	public:
+		struct Match {
+			uint32_t entry;
+			int score;
+		};
+
+		/// Brings the index up to date with `list`, does nothing if it has already seen this version.
+		void Update(const ProcessList& list);
+
+		/// <summary>
+		/// Finds the processes matching `query`, best first. Names match by substring or fuzzily (the query's characters in order),
+		/// PIDs by prefix and command lines by substring once the query is three characters or longer.
+		/// Typing more characters only re-checks what the previous query matched.
+		/// </summary>
+		/// <returns>The matches, valid until the next call to Update or Search.</returns>
+		std::span<const Match> Search(std::string_view query);
+
+		const Process& Get(uint32_t entry) const { return entries[entry].process; }
+		size_t Size() const { return entries.size() - freeEntries.size(); }
+
+	private:
+		struct Entry {
+			Process process;
+			std::string name; // Lowercase.
+			std::string commandLine; // Lowercase.
+			uint64_t seen = 0; // List version this process was last in.
+			bool used = false;
+		};
+
+		std::vector<Entry> entries;
+		std::vector<uint32_t> freeEntries;
+		std::unordered_map<uint32_t, uint32_t> byPid;
+
+		// Kept apart from the entries so rejecting most of them touches one small array
+		std::vector<uint64_t> nameChars; // Per entry, which characters the name contains. Zero for free entries.
+		std::vector<uint32_t> pids; // Per entry.
+		std::vector<uint32_t> nameRanks; // Per entry, its place in name order. Ties in score are ordered by it.
+		uint64_t rankedVersion = UINT64_MAX;
+
+		// Entries whose command line contains each trigram. Entries that were removed or reused are left in place
+		// and weeded out when a query checks its candidates, the whole table is rebuilt once they outnumber the rest.
+		std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+		size_t staleEntries = 0;
+
+		uint64_t listVersion = UINT64_MAX;
+		uint64_t indexVersion = 0; // Bumped on every change, tells Search its previous results are stale.
+
+		std::string lastQuery;
+		uint64_t lastIndexVersion = UINT64_MAX;
+		std::vector<Match> results;
+
+		void Add(const Process& process, uint64_t version);
+		void Remove(uint32_t entry);
+		void IndexTrigrams(uint32_t entry);
+		void RebuildTrigrams();
+		void RankNames();
+
+		struct Query {
+			std::string text; // Lowercase.
+			uint64_t chars = 0;
+			bool digits = false; // Could be a PID.
+		};
+
+		/// How well `entry` matches `query`, or -1 if it does not. Command lines are only searched if `commandLine` is set.
+		int Score(const Entry& entry, const Query& query, bool commandLine) const;
+	};
+}
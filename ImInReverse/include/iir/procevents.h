@@ -0,0 +1,89 @@
+#pragma once
+
+// Kept free of platform headers so every backend can include it
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace IIR {
+	struct Process {
+		std::string name;
+		uint32_t pid;
+		std::string commandLine; // Empty if it could not be read.
+	};
+
+	struct ProcessEvent {
+		enum class Kind {
+			created,
+			exited,
+			exec, // The process now runs a different image, `name` is the new one.
+		};
+
+		Kind kind;
+		Process process;
+	};
+
+	/// <summary>
+	/// Watches the system for processes starting and exiting. Each platform has its own backend, see Create.
+	/// Events are delivered in batches on a thread owned by the watcher.
+	/// </summary>
+	class ProcessWatcher {
+	public:
+		using Callback = std::function<void(std::span<const ProcessEvent>)>;
+		/// Gets a fresh Scan that replaces the whole list, called on the event thread when events were lost.
+		using ResyncCallback = std::function<void(std::vector<Process>)>;
+
+		virtual ~ProcessWatcher() = default;
+
+		/// Lists every process running right now.
+		virtual std::vector<Process> Scan() = 0;
+
+		/// <summary>
+		/// Starts delivering events to `callback`. Start before scanning so processes that start in between are not missed,
+		/// events that repeat what the scan saw are harmless (see ApplyProcessEvents).
+		/// </summary>
+		/// <returns>False if the watcher could not be started, the list then stays as scanned.</returns>
+		virtual bool Start(Callback callback) = 0;
+
+		/// Stops delivering events, the callback is not called again once this returns.
+		virtual void Stop() = 0;
+
+		/// Set before Start. Backends that can lose events call it after they did, the others never do.
+		void SetResyncCallback(ResyncCallback callback) { resync = std::move(callback); }
+
+		/// Short description of how events are received, for the log.
+		virtual const char* Describe() const = 0;
+
+		/// The best backend for this platform.
+		static std::unique_ptr<ProcessWatcher> Create();
+
+	protected:
+		ResyncCallback resync;
+	};
+
+	/// Applies a batch of events to a process list.
+	inline void ApplyProcessEvents(std::vector<Process>& processes, std::span<const ProcessEvent> events) {
+		for (const auto& event : events) {
+			auto it = std::find_if(processes.begin(), processes.end(), [&](const Process& p) { return p.pid == event.process.pid; });
+
+			switch (event.kind) {
+			case ProcessEvent::Kind::created:
+			case ProcessEvent::Kind::exec:
+				if (it == processes.end()) {
+					processes.push_back(event.process);
+					break;
+				}
+				it->name = event.process.name;
+				if (!event.process.commandLine.empty()) it->commandLine = event.process.commandLine;
+				break;
+			case ProcessEvent::Kind::exited:
+				if (it != processes.end()) processes.erase(it);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace IIR {
+	enum class ProcessArch {
+		unknown,
+		x86,
+		x64,
+		arm,
+		arm64,
+	};
+
+	inline const char* ProcessArchName(ProcessArch arch) {
+		switch (arch) {
+		case ProcessArch::x86: return "x86";
+		case ProcessArch::x64: return "x64";
+		case ProcessArch::arm: return "ARM";
+		case ProcessArch::arm64: return "ARM64";
+		default: return "?";
+		}
+	}
+
+	/// <summary>
+	/// Details that help tell processes apart in the picker. Anything that could not be read is left at its default.
+	/// </summary>
+	struct ProcessInfo {
+		uint32_t pid = 0;
+		bool valid = false; // False if the process could not be queried at all, e.g. it has exited.
+		uint64_t memory = 0; // Resident bytes.
+		uint32_t threads = 0;
+		ProcessArch arch = ProcessArch::unknown;
+		std::chrono::system_clock::time_point started{};
+		std::string user;
+		std::string commandLine;
+
+		std::chrono::steady_clock::time_point collected{};
+	};
+
+	/// <summary>
+	/// Reads the details of every process in `pids`, appending one ProcessInfo per PID to `out`. Implemented once per platform.
+	/// Slow, it opens each process and may read several files, only ever called from the collector's thread.
+	/// </summary>
+	void QueryProcessInfo(std::span<const uint32_t> pids, std::vector<ProcessInfo>& out);
+
+	/// <summary>
+	/// Collects ProcessInfo on a background thread for the processes the UI is showing.
+	/// Each frame the UI asks for the PIDs on screen and calls Submit; details older than a couple of seconds are
+	/// read again while they stay on screen, and forgotten a while after they scroll out of view.
+	/// </summary>
+	class ProcessInfoCollector {
+	public:
+		using InfoMap = std::unordered_map<uint32_t, ProcessInfo>;
+
+		static ProcessInfoCollector& GetInstance();
+
+		void Init();
+
+		/// Asks for the details of `pid` to be kept fresh. UI thread only.
+		void Want(uint32_t pid) { pending.push_back(pid); }
+
+		/// Hands this frame's PIDs to the collector, it is only woken up if they changed.
+		void Submit();
+
+		/// Everything collected so far. Never blocks, hold on to the result for the rest of the frame.
+		std::shared_ptr<const InfoMap> Snapshot() const { return published.load(); }
+
+	private:
+		ProcessInfoCollector();
+		~ProcessInfoCollector();
+		ProcessInfoCollector(const ProcessInfoCollector&) = delete;
+		ProcessInfoCollector& operator=(const ProcessInfoCollector&) = delete;
+
+		// Details are read again once they are this old.
+		static constexpr auto timeToLive = std::chrono::seconds(2);
+		// Details of processes not asked for in this long are dropped.
+		static constexpr auto forgetAfter = std::chrono::seconds(30);
+
+		void UpdateFunction();
+
+		std::vector<uint32_t> pending;
+		std::vector<uint32_t> lastSubmitted; // UI thread only.
+
+		std::mutex wantedMtx;
+		std::condition_variable wantedChanged;
+		std::vector<uint32_t> wanted;
+		bool dirty = false;
+
+		std::atomic<std::shared_ptr<const InfoMap>> published;
+
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+	};
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace IIR {
+	/// <summary>
+	/// The last `capacity` durations of one step, in milliseconds. Written by a single thread, read by any.
+	/// </summary>
+	class TimingSeries {
+	public:
+		static constexpr size_t capacity = 256;
+
+		explicit TimingSeries(std::string_view name) : name(name) {}
+
+		const std::string& Name() const { return name; }
+
+		/// Adds a sample if profiling is enabled. Only ever call this from one thread per series.
+		void Record(float milliseconds);
+
+		/// Copies the samples out, oldest first.
+		/// <returns>The number of samples copied, fewer than `capacity` until the series has filled up.</returns>
+		size_t Copy(std::span<float, capacity> out) const;
+
+		/// How many samples were recorded in total.
+		uint64_t Count() const { return count.load(std::memory_order_acquire); }
+
+	private:
+		std::string name;
+		std::array<std::atomic<float>, capacity> samples{};
+		std::atomic<uint64_t> count = 0;
+	};
+
+	/// <summary>
+	/// A running total, e.g. bytes read. Any thread.
+	/// </summary>
+	class Counter {
+	public:
+		explicit Counter(std::string_view name) : name(name) {}
+
+		const std::string& Name() const { return name; }
+
+		/// Adds to the total if profiling is enabled.
+		void Add(uint64_t amount = 1);
+
+		uint64_t Total() const { return total.load(std::memory_order_relaxed); }
+
+	private:
+		std::string name;
+		std::atomic<uint64_t> total = 0;
+	};
+
+	/// <summary>
+	/// Owns every timing series and counter, by name. Recording is a single relaxed load while profiling is disabled.
+	/// Look a series up once and keep the reference, e.g. in a function local static; they live as long as the program.
+	/// </summary>
+	class Profiler {
+	public:
+		static Profiler& GetInstance();
+
+		static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+		static void SetEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+		/// The series called `name`, created the first time it is asked for. Any thread.
+		TimingSeries& GetTimer(std::string_view name);
+		/// The counter called `name`, created the first time it is asked for. Any thread.
+		Counter& GetCounter(std::string_view name);
+
+		/// Every series created so far, in the order they were.
+		std::vector<const TimingSeries*> Timers();
+		/// Every counter created so far, in the order they were.
+		std::vector<const Counter*> Counters();
+
+	private:
+		Profiler() = default;
+		~Profiler() = default;
+		Profiler(const Profiler&) = delete;
+		Profiler& operator=(const Profiler&) = delete;
+
+		static inline std::atomic<bool> enabled = false;
+
+		std::mutex mtx;
+		std::deque<TimingSeries> timers; // Deques, so references handed out stay valid as more are added.
+		std::deque<Counter> counters;
+	};
+
+	/// <summary>
+	/// Records how long the scope it lives in took into a series.
+	/// </summary>
+	class ScopedTimer {
+	public:
+		explicit ScopedTimer(TimingSeries& series) : series(Profiler::IsEnabled() ? &series : nullptr) {
+			if (this->series) start = std::chrono::steady_clock::now();
+		}
+
+		~ScopedTimer() {
+			if (series) series->Record(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	private:
+		TimingSeries* series;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	inline void TimingSeries::Record(float milliseconds) {
+		if (!Profiler::IsEnabled()) return;
+		uint64_t index = count.load(std::memory_order_relaxed);
+		samples[index % capacity].store(milliseconds, std::memory_order_relaxed);
+		count.store(index + 1, std::memory_order_release);
+	}
+
+	inline void Counter::Add(uint64_t amount) {
+		if (Profiler::IsEnabled()) total.fetch_add(amount, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "pch.h"
+
+#include <filesystem>
+
+#include "iir/structure.h"
+#include "iir/mappedfile.h"
+
+namespace IIR {
+	/// <summary>
+	/// A project file mapped into memory. The header and class table are read when it is opened, the fields of a class
+	/// are only decoded when that class is first used, so opening a project costs the same no matter how big its classes are.
+	/// Decoding a class also walks the field records of the classes it embeds, to catch embeds that lead back to it.
+	/// </summary>
+	/// <remarks>
+	/// Layout, all little endian and 8-byte aligned:
+	///   Header
+	///   TypeName[typeCount]       Names of the field types used in the file, field records refer to these by index.
+	///   ClassRecord[classCount]
+	///   FieldRecord[fieldCount]   Fields of each class, in order and contiguous.
+	///   char[stringBytes]         Every string, referenced by offset and length.
+	/// Types are stored by name so reordering FieldType never breaks old projects.
+	/// </remarks>
+	class ProjectFile {
+	public:
+		static constexpr uint32_t magic = 0x50524949; // "IIRP"
+		static constexpr uint32_t version = 2; // 2 added field names.
+
+		struct StringRef {
+			uint32_t offset;
+			uint32_t length;
+		};
+
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t typeCount;
+			uint32_t classCount;
+			uint64_t fieldCount;
+			uint64_t stringBytes;
+			uint64_t base;
+			uint32_t currentClass;
+			uint32_t reserved;
+		};
+
+		struct TypeName {
+			char name[16]; // Null padded.
+		};
+
+		struct ClassRecord {
+			StringRef name;
+			StringRef address;
+			StringRef notes;
+			uint64_t firstField;
+			uint32_t fieldCount;
+			uint32_t reserved;
+		};
+
+		struct FieldRecord {
+			uint64_t offset;
+			int32_t size;
+			int32_t classIndex;
+			uint32_t type; // Index into the file's type names.
+			uint32_t reserved;
+			StringRef name; // Not present in version 1.
+		};
+
+		/// <summary>
+		/// Maps a project file and checks that every table fits in it.
+		/// </summary>
+		/// <returns>The mapped file, or nullptr if it could not be opened or is not a valid project.</returns>
+		static std::shared_ptr<const ProjectFile> Open(const std::filesystem::path& path);
+
+		ProjectFile(const ProjectFile&) = delete;
+		ProjectFile& operator=(const ProjectFile&) = delete;
+
+		const Header& GetHeader() const { return *header; }
+		const ClassRecord& GetClassRecord(size_t classIndex) const { return classRecords[classIndex]; }
+		std::string_view GetString(StringRef ref) const { return std::string_view(strings + ref.offset, ref.length); }
+
+		/// Decodes the fields of one class.
+		FieldList ReadFields(size_t classIndex) const;
+		/// The size of one class from its last field record, without decoding the others.
+		size_t ClassSize(size_t classIndex) const;
+
+	private:
+		ProjectFile() = default;
+
+		FieldRecord GetFieldRecord(uint64_t index) const;
+		/// The class a field record embeds, or -1 if it is not a valid embedded instance.
+		int32_t EmbeddedClass(const FieldRecord& f) const;
+		/// True if `from` embeds `target`, directly or through other classes, going by the field records alone.
+		/// `visited` is shared between calls with the same target, classes seen before are not walked again.
+		bool EmbedsRecord(uint32_t from, uint32_t target, std::vector<uint8_t>& visited) const;
+
+		std::shared_ptr<const MappedFile> file;
+
+		const Header* header = nullptr;
+		const ClassRecord* classRecords = nullptr;
+		const uint8_t* fieldRecords = nullptr;
+		size_t fieldStride = sizeof(FieldRecord); // Records were smaller in older versions.
+		const TypeName* typeNames = nullptr;
+		const char* strings = nullptr;
+		std::vector<FieldType> types; // File type index to FieldType.
+	};
+
+	/// <summary>
+	/// Writes every class to a project file. The file is written next to the target and moved over it, so a failed save never
+	/// leaves a half written project behind.
+	/// </summary>
+	bool SaveProject(const StructureManager& sm, const std::filesystem::path& path);
+
+	/// <summary>
+	/// Replaces every class with the ones in a project file. Fields are decoded lazily, see ProjectFile.
+	/// </summary>
+	bool LoadProject(StructureManager& sm, const std::filesystem::path& path);
+
+	/// <summary>
+	/// Writes every class as indented JSON with one field per line, meant for diffing and review rather than loading.
+	/// </summary>
+	bool ExportProjectJson(const StructureManager& sm, const std::filesystem::path& path);
+}
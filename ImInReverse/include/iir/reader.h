@@ -0,0 +1,140 @@
+#pragma once
+
+#include "pch.h"
+
+#include "iir/expression.h"
+
+namespace IIR {
+	/// <summary>
+	/// An immutable copy of every range the UI asked for, taken in one pass of the reader thread.
+	/// Requests are sorted and coalesced so nearby ranges cost a single read.
+	/// </summary>
+	struct MemorySnapshot {
+		struct Span {
+			uintptr_t address = 0;
+			size_t size = 0;
+			size_t dataOffset = 0; // Where this span's bytes start in `data`.
+			bool valid = false; // False if the range could not be read.
+		};
+
+		/// The value an address expression had when the snapshot was taken.
+		struct Resolved {
+			std::shared_ptr<const AddressExpression> expression;
+			std::optional<uintptr_t> value; // Nullopt if a name was unknown or a pointer on the way could not be read.
+		};
+
+		/// Bumped only when the set of spans, any of their bytes or any resolved address changed.
+		uint64_t generation = 0;
+		std::vector<Span> spans;
+		std::vector<uint8_t> data;
+		std::vector<Resolved> resolved;
+
+		/// Looks up what `expression` evaluated to, nullptr if it was not asked for when the snapshot was taken.
+		const Resolved* FindResolved(const AddressExpression* expression) const {
+			auto it = std::find_if(resolved.begin(), resolved.end(), [&](const Resolved& r) { return r.expression.get() == expression; });
+			return it == resolved.end() ? nullptr : &*it;
+		}
+
+		/// <summary>
+		/// Looks up a range in the snapshot.
+		/// </summary>
+		/// <returns>A pointer to the bytes, or nullptr if the range was not requested or could not be read.</returns>
+		const uint8_t* Find(uintptr_t address, size_t size) const {
+			auto it = std::upper_bound(spans.begin(), spans.end(), address,
+				[](uintptr_t addr, const Span& span) { return addr < span.address; });
+			if (it == spans.begin()) return nullptr;
+
+			const Span& span = *std::prev(it);
+			if (!span.valid || address + size > span.address + span.size) return nullptr;
+			return data.data() + span.dataOffset + (address - span.address);
+		}
+	};
+
+	/// <summary>
+	/// Polls target memory on a background thread.
+	/// Each frame the UI requests the ranges it is about to draw and calls Submit; the reader keeps
+	/// reading the last submitted set and publishes a new snapshot whenever something changed.
+	/// </summary>
+	class MemoryReader {
+	public:
+		static MemoryReader& GetInstance();
+
+		void Init();
+
+		/// Latches the newest snapshot for this frame. Pointers returned by Frame().Find stay valid until the next call.
+		void BeginFrame() { frame = latest.load(); }
+		const MemorySnapshot& Frame() const { return *frame; }
+		/// Keeps this frame's snapshot alive for as long as the caller holds on to it.
+		std::shared_ptr<const MemorySnapshot> FrameHandle() const { return frame; }
+		/// The newest snapshot published, which the next BeginFrame will latch. Any thread.
+		std::shared_ptr<const MemorySnapshot> Latest() const { return latest.load(); }
+
+		/// Asks for a range to be read from now on. UI thread only.
+		void Request(uintptr_t address, size_t size) {
+			if (size == 0) return;
+			pending.push_back({ address, size });
+		}
+
+		/// <summary>
+		/// Asks for `count` elements of `size` bytes spaced `stride` bytes apart, starting at `address`.
+		/// When the gaps are small enough to be read through, the whole run is requested as one range.
+		/// </summary>
+		void RequestStrided(uintptr_t address, size_t stride, size_t size, size_t count) {
+			if (count == 0 || size == 0) return;
+
+			if (stride <= size + mergeGap) {
+				Request(address, stride * (count - 1) + size);
+				return;
+			}
+
+			for (size_t i = 0; i < count; i++)
+				Request(address + i * stride, size);
+		}
+
+		/// <summary>
+		/// Asks for `expression` to be evaluated on every pass from now on, its value shows up in the snapshots' `resolved`.
+		/// Pointer chains are followed by the reader thread, with the reads at each depth of every expression batched together. UI thread only.
+		/// </summary>
+		void Resolve(std::shared_ptr<const AddressExpression> expression) {
+			pendingExpressions.push_back(std::move(expression));
+		}
+
+		/// Hands this frame's requests to the reader thread.
+		void Submit();
+
+		uint64_t GetGeneration() const { return frame->generation; }
+
+	private:
+		MemoryReader();
+		~MemoryReader();
+		MemoryReader(const MemoryReader&) = delete;
+		MemoryReader& operator=(const MemoryReader&) = delete;
+
+		struct Range {
+			uintptr_t address;
+			size_t size;
+		};
+
+		// Gaps smaller than this between two requests are read through rather than paying for another call.
+		static constexpr size_t mergeGap = 512;
+
+		void UpdateFunction();
+		std::shared_ptr<MemorySnapshot> ReadRanges(HANDLE handle, std::vector<Range> ranges);
+		/// Reads a batch of pointers, nearby ones share a single read.
+		static void ReadScatter(HANDLE handle, std::span<ScatterRead> reads);
+		std::vector<MemorySnapshot::Resolved> ResolveExpressions(HANDLE handle, std::vector<std::shared_ptr<const AddressExpression>> expressions);
+
+		std::vector<Range> pending;
+		std::vector<std::shared_ptr<const AddressExpression>> pendingExpressions;
+
+		std::mutex requestMtx;
+		std::vector<Range> submitted;
+		std::vector<std::shared_ptr<const AddressExpression>> submittedExpressions;
+
+		std::atomic<std::shared_ptr<const MemorySnapshot>> latest;
+		std::shared_ptr<const MemorySnapshot> frame;
+
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+	};
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "pch.h"
+
+#include <unordered_map>
+
+namespace IIR {
+	/// <summary>
+	/// One committed region of the target's address space, as reported by VirtualQueryEx.
+	/// </summary>
+	struct MemoryRegion {
+		uintptr_t base = 0;
+		size_t size = 0;
+		uintptr_t allocationBase = 0; // Base of the module for image regions.
+		DWORD protect = 0;
+		DWORD type = 0; // MEM_IMAGE, MEM_MAPPED or MEM_PRIVATE.
+
+		bool IsReadable() const {
+			if (protect & (PAGE_GUARD | PAGE_NOACCESS)) return false;
+			return protect & (PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
+		}
+
+		bool IsWritable() const {
+			return protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
+		}
+
+		bool IsExecutable() const {
+			return protect & (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
+		}
+
+		bool IsImage() const { return type == MEM_IMAGE; }
+	};
+
+	/// <summary>
+	/// Every committed region of the target at one point in time, sorted by address.
+	/// Lookups are a binary search, so classifying a value as a pointer never needs a syscall.
+	/// </summary>
+	struct RegionSnapshot {
+		std::vector<MemoryRegion> regions;
+		std::unordered_map<uintptr_t, std::string> mappedFiles; // Device path of the file behind each MEM_MAPPED allocation, by allocation base.
+
+		/// Returns the region containing `address`, or nullptr if it is not committed.
+		const MemoryRegion* Find(uintptr_t address) const {
+			auto it = std::upper_bound(regions.begin(), regions.end(), address,
+				[](uintptr_t addr, const MemoryRegion& region) { return addr < region.base; });
+			if (it == regions.begin()) return nullptr;
+
+			const MemoryRegion& region = *std::prev(it);
+			return address < region.base + region.size ? &region : nullptr;
+		}
+
+		/// True if `value` points into readable memory.
+		bool IsPointer(uintptr_t value) const {
+			if (value < 0x10000) return false;
+
+			const MemoryRegion* region = Find(value);
+			return region && region->IsReadable();
+		}
+
+		/// The file `region` is a view of, or nullptr if it is not a mapped file.
+		const std::string* MappedFile(const MemoryRegion& region) const {
+			if (region.type != MEM_MAPPED) return nullptr;
+			auto it = mappedFiles.find(region.allocationBase);
+			return it != mappedFiles.end() ? &it->second : nullptr;
+		}
+	};
+
+	/// <summary>
+	/// Keeps a map of the target's address space up to date on a background thread.
+	/// Walking the address space takes thousands of VirtualQueryEx calls, so it is done once a second (and straight away
+	/// when the process changes) instead of once per value that needs checking. Mapped file names are only queried for
+	/// allocations that were not there on the previous walk.
+	/// </summary>
+	class RegionMap {
+	public:
+		static RegionMap& GetInstance();
+
+		void Init();
+
+		/// The latest map. Safe to call from any thread, the snapshot never changes once published.
+		std::shared_ptr<const RegionSnapshot> Get() const { return latest.load(); }
+
+		/// Asks for the map to be rebuilt as soon as possible, e.g. after the target allocated memory we want to see.
+		void Invalidate() { stale = true; }
+
+	private:
+		RegionMap();
+		~RegionMap();
+		RegionMap(const RegionMap&) = delete;
+		RegionMap& operator=(const RegionMap&) = delete;
+
+		static constexpr auto refreshInterval = std::chrono::seconds(1);
+
+		void UpdateFunction();
+		static std::shared_ptr<RegionSnapshot> Walk(HANDLE handle, const RegionSnapshot& previous);
+
+		std::atomic<std::shared_ptr<const RegionSnapshot>> latest;
+		std::atomic<bool> stale = true;
+
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+	};
+}
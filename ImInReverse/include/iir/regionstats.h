@@ -0,0 +1,76 @@
+#pragma once
+
+#include "pch.h"
+
+#include <deque>
+#include <unordered_map>
+
+#include "iir/regions.h"
+
+namespace IIR {
+	/// <summary>
+	/// What is in one region, from its resident pages.
+	/// </summary>
+	struct RegionStats {
+		size_t resident = 0; // Bytes in the target's working set.
+		size_t sampled = 0; // Bytes read for the figures below, at most RegionStatsCollector::maxSampledPages pages.
+		float zeroFraction = 0.0f; // Of the sampled pages, how many are all zeros.
+		float entropy = 0.0f; // Shannon entropy of the sampled bytes, in bits per byte.
+	};
+
+	/// <summary>
+	/// Works out RegionStats for the regions a view asks about on a background thread, and keeps them until the region
+	/// changes (moves, grows, shrinks or gets another protection) or goes away.
+	/// Only resident pages are read, reading the others would page them in and change what is being measured.
+	/// </summary>
+	class RegionStatsCollector {
+	public:
+		// Pages read per region at most, spread evenly over its resident pages
+		static constexpr size_t maxSampledPages = 1024;
+
+		static RegionStatsCollector& GetInstance();
+
+		void Init();
+
+		/// <summary>
+		/// The stats of `region`, or nullptr if they are not known yet, in which case they are worked out next.
+		/// Regions asked about last are done first, so the rows on screen come in before the ones scrolled past.
+		/// </summary>
+		std::shared_ptr<const RegionStats> Get(const MemoryRegion& region);
+
+		/// Bumped whenever stats come in or are thrown away. Safe to call from any thread.
+		uint64_t Version() const { return version.load(std::memory_order_acquire); }
+
+	private:
+		RegionStatsCollector();
+		~RegionStatsCollector();
+		RegionStatsCollector(const RegionStatsCollector&) = delete;
+		RegionStatsCollector& operator=(const RegionStatsCollector&) = delete;
+
+		// Requests beyond this are dropped oldest first, they were scrolled past long ago
+		static constexpr size_t maxPending = 512;
+
+		struct Entry {
+			MemoryRegion region; // As it was when measured, the stats are stale once it differs.
+			std::shared_ptr<const RegionStats> stats; // Null while pending.
+		};
+
+		void UpdateFunction();
+		static std::shared_ptr<const RegionStats> Measure(HANDLE handle, const MemoryRegion& region);
+		/// Drops the stats of regions that are not in `regions` as they were measured.
+		void Prune(const RegionSnapshot& regions);
+
+		static bool SameRegion(const MemoryRegion& a, const MemoryRegion& b) {
+			return a.base == b.base && a.size == b.size && a.protect == b.protect && a.type == b.type;
+		}
+
+		std::mutex mtx; // Guards `entries` and `pending`.
+		std::unordered_map<uintptr_t, Entry> entries; // By region base.
+		std::deque<MemoryRegion> pending; // Newest last.
+
+		std::atomic<uint64_t> version = 0;
+
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+	};
+}
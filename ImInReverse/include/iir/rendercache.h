@@ -0,0 +1,217 @@
+#pragma once
+
+#include "pch.h"
+
+#include "iir/symbols.h"
+#include "iir/structure.h"
+#include "iir/textformat.h"
+
+namespace IIR {
+	/// <summary>
+	/// Pre-formatted text of one memory pane row. The strings live in the cache's arena and are only valid until the next Get call.
+	/// </summary>
+	struct FieldText {
+		struct Ref {
+			uint32_t begin = 0, end = 0;
+		};
+
+		// Rows are keyed by all four, the same address can be shown at different offsets (e.g. under two pointers)
+		uintptr_t address = 0;
+		size_t fieldOffset = 0;
+		int size = 0;
+		FieldType fieldType = FieldType::unk;
+
+		uint64_t generation = 0; // Snapshot generation the text was last checked against.
+		uint64_t labelsVersion = 0; // Modules and symbols the pointers were labelled with.
+		bool hasData = false;
+		uint8_t bytes[64] = {}; // The bytes the text was built from, compared when the generation moves on.
+
+		Ref offset, addressText, ascii, hex, numeric, pointer;
+	};
+
+	/// <summary>
+	/// Caches the formatted text of the rows drawn in the memory pane.
+	/// A row is only reformatted when the snapshot generation moved on and its own bytes actually changed;
+	/// otherwise last frame's text is carried over. Pointers into modules are also labelled ("module!export+0x10"), those rows
+	/// are reformatted when a module is loaded or unloaded or its exports are read. Text is kept in a per-frame arena holding just the rows drawn
+	/// that frame, so the cache never grows past what fits on screen.
+	/// </summary>
+	class FieldTextCache {
+	public:
+		static FieldTextCache& GetInstance() {
+			static FieldTextCache instance;
+			return instance;
+		}
+
+		std::string_view View(FieldText::Ref ref) const {
+			return std::string_view(arena.data() + ref.begin, ref.end - ref.begin);
+		}
+
+		/// <summary>
+		/// Returns the text for a row, formatting it only if needed.
+		/// </summary>
+		/// <param name="field">The field drawn on the row.</param>
+		/// <param name="address">The absolute address of the field.</param>
+		/// <param name="data">The field's bytes from the current snapshot, or nullptr if unreadable.</param>
+		/// <param name="generation">The generation of the current snapshot.</param>
+		/// <param name="labels">Labels pointers into the target's modules.</param>
+		/// <param name="isPointer">Called with 8-byte values of untyped fields when they need reformatting.</param>
+		template<typename IsPointer>
+		const FieldText& Get(const Field& field, uintptr_t address, const uint8_t* data, uint64_t generation, const PointerLabels& labels, IsPointer&& isPointer) {
+			size_t byteCount = static_cast<size_t>(std::min(field.size, static_cast<int>(sizeof(FieldText::bytes))));
+
+			const FieldText* cached = Find(previous, address, field.offset, field.size, field.fieldType);
+			bool reuse = cached && cached->hasData == (data != nullptr) && cached->labelsVersion == labels.Version() &&
+				(cached->generation == generation || !data || std::memcmp(cached->bytes, data, byteCount) == 0);
+
+			FieldText& text = Insert(address, field.offset, field.size, field.fieldType);
+			if (reuse) {
+				// Carry the old strings into this frame's arena, much cheaper than formatting them again
+				const auto& oldArena = previousArena;
+				auto carry = [&](FieldText::Ref ref) { return Append(std::string_view(oldArena.data() + ref.begin, ref.end - ref.begin)); };
+
+				text = *cached;
+				text.generation = generation;
+				text.offset = carry(cached->offset);
+				text.addressText = carry(cached->addressText);
+				text.ascii = carry(cached->ascii);
+				text.hex = carry(cached->hex);
+				text.numeric = carry(cached->numeric);
+				text.pointer = carry(cached->pointer);
+				return text;
+			}
+
+			text.generation = generation;
+			text.labelsVersion = labels.Version();
+			text.hasData = data != nullptr;
+			if (data) std::memcpy(text.bytes, data, byteCount);
+
+			char buf[512];
+			text.offset = Append(TextWriter(buf, sizeof(buf)).Hex(field.offset, 4).View());
+			text.addressText = Append(TextWriter(buf, sizeof(buf)).Hex(address, 12).View());
+
+			if (!data) {
+				text.ascii = text.hex = text.numeric = text.pointer = Append("");
+				return text;
+			}
+
+			// Matrices are wider than a row, only the leading bytes are shown
+			size_t shownBytes = std::min<size_t>(byteCount, 32);
+
+			// Text and hex views of the bytes, encoded straight into the arena
+			text.ascii = Reserve(shownBytes);
+			FormatAsciiBytes(data, shownBytes, arena.data() + text.ascii.begin);
+			text.hex = Reserve(shownBytes * 3);
+			FormatHexBytes(data, shownBytes, arena.data() + text.hex.begin);
+
+			// Value view, one call through the type's formatter
+			int length = GetFieldTypeInfo(field.fieldType).format(data, field.size, buf, sizeof(buf));
+			text.numeric = Append(std::string_view(buf, length));
+
+			// Untyped 8 byte fields that look like pointers get a hint, pointers into modules say where they point
+			length = 0;
+			if (field.size == 8 && (field.fieldType == FieldType::unk || field.fieldType == FieldType::pointer)) {
+				uint64_t value;
+				std::memcpy(&value, data, sizeof(value));
+				if (field.fieldType == FieldType::pointer) {
+					length = labels.Label(static_cast<uintptr_t>(value), buf, sizeof(buf));
+				}
+				else if (isPointer(value)) {
+					length = GetFieldTypeInfo(FieldType::pointer).format(data, field.size, buf, sizeof(buf));
+					int symbol = labels.Label(static_cast<uintptr_t>(value), buf + length + 1, sizeof(buf) - length - 1);
+					if (symbol > 0) {
+						buf[length] = ' ';
+						length += 1 + symbol;
+					}
+				}
+			}
+			text.pointer = Append(std::string_view(buf, length));
+
+			return text;
+		}
+
+		/// Drops every row that was not drawn this frame. Call once per frame after the pane is drawn.
+		void EndFrame() {
+			std::swap(previous, current);
+			std::swap(previousArena, arena);
+			current.entries.clear();
+			std::fill(current.slots.begin(), current.slots.end(), emptySlot);
+			arena.clear();
+		}
+
+	private:
+		FieldTextCache() = default;
+		~FieldTextCache() = default;
+		FieldTextCache(const FieldTextCache&) = delete;
+		FieldTextCache& operator=(const FieldTextCache&) = delete;
+
+		static constexpr uint32_t emptySlot = UINT32_MAX;
+
+		/// Open addressing table of one frame's rows.
+		struct Table {
+			std::vector<FieldText> entries;
+			std::vector<uint32_t> slots; // Indices into `entries`, power of two sized.
+		};
+
+		Table previous, current;
+		std::vector<char> arena, previousArena;
+
+		static size_t Hash(uintptr_t address, size_t offset, int size, FieldType type) {
+			uint64_t h = static_cast<uint64_t>(address ^ (static_cast<uint64_t>(offset) << 40)) * 0x9E3779B97F4A7C15ull;
+			h ^= (static_cast<uint64_t>(size) << 8 | static_cast<uint64_t>(type)) * 0xC2B2AE3D27D4EB4Full;
+			return static_cast<size_t>(h ^ (h >> 29));
+		}
+
+		static const FieldText* Find(const Table& table, uintptr_t address, size_t offset, int size, FieldType type) {
+			if (table.slots.empty()) return nullptr;
+
+			size_t mask = table.slots.size() - 1;
+			for (size_t i = Hash(address, offset, size, type) & mask;; i = (i + 1) & mask) {
+				uint32_t slot = table.slots[i];
+				if (slot == emptySlot) return nullptr;
+
+				const auto& entry = table.entries[slot];
+				if (entry.address == address && entry.fieldOffset == offset && entry.size == size && entry.fieldType == type) return &entry;
+			}
+		}
+
+		FieldText& Insert(uintptr_t address, size_t offset, int size, FieldType type) {
+			if (const FieldText* existing = Find(current, address, offset, size, type)) {
+				// Drawn twice in one frame (e.g. the same object open under two pointers), just reformat
+				return const_cast<FieldText&>(*existing);
+			}
+
+			// Keep the load factor under one half
+			if ((current.entries.size() + 1) * 2 > current.slots.size()) {
+				current.slots.assign(std::max<size_t>(64, current.slots.size() * 2), emptySlot);
+				for (uint32_t e = 0; e < current.entries.size(); e++)
+					Place(current, e);
+			}
+
+			current.entries.push_back(FieldText{ address, offset, size, type });
+			Place(current, static_cast<uint32_t>(current.entries.size() - 1));
+			return current.entries.back();
+		}
+
+		static void Place(Table& table, uint32_t entry) {
+			const auto& e = table.entries[entry];
+			size_t mask = table.slots.size() - 1;
+			size_t i = Hash(e.address, e.fieldOffset, e.size, e.fieldType) & mask;
+			while (table.slots[i] != emptySlot) i = (i + 1) & mask;
+			table.slots[i] = entry;
+		}
+
+		FieldText::Ref Append(std::string_view str) {
+			uint32_t begin = static_cast<uint32_t>(arena.size());
+			arena.insert(arena.end(), str.begin(), str.end());
+			return { begin, static_cast<uint32_t>(arena.size()) };
+		}
+
+		/// Makes room for `count` characters at the end of the arena, to be written in place.
+		FieldText::Ref Reserve(size_t count) {
+			uint32_t begin = static_cast<uint32_t>(arena.size());
+			arena.resize(arena.size() + count);
+			return { begin, static_cast<uint32_t>(arena.size()) };
+		}
+	};
+}
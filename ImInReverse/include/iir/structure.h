@@ -2,7 +2,11 @@
 
 #include "pch.h"
 
+#include <deque>
+
 #include "iir/process.h"
+#include "iir/persistent.h"
+#include "iir/fieldtypes.h"
 
 namespace IIR {
 	// union for easily reading memory as a bunch of different types
@@ -20,21 +24,6 @@ namespace IIR {
 		const char* str;
 	};
 
-	enum class FieldType {
-		u8,
-		u16,
-		u32,
-		u64,
-		i8,
-		i16,
-		i32,
-		i64,
-		f32,
-		f64,
-		str,
-		unk
-	};
-
 	/// <summary>
 	/// The field type is simply used to index into the main type. It is not useful by itself as it does not contain the data of the memory.
 	/// </summary>
@@ -42,16 +31,50 @@ namespace IIR {
 		FieldType fieldType = FieldType::unk;
 		size_t offset = 0;
 		int size = 8; // Size of field in bytes.
-		//std::string display = ""; TODO: Caching
+		int32_t classIndex = -1; // Target class of instance/pointer fields, -1 otherwise.
+		std::string name; // Optional, e.g. the member name from debug info.
+
+		bool IsExpandable() const {
+			return (fieldType == FieldType::instance || fieldType == FieldType::pointer) && classIndex >= 0;
+		}
 	};
 
+	using FieldList = PersistentSequence<Field>;
+
 	struct Structure {
-		std::vector<Field> fields = {
-			{ FieldType::unk, 0, 8 },
-			{ FieldType::unk, 8, 8 },
-			{ FieldType::unk, 16, 8 },
-			{ FieldType::unk, 24, 8 }
-		};
+		std::string name = "unnamed";
+		std::string address; // Address expression the class was last viewed at.
+		std::string notes;
+		FieldList fields = DefaultFields();
+
+		/// Set for classes loaded from a project until their fields are first needed, see StructureManager::GetClass.
+		std::function<FieldList()> loadFields;
+		size_t loadedSize = 0; // TotalSize of what loadFields will return, so lists of classes need not decode them.
+
+		/// The layout of a new class. Every class starts out sharing the same nodes.
+		static const FieldList& DefaultFields() {
+			static const FieldList fields = {
+				{ FieldType::unk, 0, 8 },
+				{ FieldType::unk, 8, 8 },
+				{ FieldType::unk, 16, 8 },
+				{ FieldType::unk, 24, 8 }
+			};
+			return fields;
+		}
+
+		size_t TotalSize() const {
+			if (fields.Empty()) return 0;
+			const auto& last = fields.Back();
+			return last.offset + last.size;
+		}
+	};
+
+	/// <summary>
+	/// One place in memory viewed as a class. Instances only refer to their class, every instance of a class reads through the same layout.
+	/// </summary>
+	struct Instance {
+		size_t classIndex = 0;
+		uintptr_t base = 0;
 	};
 
 	class StructureManager {
@@ -62,122 +85,260 @@ namespace IIR {
 		}
 
 		void Init() {
-			mem.resize(size);
+			Publish();
+		}
+
+		void SetBase(uintptr_t newBase) { shown.base = newBase; }
+		uintptr_t GetBase() const { return shown.base; }
+		void SetName(std::string_view newName) { Current().name = newName; }
+		std::string& GetName() { return Current().name; }
+		size_t GetSize() { return Current().TotalSize(); }
+
+		void SetAddress(std::string_view expression) { Current().address = expression; }
+		const std::string& GetAddress() { return Current().address; }
+		void SetNotes(std::string_view newNotes) { Current().notes = newNotes; }
+		const std::string& GetNotes() { return Current().notes; }
+
+		size_t ClassCount() const { return classes.size(); }
+
+		/// The name of a class, without decoding its fields. Use this over GetClass when listing every class.
+		const std::string& ClassName(size_t classIndex) const { return classes[classIndex].name; }
+		/// The size of a class, without decoding its fields.
+		size_t ClassSize(size_t classIndex) const {
+			const auto& cls = classes[classIndex];
+			return cls.loadFields ? cls.loadedSize : cls.TotalSize();
+		}
 
-			this->running = true;
-			this->hUpdateThread = std::thread(&StructureManager::UpdateFunction, this);
+		/// Classes loaded from a project only decode their fields the first time they are looked at.
+		const Structure& GetClass(size_t classIndex) const {
+			auto& cls = classes[classIndex];
+			if (cls.loadFields) {
+				cls.fields = cls.loadFields();
+				cls.loadFields = nullptr;
+			}
+			return cls;
 		}
+		size_t GetCurrentClass() const { return shown.classIndex; }
 
-		void SetBase(uintptr_t newBase) { this->baseAddr = newBase; }
-		uintptr_t GetBase() { return baseAddr; }
-		void SetName(std::string_view newName) { this->name = newName; }
-		std::string& GetName() { return this->name; }
-		size_t GetSize() { return this->size; }
+		/// The instance the memory pane shows, its class is the one being edited.
+		const Instance& GetShown() const { return shown; }
 
-		MemoryData* GetFieldData(const Field& field) {
-			if (field.offset + sizeof(MemoryData) > mem.size()) return nullptr;
-			return reinterpret_cast<MemoryData*>(mem.data() + field.offset);
+		/// Switches which class is being edited and shown at the base address.
+		void SelectClass(size_t classIndex) {
+			if (classIndex >= classes.size() || classIndex == shown.classIndex) return;
+			shown.classIndex = classIndex;
+			Publish();
+		}
+
+		/// <summary>
+		/// Replaces every class, e.g. with the contents of a project. The undo history is cleared.
+		/// </summary>
+		void LoadClasses(std::vector<Structure> loaded, size_t current, uintptr_t base) {
+			if (loaded.empty()) loaded.emplace_back();
+
+			classes = std::move(loaded);
+			shown = { std::min(current, classes.size() - 1), base };
+			instances.clear();
+			instancesVersion++;
+			undoStack.clear();
+			redoStack.clear();
+			Publish();
 		}
 
-		std::vector<Field>& GetFields() {
-			return this->currentStructure.fields;
+		/// Creates a new class with the default layout and returns its index.
+		size_t AddClass(std::string_view newName) {
+			return AddClass(newName, Structure::DefaultFields());
+		}
+
+		/// Creates a new class with the given layout, e.g. one imported from debug info, and returns its index.
+		size_t AddClass(std::string_view newName, FieldList layout) {
+			Structure structure;
+			structure.name = newName;
+			structure.fields = std::move(layout);
+			classes.push_back(std::move(structure));
+			return classes.size() - 1;
+		}
+
+		/// Replaces the layout of a class without recording an undo step. Meant for classes that were just created.
+		void SetClassFields(size_t classIndex, FieldList layout) {
+			classes[classIndex].fields = std::move(layout);
+			classes[classIndex].loadFields = nullptr;
+			if (classIndex == shown.classIndex) Publish();
+		}
+
+		/// <summary>
+		/// Watches another instance of a class. Instances are just a class index and an address, so watching hundreds
+		/// of them costs no more than the list itself.
+		/// </summary>
+		/// <returns>The index of the new instance.</returns>
+		size_t AddInstance(size_t classIndex, uintptr_t base) {
+			instances.push_back({ classIndex, base });
+			instancesVersion++;
+			return instances.size() - 1;
+		}
+
+		void RemoveInstance(size_t index) {
+			if (index >= instances.size()) return;
+			instances.erase(instances.begin() + index);
+			instancesVersion++;
+		}
+
+		/// Stops watching every instance of `classIndex`.
+		void ClearInstances(size_t classIndex) {
+			std::erase_if(instances, [classIndex](const Instance& i) { return i.classIndex == classIndex; });
+			instancesVersion++;
+		}
+
+		/// Every watched instance, not including the shown one.
+		const std::vector<Instance>& GetInstances() const { return instances; }
+
+		/// Appends the base of every watched instance of `classIndex` to `out`.
+		void GetInstanceBases(size_t classIndex, std::vector<uintptr_t>& out) const {
+			for (const auto& instance : instances) {
+				if (instance.classIndex == classIndex) out.push_back(instance.base);
+			}
+		}
+
+		/// Bumped whenever an instance is added or removed.
+		uint64_t GetInstancesVersion() const { return instancesVersion; }
+
+		/// True if `classIndex` contains `target` inline, directly or through other embedded classes.
+		bool Embeds(size_t classIndex, size_t target) const {
+			if (classIndex == target) return true;
+
+			bool found = false;
+			GetClass(classIndex).fields.ForEach([&](const Field& f) {
+				if (!found && f.fieldType == FieldType::instance && f.classIndex >= 0)
+					found = Embeds(static_cast<size_t>(f.classIndex), target);
+			});
+			return found;
+		}
+
+		/// The current layout as seen by the UI thread. Copying it is O(1) and the copy never changes.
+		const FieldList& GetFields() const {
+			return Current().fields;
+		}
+
+		/// A snapshot of the current layout that is safe to take from any thread.
+		FieldList GetLayout() const {
+			std::lock_guard<std::mutex> lock(layoutMtx);
+			return publishedLayout;
+		}
+
+		/// Returns the index of the field starting exactly at `offset`, if any.
+		std::optional<size_t> FindField(size_t offset) const {
+			const auto& fields = GetFields();
+			size_t idx = fields.PartitionPoint([offset](const Field& f) { return f.offset < offset; });
+			if (idx >= fields.Size() || fields[idx].offset != offset) return std::nullopt;
+			return idx;
+		}
+
+		bool CanUndo() const { return !undoStack.empty(); }
+		bool CanRedo() const { return !redoStack.empty(); }
+
+		/// Restores the layout from before the last edit. O(1), the previous version is still fully intact.
+		bool Undo() {
+			if (undoStack.empty()) return false;
+
+			Restore(undoStack.back(), redoStack);
+			undoStack.pop_back();
+			return true;
+		}
+
+		bool Redo() {
+			if (redoStack.empty()) return false;
+
+			Restore(redoStack.back(), undoStack);
+			redoStack.pop_back();
+			return true;
 		}
 
 		/// Adds a new field at the end of the structure with the specified size and optional type.
 		void AddBytes(int byteCount, FieldType type = FieldType::unk, int fieldSize = 8) {
 			if (byteCount <= 0 || fieldSize <= 0) return;
 
-			auto& fields = currentStructure.fields;
+			const auto& fields = GetFields();
 
 			// Calculate where to start adding fields
-			size_t offset = 0;
-			if (!fields.empty()) {
-				const auto& last = fields.back();
-				offset = last.offset + last.size;
-			}
+			size_t offset = Current().TotalSize();
 
+			std::vector<Field> newFields;
 			while (byteCount >= fieldSize) {
-				fields.push_back(Field{ type, offset, fieldSize });
+				newFields.push_back(Field{ type, offset, fieldSize });
 				offset += fieldSize;
 				byteCount -= fieldSize;
 			}
 
 			// Add a final field for any leftover bytes
 			if (byteCount > 0) {
-				fields.push_back(Field{ type, offset, byteCount });
-				offset += byteCount;
+				newFields.push_back(Field{ type, offset, byteCount });
 			}
 
-			size = offset;
-			mem.resize(size);
+			Commit(fields.Insert(fields.Size(), newFields));
 		}
 
 		/// Removes the last N bytes from the structure, potentially trimming/removing fields.
 		void RemoveBytes(int byteCount) {
-			if (byteCount <= 0 || currentStructure.fields.empty()) return;
+			const auto& fields = GetFields();
+			if (byteCount <= 0 || fields.Empty()) return;
 
 			int remaining = byteCount;
+			size_t keep = fields.Size();
+			std::optional<Field> shrunk = std::nullopt;
 
-			auto& fields = currentStructure.fields;
-			while (remaining > 0 && !fields.empty()) {
-				Field& last = fields.back();
+			while (remaining > 0 && keep > 0) {
+				const Field& last = fields[keep - 1];
 
 				if (remaining >= last.size) {
 					// Remove whole field
 					remaining -= last.size;
-					fields.pop_back();
+					keep--;
 				}
 				else {
 					// Shrink the field
-					last.size -= remaining;
+					shrunk = last;
+					shrunk->size -= remaining;
 					remaining = 0;
 				}
 			}
 
-			// Resize memory
-			size -= byteCount - remaining; // Subtract what we *actually* removed
-			mem.resize(size);
+			// Whole fields after the shrunk one are gone too
+			auto trimmed = fields.Erase(keep, fields.Size() - keep);
+			Commit(shrunk ? trimmed.Set(keep - 1, *shrunk) : trimmed);
 		}
 
 		/// <summary>
-/// Splits a field into multiple subfields of the specified size.
-/// The original field is removed and replaced by new fields.
-/// </summary>
-/// <param name="field">The field to split.</param>
-/// <param name="splitSize">The size of each new subfield (in bytes).</param>
-/// <returns>True if the split was successful, false otherwise.</returns>
-		bool SplitField(const Field& field, int splitSize) {
+		/// Splits a field into multiple subfields of the specified size.
+		/// The original field is removed and replaced by new fields.
+		/// </summary>
+		/// <param name="offset">The offset of the field to split.</param>
+		/// <param name="splitSize">The size of each new subfield (in bytes).</param>
+		/// <returns>True if the split was successful, false otherwise.</returns>
+		bool SplitField(size_t offset, int splitSize) {
 			if (splitSize <= 0) return false;
 
-			auto& fields = currentStructure.fields;
-			auto it = std::find_if(fields.begin(), fields.end(),
-				[&field](const Field& f) { return &f == &field || (f.offset == field.offset && f.size == field.size); });
+			auto idx = FindField(offset);
+			if (!idx) return false;
 
-			if (it == fields.end()) return false;
+			const auto& fields = GetFields();
+			Field field = fields[*idx];
+			if (splitSize >= field.size) return false;
 
-			size_t fieldIndex = std::distance(fields.begin(), it);
-			FieldType typeToUse = field.fieldType;
 			std::vector<Field> newFields;
-
 			size_t numSplits = field.size / splitSize;
 			size_t remaining = field.size % splitSize;
-			size_t offset = field.offset;
 
 			for (size_t i = 0; i < numSplits; ++i) {
-				newFields.push_back(Field{ typeToUse, offset, splitSize });
+				// The first piece keeps the name
+				newFields.push_back(Field{ PieceType(field, splitSize), offset, splitSize, -1, i == 0 ? field.name : std::string() });
 				offset += splitSize;
 			}
 			if (remaining > 0) {
-				newFields.push_back(Field{ typeToUse, offset, static_cast<int>(remaining) });
+				newFields.push_back(Field{ PieceType(field, static_cast<int>(remaining)), offset, static_cast<int>(remaining) });
 			}
 
 			// Replace the old field with new fields
-			fields.erase(it);
-			fields.insert(fields.begin() + fieldIndex, newFields.begin(), newFields.end());
-
-			size = CalcTotalSize();
-			mem.resize(size);
-
+			Commit(fields.Replace(*idx, 1, newFields));
 			return true;
 		}
 
@@ -185,197 +346,253 @@ namespace IIR {
 		/// Joins a field with its immediately adjacent fields into a single field.
 		/// The fields to join are determined by their offsets and must be contiguous.
 		/// </summary>
-		/// <param name="field">The field to join with adjacent fields.</param>
+		/// <param name="offset">The offset of the first field to join.</param>
 		/// <param name="numFields">Number of contiguous fields to join (including the given field).</param>
 		/// <returns>True if join was successful, false otherwise.</returns>
-		bool JoinFields(const Field& field, size_t numFields = 2) {
+		bool JoinFields(size_t offset, size_t numFields = 2) {
 			if (numFields < 2) return false;
 
-			auto& fields = currentStructure.fields;
-			auto it = std::find_if(fields.begin(), fields.end(),
-				[&field](const Field& f) { return &f == &field || (f.offset == field.offset && f.size == field.size); });
+			auto idx = FindField(offset);
+			if (!idx) return false;
 
-			if (it == fields.end()) return false;
-
-			size_t startIdx = std::distance(fields.begin(), it);
+			const auto& fields = GetFields();
+			size_t startIdx = *idx;
 
 			// Ensure there are enough fields after startIdx
-			if (startIdx + numFields > fields.size()) return false;
+			if (startIdx + numFields > fields.Size()) return false;
 
-			// Check that fields are contiguous
-			size_t expectedOffset = fields[startIdx].offset;
+			// Check that fields are contiguous and share a type
+			size_t expectedOffset = offset;
 			FieldType typeToUse = fields[startIdx].fieldType;
-			for (size_t i = 0; i < numFields; ++i) {
-				if (fields[startIdx + i].offset != expectedOffset || fields[startIdx + i].fieldType != typeToUse)
-					return false;
-				expectedOffset += fields[startIdx + i].size;
-			}
+			bool contiguous = true;
+			fields.ForEach(startIdx, startIdx + numFields, [&](const Field& f) {
+				if (f.offset != expectedOffset || f.fieldType != typeToUse)
+					contiguous = false;
+				expectedOffset += f.size;
+			});
+			if (!contiguous) return false;
 
-			// Compute properties for the new joined field
-			size_t offset = fields[startIdx].offset;
-			int totalSize = 0;
-			for (size_t i = 0; i < numFields; ++i)
-				totalSize += fields[startIdx + i].size;
-
-			Field joinedField{ typeToUse, offset, totalSize };
+			int joinedSize = static_cast<int>(expectedOffset - offset);
+			Field joinedField{ PieceType(fields[startIdx], joinedSize), offset, joinedSize, -1, fields[startIdx].name };
 
 			// Replace the old fields with the new joined field
-			fields.erase(fields.begin() + startIdx, fields.begin() + startIdx + numFields);
-			fields.insert(fields.begin() + startIdx, joinedField);
-
-			size = CalcTotalSize();
-			mem.resize(size);
-
+			Commit(fields.Replace(startIdx, numFields, std::span<const Field>(&joinedField, 1)));
 			return true;
 		}
 
 		/// <summary>
-		/// If the field is smaller than targetSize, attempts to join with adjacent fields until the size matches targetSize exactly.
+		/// If the field is smaller than targetSize, joins it with the following fields so it covers exactly targetSize bytes,
+		/// splitting the last overlapped field if it extends past the new boundary.
 		/// If the field is larger than targetSize, splits into multiple fields of targetSize.
-		/// Does not change the type.
+		/// Keeps the type where it still fits the new size, otherwise the fields become untyped bytes. Always results in a single undo step.
 		/// </summary>
-		/// <param name="field">The field to operate on.</param>
+		/// <param name="offset">The offset of the field to operate on.</param>
 		/// <param name="targetSize">The target size to join/split to.</param>
 		/// <returns>True if a join or split was performed, false otherwise.</returns>
-		bool JoinOrSplit(const Field& field, int targetSize) {
+		bool JoinOrSplit(size_t offset, int targetSize) {
 			if (targetSize <= 0) return false;
 
-			auto& fields = currentStructure.fields;
-			// Find the selected field
-			auto it = std::find_if(fields.begin(), fields.end(),
-				[&field](const Field& f) { return &f == &field || (f.offset == field.offset && f.size == field.size); });
+			auto idx = FindField(offset);
+			if (!idx) return false;
 
-			if (it == fields.end())
-				return false;
+			const auto& fields = GetFields();
+			const Field& field = fields[*idx];
 
 			// If field is bigger than target, just split it
 			if (field.size > targetSize)
-				return SplitField(field, targetSize);
+				return SplitField(offset, targetSize);
 
 			// If already target size, do nothing
 			if (field.size == targetSize)
 				return false;
 
 			// Define the target range exactly where the selected field is
-			size_t rangeStart = field.offset;
-			size_t rangeEnd = rangeStart + targetSize;
-
-			// Step 1: Split any field that overlaps with our target range but isn't entirely inside it
-			std::vector<size_t> fieldsToSplit;
-			for (size_t i = 0; i < fields.size(); i++) {
-				auto& f = fields[i];
-				// Skip the selected field itself
-				if (&f == &field) continue;
-
-				// If field partially overlaps our target range, mark it for splitting
-				if (f.offset < rangeEnd && (f.offset + f.size) > rangeStart &&
-					(f.offset < rangeStart || (f.offset + f.size) > rangeEnd)) {
-					fieldsToSplit.push_back(i);
-				}
-			}
+			size_t rangeEnd = offset + targetSize;
+			if (rangeEnd > Current().TotalSize())
+				return false;
 
-			// Split the overlapping fields - starting from the end to avoid index shifting
-			for (auto it = fieldsToSplit.rbegin(); it != fieldsToSplit.rend(); ++it) {
-				size_t idx = *it;
-				if (idx >= fields.size()) continue; // Safety check
+			// Find the last field overlapping the range, every field in between is swallowed by the join
+			size_t endIdx = fields.PartitionPoint([rangeEnd](const Field& f) { return f.offset < rangeEnd; });
 
-				auto& f = fields[idx];
-				// If field starts before range and extends into it
-				if (f.offset < rangeStart && f.offset + f.size > rangeStart) {
-					SplitField(f, rangeStart - f.offset);
-				}
-				// Re-fetch fields after potential modification
-				// If field starts inside range and extends past it
-				for (auto& f : fields) {
-					if (f.offset < rangeEnd && f.offset >= rangeStart && f.offset + f.size > rangeEnd) {
-						SplitField(f, rangeEnd - f.offset);
-						break;
-					}
-				}
-			}
+			bool sameType = true;
+			fields.ForEach(*idx, endIdx, [&](const Field& f) { sameType &= f.fieldType == field.fieldType; });
+			if (!sameType) return false;
 
-			// Step 2: Find all fields inside the target range
-			std::vector<Field*> rangeFields;
-			for (auto& f : fields) {
-				if (f.offset >= rangeStart && f.offset + f.size <= rangeEnd) {
-					rangeFields.push_back(&f);
-				}
+			FieldType joinedType = PieceType(field, targetSize);
+			Commit(CoverRange(*idx, endIdx, Field{ joinedType, offset, targetSize, joinedType == field.fieldType ? field.classIndex : -1, field.name }));
+			return true;
+		}
+
+		/// <summary>
+		/// Turns the field at `offset` into a pointer to, or an inline copy of, another class.
+		/// Inline instances take the size the class has right now and swallow the fields they cover.
+		/// </summary>
+		/// <param name="offset">The offset of the field to retype.</param>
+		/// <param name="type">FieldType::pointer or FieldType::instance.</param>
+		/// <param name="classIndex">The class to point to or embed.</param>
+		/// <returns>True if the field was retyped, false otherwise.</returns>
+		bool SetFieldClass(size_t offset, FieldType type, size_t classIndex) {
+			if (classIndex >= classes.size()) return false;
+			if (type != FieldType::pointer && type != FieldType::instance) return false;
+
+			// An inline instance of ourselves (even transitively) would have infinite size
+			if (type == FieldType::instance && Embeds(classIndex, shown.classIndex)) {
+				spdlog::warn("Cannot embed {} in {}, it would contain itself", classes[classIndex].name, Current().name);
+				return false;
 			}
 
-			// Sort by offset
-			std::sort(rangeFields.begin(), rangeFields.end(),
-				[](const Field* a, const Field* b) { return a->offset < b->offset; });
+			auto idx = FindField(offset);
+			if (!idx) return false;
 
-			// Step 3: Check they are contiguous and join them
-			if (rangeFields.size() > 0) {
-				// Check the first field starts at rangeStart
-				if (rangeFields[0]->offset != rangeStart)
-					return false;
+			int newSize = type == FieldType::pointer ? static_cast<int>(sizeof(uintptr_t)) : static_cast<int>(GetClass(classIndex).TotalSize());
+			if (newSize <= 0 || offset + newSize > Current().TotalSize()) return false;
 
-				// Join them
-				return JoinFields(*rangeFields[0], rangeFields.size());
+			const auto& fields = GetFields();
+			size_t rangeEnd = offset + newSize;
+			size_t endIdx = fields.PartitionPoint([rangeEnd](const Field& f) { return f.offset < rangeEnd; });
+
+			Commit(CoverRange(*idx, endIdx, Field{ type, offset, newSize, static_cast<int32_t>(classIndex), fields[*idx].name }));
+			return true;
+		}
+
+		/// <summary>
+		/// Casts the field at `offset` to a plain value type, swallowing the following fields if the type is bigger
+		/// and leaving the remaining bytes untyped if it is smaller.
+		/// </summary>
+		/// <param name="offset">The offset of the field to retype.</param>
+		/// <param name="type">Any type but FieldType::instance, see SetFieldClass for that.</param>
+		/// <returns>True if the field was retyped, false otherwise.</returns>
+		bool SetFieldType(size_t offset, FieldType type) {
+			if (type == FieldType::instance) return false;
+
+			auto idx = FindField(offset);
+			if (!idx) return false;
+
+			const auto& fields = GetFields();
+			const Field& field = fields[*idx];
+			if (field.fieldType == type && field.classIndex < 0) return false;
+
+			const auto& info = GetFieldTypeInfo(type);
+			int newSize = info.size ? info.size : field.size;
+			if (offset + newSize > Current().TotalSize()) {
+				spdlog::warn("Cannot cast field at 0x{:X} to {}, it needs {} bytes", offset, info.name, newSize);
+				return false;
 			}
 
-			return false;
+			size_t rangeEnd = offset + newSize;
+			size_t endIdx = fields.PartitionPoint([rangeEnd](const Field& f) { return f.offset < rangeEnd; });
+
+			Commit(CoverRange(*idx, endIdx, Field{ type, offset, newSize, -1, field.name }));
+			return true;
+		}
+
+		/// Renames the field at `offset`, an empty name clears it.
+		bool SetFieldName(size_t offset, std::string_view newName) {
+			auto idx = FindField(offset);
+			if (!idx) return false;
+
+			const auto& fields = GetFields();
+			if (fields[*idx].name == newName) return false;
+
+			Field renamed = fields[*idx];
+			renamed.name = newName;
+			Commit(fields.Set(*idx, renamed));
+			return true;
+		}
+
+		/// <summary>
+		/// Replaces the layout of the current class with `newFields` in one undo step.
+		/// </summary>
+		/// <param name="basis">The layout `newFields` was derived from, nothing happens if the class has been edited since.</param>
+		/// <returns>True if the layout was replaced, false otherwise.</returns>
+		bool ApplyLayout(size_t classIndex, const FieldList& basis, std::span<const Field> newFields) {
+			if (classIndex != shown.classIndex || !basis.SameVersion(GetFields())) return false;
+
+			Commit(FieldList().Insert(0, newFields));
+			return true;
 		}
 
 	private:
 		StructureManager() = default;
-		~StructureManager() {
-			this->running = false;
-			if (this->hUpdateThread.joinable()) {
-				this->hUpdateThread.join();
-			}
-		}
+		~StructureManager() = default;
 
 		StructureManager(const StructureManager&) = delete;
 		StructureManager& operator=(const StructureManager&) = delete;
 
-		Structure currentStructure;
+		static constexpr size_t maxHistory = 512;
 
-		uintptr_t baseAddr = 0;
-		std::string name = "unnamed";
-		size_t size = 64;
+		/// One undo step: the layout a class had before an edit.
+		struct Revision {
+			size_t classIndex;
+			FieldList fields;
+		};
 
-		std::vector<uint8_t> mem;
+		// Mutable so GetClass can decode lazily loaded classes, only ever touched by the UI thread
+		mutable std::vector<Structure> classes = { Structure{} };
+		Instance shown; // Its class is the current one.
+		std::vector<Instance> instances;
+		uint64_t instancesVersion = 0;
 
-		void UpdateFunction() {
-			auto& pm = IIR::ProcessManager::GetInstance();
+		std::deque<Revision> undoStack;
+		std::deque<Revision> redoStack;
 
-			while (this->running) {
-				auto handle = pm.GetHandle();
-				if (handle == nullptr) {
-					std::this_thread::sleep_for(std::chrono::milliseconds(100));
-					continue;
-				}
+		mutable std::mutex layoutMtx;
+		FieldList publishedLayout;
 
-				SIZE_T sizeRead = 0;
-				BOOL success = ReadProcessMemory(
-					handle,
-					reinterpret_cast<LPCVOID>(baseAddr),
-					this->mem.data(),
-					size,
-					&sizeRead
-				);
-
-				if (!success || sizeRead != size) {
-					DWORD errorCode = GetLastError();
-					spdlog::error("ReadProcessMemory failed (err: {})  read {}/{} bytes", errorCode, sizeRead, size);
-					std::this_thread::sleep_for(std::chrono::milliseconds(100));
-					continue;
-				}
+		Structure& Current() { return const_cast<Structure&>(GetClass(shown.classIndex)); }
+		const Structure& Current() const { return GetClass(shown.classIndex); }
+
+		/// Makes `next` the current layout, recording the previous one for undo.
+		void Commit(FieldList next) {
+			if (next.SameVersion(Current().fields)) return;
+
+			undoStack.push_back({ shown.classIndex, std::move(Current().fields) });
+			if (undoStack.size() > maxHistory)
+				undoStack.pop_front();
+			redoStack.clear();
+
+			Current().fields = std::move(next);
+			Publish();
+		}
 
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		/// Applies a revision, pushing the layout it replaces onto `other` so it can be reversed.
+		void Restore(Revision& revision, std::deque<Revision>& other) {
+			auto& target = classes[revision.classIndex];
+			other.push_back({ revision.classIndex, std::move(target.fields) });
+			target.fields = std::move(revision.fields);
+
+			shown.classIndex = revision.classIndex;
+			Publish();
+		}
+
+		/// The type a `size` byte piece of `field` keeps. Pieces of a typed value that no longer fit the type, or of a pointer/instance, are just bytes.
+		static FieldType PieceType(const Field& field, int size) {
+			if (field.IsExpandable() || !FitsType(field.fieldType, size)) return FieldType::unk;
+			return field.fieldType;
+		}
+
+		/// Replaces fields [first, last) with `replacement`, keeping whatever part of the last field extends past it.
+		FieldList CoverRange(size_t first, size_t last, const Field& replacement) const {
+			const auto& fields = GetFields();
+			const Field& tail = fields[last - 1];
+
+			std::vector<Field> newFields = { replacement };
+			size_t rangeEnd = replacement.offset + replacement.size;
+			size_t tailEnd = tail.offset + tail.size;
+			if (tailEnd > rangeEnd) {
+				// Keep the part of the last field that sticks out past the range
+				int tailSize = static_cast<int>(tailEnd - rangeEnd);
+				newFields.push_back(Field{ PieceType(tail, tailSize), rangeEnd, tailSize });
 			}
+
+			return fields.Replace(first, last - first, newFields);
 		}
 
-		size_t CalcTotalSize() const {
-			if (currentStructure.fields.empty()) return 0;
-			const auto& last = currentStructure.fields.back();
-			return last.offset + last.size;
+		/// Hands the current layout to other threads.
+		void Publish() {
+			std::lock_guard<std::mutex> lock(layoutMtx);
+			publishedLayout = Current().fields;
 		}
 
-		std::thread hUpdateThread;
-		std::atomic<bool> running = false;
 	};
 }
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "pch.h"
+
+#include <filesystem>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "iir/modules.h"
+
+namespace IIR {
+	/// <summary>
+	/// The exported symbols of one image, sorted by address with a hash index over their names.
+	/// Addresses are relative to the image base, so one table serves every process that loads the image.
+	/// </summary>
+	class SymbolTable {
+	public:
+		struct Symbol {
+			uint32_t rva;
+			uint32_t nameOffset; // Into the string table.
+			uint32_t nameLength;
+		};
+
+		/// <summary>
+		/// Builds the table from the export directory of a PE image.
+		/// </summary>
+		/// <param name="at">Returns the bytes at an RVA and how many of them can be read, or an empty span if there are none.</param>
+		static std::shared_ptr<SymbolTable> FromExports(uint32_t directoryRva, uint32_t directorySize,
+			const std::function<std::span<const uint8_t>(uint32_t rva)>& at);
+
+		/// <summary>
+		/// Loads a table written by Save, nullptr if the file is missing or damaged.
+		/// </summary>
+		static std::shared_ptr<SymbolTable> Load(const std::filesystem::path& path);
+		bool Save(const std::filesystem::path& path) const;
+
+		size_t Size() const { return symbols.size(); }
+
+		std::string_view Name(const Symbol& symbol) const {
+			return std::string_view(strings.data() + symbol.nameOffset, symbol.nameLength);
+		}
+
+		/// Looks a symbol up by name. Case is ignored if no symbol matches it exactly (the address box is upper case).
+		const Symbol* Find(std::string_view name) const;
+
+		/// The closest symbol at or before `rva`, nullptr if there is none.
+		const Symbol* Nearest(uint32_t rva) const {
+			auto it = std::upper_bound(symbols.begin(), symbols.end(), rva, [](uint32_t value, const Symbol& symbol) { return value < symbol.rva; });
+			return it == symbols.begin() ? nullptr : &*std::prev(it);
+		}
+
+	private:
+		static constexpr uint32_t fileMagic = 0x53524949; // "IIRS"
+		static constexpr uint32_t fileVersion = 1;
+		static constexpr uint32_t emptySlot = UINT32_MAX;
+
+		std::vector<Symbol> symbols; // Sorted by rva.
+		std::vector<char> strings;
+		std::vector<uint32_t> slots; // Open addressing over the lowercase names, indices into `symbols`. Power of two sized.
+
+		static uint64_t HashName(std::string_view name);
+		void Finish();
+	};
+
+	/// <summary>
+	/// Every symbol table loaded so far, keyed by the image's build ID (or its path if it has none).
+	/// </summary>
+	struct SymbolSnapshot {
+		uint64_t version = 0; // Bumped whenever a table is added.
+		std::unordered_map<std::string, std::shared_ptr<const SymbolTable>> tables;
+
+		static std::string Key(const Module& module) { return module.buildId.empty() ? module.path : module.buildId; }
+
+		const SymbolTable* Find(const Module& module) const {
+			auto it = tables.find(Key(module));
+			return it == tables.end() ? nullptr : it->second.get();
+		}
+	};
+
+	/// <summary>
+	/// Loads the export tables of the target's modules on a background thread, the first time one is asked for.
+	/// Tables come from the image file mapped from disk, or from the target's memory if the file cannot be opened, and are
+	/// cached on disk by build ID so the next session only maps a small file.
+	/// </summary>
+	class SymbolIndex {
+	public:
+		static SymbolIndex& GetInstance();
+
+		void Init();
+
+		/// The tables loaded so far. Safe to call from any thread, the snapshot never changes once published.
+		std::shared_ptr<const SymbolSnapshot> Get() const { return latest.load(); }
+
+		/// Asks for the table of `module` to be loaded. Cheap to call again, each module is only loaded once. Any thread.
+		void Want(const Module& module);
+
+	private:
+		SymbolIndex();
+		~SymbolIndex();
+		SymbolIndex(const SymbolIndex&) = delete;
+		SymbolIndex& operator=(const SymbolIndex&) = delete;
+
+		void UpdateFunction();
+		std::shared_ptr<SymbolTable> LoadTable(const Module& module);
+		static std::filesystem::path CachePath(const Module& module);
+
+		std::mutex wantedMtx;
+		std::condition_variable wantedChanged;
+		std::vector<Module> wanted;
+		std::unordered_set<std::string> requested; // Keys asked for so far, loaded or not.
+
+		std::atomic<std::shared_ptr<const SymbolSnapshot>> latest;
+
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+	};
+
+	/// <summary>
+	/// Resolves a name in an address expression: a module ("game.exe"), a symbol ("ntdll.dll!RtlGetVersion"), or the
+	/// executable if it is empty. Symbols of modules whose tables are not loaded yet are asked for and resolve on a later try.
+	/// </summary>
+	std::optional<uintptr_t> ResolveName(const ModuleSnapshot& modules, const SymbolSnapshot& symbols, std::string_view name);
+
+	/// <summary>
+	/// Labels addresses for one frame, e.g. "ntdll.dll!RtlGetVersion+0x10", or "game.exe+0x1A2B" when no export is close.
+	/// </summary>
+	class PointerLabels {
+	public:
+		PointerLabels(std::shared_ptr<const ModuleSnapshot> modules, std::shared_ptr<const SymbolSnapshot> symbols)
+			: modules(std::move(modules)), symbols(std::move(symbols)) {}
+
+		/// Changes whenever a label could come out differently.
+		uint64_t Version() const { return modules->version << 32 ^ symbols->version; }
+
+		const ModuleSnapshot& Modules() const { return *modules; }
+		const SymbolSnapshot& Symbols() const { return *symbols; }
+
+		/// <returns>The number of characters written to `out`, or 0 if the address is not inside a module.</returns>
+		int Label(uintptr_t address, char* out, size_t outSize) const;
+
+	private:
+		// Exports further than this below an address are not used to label it, it most likely belongs to something unexported.
+		static constexpr uint32_t maxSymbolDistance = 0x1000;
+
+		std::shared_ptr<const ModuleSnapshot> modules;
+		std::shared_ptr<const SymbolSnapshot> symbols;
+	};
+}
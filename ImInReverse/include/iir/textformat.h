@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace IIR {
+	/// <summary>
+	/// Writes `count` bytes as upper case hex followed by a space each ("0A 1B "), 3 * `count` characters.
+	/// Sixteen bytes at a time with SSSE3 shuffles where the CPU has them.
+	/// </summary>
+	/// <returns>The number of characters written.</returns>
+	size_t FormatHexBytes(const uint8_t* data, size_t count, char* out);
+
+	/// <summary>
+	/// Writes `count` bytes as ASCII, anything unprintable as a '.', `count` characters.
+	/// </summary>
+	/// <returns>The number of characters written.</returns>
+	size_t FormatAsciiBytes(const uint8_t* data, size_t count, char* out);
+
+	/// <summary>
+	/// Builds text in a fixed buffer without going through a format string. Anything that does not fit is dropped,
+	/// the text is always null terminated.
+	/// </summary>
+	class TextWriter {
+	public:
+		TextWriter(char* out, size_t size) : begin(out), cursor(out), end(size ? out + size - 1 : out), terminate(size > 0) {
+			if (terminate) *out = '\0';
+		}
+
+		TextWriter& Put(std::string_view text) {
+			size_t count = std::min(text.size(), static_cast<size_t>(end - cursor));
+			std::memcpy(cursor, text.data(), count);
+			cursor += count;
+			return *this;
+		}
+
+		TextWriter& Put(char c) {
+			if (cursor < end) *cursor++ = c;
+			return *this;
+		}
+
+		/// Decimal.
+		template<typename T> requires std::is_integral_v<T>
+		TextWriter& Int(T value) {
+			auto result = std::to_chars(cursor, end, value);
+			// A number that does not fit is dropped whole, and nothing after it is written either
+			if (result.ec == std::errc()) cursor = result.ptr;
+			else end = cursor;
+			return *this;
+		}
+
+		/// Upper case hex, padded with zeros to at least `minDigits`.
+		TextWriter& Hex(uint64_t value, int minDigits = 1) {
+			char digits[16];
+			int count = 0;
+			do {
+				digits[15 - count++] = "0123456789ABCDEF"[value & 0xF];
+				value >>= 4;
+			} while (value);
+
+			for (int i = count; i < minDigits; i++) Put('0');
+			return Put(std::string_view(digits + 16 - count, count));
+		}
+
+		/// Like printf's %.*g.
+		TextWriter& Float(double value, int precision) {
+			auto result = std::to_chars(cursor, end, value, std::chars_format::general, precision);
+			// A number that does not fit is dropped whole, and nothing after it is written either
+			if (result.ec == std::errc()) cursor = result.ptr;
+			else end = cursor;
+			return *this;
+		}
+
+		/// Terminates the text and returns its length.
+		int Length() {
+			if (terminate) *cursor = '\0';
+			return static_cast<int>(cursor - begin);
+		}
+
+		std::string_view View() const { return std::string_view(begin, cursor - begin); }
+
+	private:
+		char* begin;
+		char* cursor;
+		char* end; // Last byte of the buffer, kept for the terminator.
+		bool terminate; // False for an empty buffer, which has no room for one.
+	};
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "pch.h"
+
+#include "iir/structure.h"
+#include "iir/options.h"
+
+namespace IIR {
+	/// <summary>
+	/// A table of `count` instances of a class laid out `stride` bytes apart, one row per element.
+	/// Only the rows on screen are read, and only the bytes of the columns being shown.
+	/// </summary>
+	/// <param name="open">Window visibility, cleared when the user closes it.</param>
+	void ArrayView(StructureManager& sm, OptionsManager& om, bool* open);
+
+	/// <summary>
+	/// Shows what the field analyzer thinks each 8-byte slot of the current class is, and lets the user accept its proposed layout.
+	/// The analyzer only samples while this window is open.
+	/// </summary>
+	/// <param name="open">Window visibility, cleared when the user closes it.</param>
+	void InferenceView(StructureManager& sm, OptionsManager& om, bool* open);
+
+	/// <summary>
+	/// Searches the types in an ELF file's DWARF debug info and imports them as classes, see DwarfFile.
+	/// </summary>
+	/// <param name="open">Window visibility, cleared when the user closes it.</param>
+	void DwarfImportView(StructureManager& sm, OptionsManager& om, bool* open);
+
+	/// <summary>
+	/// Applies the current class to many base addresses at once and shows which fields differ between them and which stay constant,
+	/// with the range and number of distinct values of each field. See CompareInstances.
+	/// </summary>
+	/// <param name="open">Window visibility, cleared when the user closes it.</param>
+	void CompareView(StructureManager& sm, OptionsManager& om, bool* open);
+
+	/// <summary>
+	/// Lists the watched instances of every class and shows the fields of the selected one.
+	/// All of them are polled while this window is open.
+	/// </summary>
+	/// <param name="open">Window visibility, cleared when the user closes it.</param>
+	void InstancesView(StructureManager& sm, OptionsManager& om, bool* open);
+
+	/// <summary>
+	/// Shows a watched instance in the memory pane. The instance's address becomes its class' address, otherwise the pane
+	/// would move back to the class' saved address when it notices the class changed.
+	/// </summary>
+	void ShowInstance(StructureManager& sm, const Instance& instance);
+
+	/// <summary>
+	/// Shows every timing series and counter of the Profiler: the recent samples of each step with their p50 and p99,
+	/// and the rate of each counter over the last minute. Profiling is only enabled while this window is open.
+	/// </summary>
+	/// <param name="open">Window visibility, cleared when the user closes it.</param>
+	void ProfilerView(OptionsManager& om, bool* open);
+
+	/// <summary>
+	/// A classic hex dump of the whole module or allocation around an address, read a page at a time through the PageCache.
+	/// Rows are scrolled with 64-bit positions, so a 4 GB region scrolls like a small one. A selection can be turned into a new class.
+	/// </summary>
+	/// <param name="open">Window visibility, cleared when the user closes it.</param>
+	void HexView(StructureManager& sm, OptionsManager& om, bool* open);
+
+	/// <summary>
+	/// Lists every committed region of the RegionMap with its protection, type and module or mapped file, sortable and
+	/// filterable without asking the OS again. The resident size, zero pages and entropy of the rows on screen are worked
+	/// out by the RegionStatsCollector.
+	/// </summary>
+	/// <param name="open">Window visibility, cleared when the user closes it.</param>
+	void MemoryMapView(StructureManager& sm, OptionsManager& om, bool* open);
+}
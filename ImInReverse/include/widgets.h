@@ -10,154 +10,105 @@ namespace ImGui {
         ImGui::GetForegroundDrawList()->AddLine(ImVec2(min.x, max.y), max, ImGui::GetColorU32(ImGuiCol_Text), 1.0f);
     }
 
-    struct ButtonData {
-        std::string label = "";
-        float width = 96.0f;
+    /// <summary>
+    /// State of the button group being built. Buttons are laid out and drawn as they are added, the frame and label
+    /// are drawn behind them once the group ends and its size is known, so nothing is kept between frames.
+    /// </summary>
+    struct ButtonGroup {
+        static constexpr float buttonHeight = 24.0f;
+        static constexpr float spacingY = 4.0f;
+        static constexpr float spacingX = 8.0f;
+        static constexpr float outerPadding = 5.0f;
+        static constexpr int rows = 3; // Buttons per column.
+        static constexpr float labelPaddingTop = 12.0f; // Padding above the label.
+
+        std::string_view label;
+        ImVec2 startPos;
+        int count = 0;
+        float columnX = 0.0f; // Left edge of the current column, relative to the content area.
+        float columnWidth = 0.0f; // Widest button in the current column so far.
     };
 
-    // TODO: Optimise massively.
-    static std::vector<ButtonData> buttons;
-    static std::string currentLabel;
-    static std::vector<bool> buttonClicked; // Track which buttons are clicked
-    static std::unordered_map<std::string, bool> lastFrameButtonState; // Map button labels to their clicked state
+    inline ButtonGroup currentButtonGroup;
 
-    void BeginButtonGroup(std::string_view label) {
-        currentLabel = std::string(label);
+    /// <summary>
+    /// Starts a group of buttons in columns of three with a caption underneath, like a ribbon section.
+    /// `label` must stay alive until EndButtonGroup.
+    /// </summary>
+    inline void BeginButtonGroup(std::string_view label) {
+        auto& group = currentButtonGroup;
+        group = ButtonGroup{ label, ImGui::GetCursorScreenPos() };
 
-        // Before clearing anything, update the map of last frame's button states
-        for (size_t i = 0; i < buttons.size(); i++) {
-            if (i < buttonClicked.size()) {
-                lastFrameButtonState[std::string(buttons[i].label)] = buttonClicked[i];
-            }
-        }
+        ImGui::BeginGroup();
+        ImGui::PushID(label.data(), label.data() + label.size());
 
-        // Reset for this frame
-        buttons.clear();
-        buttonClicked.clear();
+        // Buttons go on top, the frame is drawn into the background channel when the group ends
+        ImGui::GetWindowDrawList()->ChannelsSplit(2);
+        ImGui::GetWindowDrawList()->ChannelsSetCurrent(1);
+        ImGui::PushStyleColor(ImGuiCol_Button, ImGui::GetColorU32(ImGuiCol_WindowBg));
+        ImGui::PushStyleVar(ImGuiStyleVar_ButtonTextAlign, ImVec2(0.0f, 0.5f));
     }
 
-    bool GroupedButton(std::string_view label, float width = 96.0f) {
-        // Convert to std::string for map lookup
-        std::string labelStr(label);
-
-        // Add this button to current frame's group
-        //buttons.push_back(labelStr);
-        buttons.emplace_back(labelStr, width);
-        buttonClicked.push_back(false); // Initialize as not clicked in this frame
-
-        // Return whether this button was clicked in the previous frame
-        return lastFrameButtonState.count(labelStr) > 0 && lastFrameButtonState[labelStr];
+    /// <summary>
+    /// Adds a button to the current group.
+    /// </summary>
+    /// <returns>Whether the button was clicked this frame.</returns>
+    inline bool GroupedButton(const char* label, float width = 96.0f) {
+        auto& group = currentButtonGroup;
+        int row = group.count % ButtonGroup::rows;
+        if (row == 0 && group.count > 0) {
+            group.columnX += group.columnWidth + ButtonGroup::spacingX;
+            group.columnWidth = 0.0f;
+        }
+        group.columnWidth = std::max(group.columnWidth, width);
+
+        ImGui::SetCursorScreenPos(ImVec2(
+            group.startPos.x + ButtonGroup::outerPadding + group.columnX,
+            group.startPos.y + ButtonGroup::outerPadding + row * (ButtonGroup::buttonHeight + ButtonGroup::spacingY)));
+        ImGui::PushID(group.count++);
+        bool clicked = ImGui::Button(label, ImVec2(width, ButtonGroup::buttonHeight));
+        ImGui::PopID();
+        return clicked;
     }
 
-    void EndButtonGroup() {
-        const float buttonHeight = 24.0f;
-        const float spacingY = 4.0f;
-        const float spacingX = 8.0f;
-        const float outerPadding = 5.0f;
-        const int minButtonRows = 3; // Minimum number of rows per column
-        const int maxButtonRows = 3; // Maximum number of rows per column
+    inline void EndButtonGroup() {
+        const auto& group = currentButtonGroup;
         const float labelHeight = ImGui::GetTextLineHeightWithSpacing();
-        const float labelPaddingTop = 12.0f; // Padding above the label
-
-        ImU32 wbg = ImGui::GetColorU32(ImGuiCol_WindowBg);
-        ImGui::PushStyleColor(ImGuiCol_Button, wbg);
-
-        auto count = static_cast<int>(buttons.size());
-        int numColumns = (count + maxButtonRows - 1) / maxButtonRows; // ceil(count / 3.0)
-        int rowsPerColumn = std::min(std::max(minButtonRows, (count + numColumns - 1) / numColumns), maxButtonRows);
-
-        // Compute max width for each column
-        std::vector<float> colWidths(numColumns, 0.0f);
-        for (int col = 0; col < numColumns; ++col) {
-            for (int row = 0; row < maxButtonRows; ++row) {
-                int idx = col * maxButtonRows + row;
-                if (idx < count) {
-                    colWidths[col] = std::max(colWidths[col], buttons[idx].width);
-                }
-            }
-        }
 
-        float contentWidth = 0.0f;
-        for (int col = 0; col < numColumns; ++col) {
-            contentWidth += colWidths[col];
-            if (col != numColumns - 1)
-                contentWidth += spacingX;
-        }
-        float buttonsHeight = rowsPerColumn * buttonHeight + (rowsPerColumn - 1) * spacingY;
+        ImGui::PopStyleVar();
+        ImGui::PopStyleColor();
 
-        // Add space for the label area
-        float totalContentHeight = buttonsHeight + labelPaddingTop + labelHeight;
+        float contentWidth = group.columnX + group.columnWidth;
+        float buttonsHeight = ButtonGroup::rows * ButtonGroup::buttonHeight + (ButtonGroup::rows - 1) * ButtonGroup::spacingY;
+        float totalWidth = contentWidth + 2 * ButtonGroup::outerPadding;
+        float totalHeight = buttonsHeight + ButtonGroup::labelPaddingTop + labelHeight + 2 * ButtonGroup::outerPadding;
 
-        float totalWidth = contentWidth + 2 * outerPadding;
-        float totalHeight = totalContentHeight + 2 * outerPadding;
+        ImVec2 startPos = group.startPos;
+        ImVec2 endPos(startPos.x + totalWidth, startPos.y + totalHeight);
+        float labelTop = endPos.y - labelHeight - ButtonGroup::labelPaddingTop;
 
-        // Begin the main group
-        ImGui::BeginGroup();
-
-        // Get initial position for drawing
-        ImVec2 startPos = ImGui::GetCursorScreenPos();
+        // Background and border, with the label area highlighted and a line to separate it
         ImDrawList* drawList = ImGui::GetWindowDrawList();
-
-        // Draw background and border
-        drawList->AddRectFilled(
-            startPos,
-            ImVec2(startPos.x + totalWidth, startPos.y + totalHeight),
-            ImGui::GetColorU32(ImGuiCol_WindowBg),
-            4.0f
-        );
-        drawList->AddRect(
-            startPos,
-            ImVec2(startPos.x + totalWidth, startPos.y + totalHeight),
-            ImGui::GetColorU32(ImGuiCol_Border),
-            4.0f
-        );
-
-        // Add a rect at the bottom to highlight the label area along with a line to separate it
-        drawList->AddRectFilled(
-            ImVec2(startPos.x + 1, startPos.y + totalHeight - labelHeight - labelPaddingTop),
-            ImVec2(startPos.x + totalWidth - 1, startPos.y + totalHeight - 1),
-            ImGui::GetColorU32(ImGuiCol_ChildBg),
-            4.0f
-        );
-        drawList->AddLine(
-            ImVec2(startPos.x, startPos.y + totalHeight - labelHeight - labelPaddingTop),
-            ImVec2(startPos.x + totalWidth, startPos.y + totalHeight - labelHeight - labelPaddingTop),
-            ImGui::GetColorU32(ImGuiCol_Border),
-            1.0f
-        );
-
-        // Draw columns and buttons
-        float colX = startPos.x + outerPadding;
-        for (int col = 0, btnIdx = 0; col < numColumns; ++col) {
-            float colWidth = colWidths[col];
-            for (int row = 0; row < rowsPerColumn && btnIdx < count; ++row, ++btnIdx) {
-                float buttonY = startPos.y + outerPadding + row * (buttonHeight + spacingY);
-                ImGui::SetCursorScreenPos(ImVec2(colX, buttonY));
-                ImGui::PushID(btnIdx);
-                ImGui::PushStyleVar(ImGuiStyleVar_ButtonTextAlign, ImVec2(0.0f, 0.5f));
-                if (ImGui::Button(buttons[btnIdx].label.c_str(), ImVec2(buttons[btnIdx].width, buttonHeight))) {
-                    buttonClicked[btnIdx] = true;
-                }
-                ImGui::PopStyleVar();
-                ImGui::PopID();
-            }
-            colX += colWidth + spacingX;
-        }
-
-        // Add the label section below the buttons
-        float labelY = startPos.y + outerPadding + buttonsHeight + labelPaddingTop;
-
-        // Center the label across the entire content area (all columns)
-        float labelWidth = ImGui::CalcTextSize(currentLabel.c_str()).x;
-        float centeredX = startPos.x + outerPadding + (contentWidth - labelWidth) * 0.5f;
-
-        ImGui::SetCursorScreenPos(ImVec2(centeredX, labelY));
-        ImGui::Text("%s", currentLabel.c_str());
-
-        // Set cursor position after the entire group content
-        ImGui::SetCursorScreenPos(ImVec2(startPos.x, startPos.y + totalHeight));
-
-        ImGui::PopStyleColor();
+        drawList->ChannelsSetCurrent(0);
+        drawList->AddRectFilled(startPos, endPos, ImGui::GetColorU32(ImGuiCol_WindowBg), 4.0f);
+        drawList->AddRect(startPos, endPos, ImGui::GetColorU32(ImGuiCol_Border), 4.0f);
+        drawList->AddRectFilled(ImVec2(startPos.x + 1, labelTop), ImVec2(endPos.x - 1, endPos.y - 1), ImGui::GetColorU32(ImGuiCol_ChildBg), 4.0f);
+        drawList->AddLine(ImVec2(startPos.x, labelTop), ImVec2(endPos.x, labelTop), ImGui::GetColorU32(ImGuiCol_Border), 1.0f);
+        drawList->ChannelsMerge();
+
+        // Center the label across all the columns
+        const char* labelEnd = group.label.data() + group.label.size();
+        float labelWidth = ImGui::CalcTextSize(group.label.data(), labelEnd).x;
+        ImGui::SetCursorScreenPos(ImVec2(
+            startPos.x + ButtonGroup::outerPadding + (contentWidth - labelWidth) * 0.5f,
+            startPos.y + ButtonGroup::outerPadding + buttonsHeight + ButtonGroup::labelPaddingTop));
+        ImGui::TextUnformatted(group.label.data(), labelEnd);
+
+        // Claim the whole frame so the next group is placed after it
+        ImGui::SetCursorScreenPos(startPos);
+        ImGui::Dummy(ImVec2(totalWidth, totalHeight));
+
+        ImGui::PopID();
         ImGui::EndGroup();
 
         // Position for next element
@@ -21,6 +21,16 @@ struct WindowConfig {
 	std::vector<std::unique_ptr<WBPlugin>> plugins;
 };
 
+/// <summary>
+/// How long each step of a drawn frame took, in milliseconds.
+/// </summary>
+struct FrameTimings {
+	float preRender = 0.0f; // Plugins getting ready, e.g. starting the ImGui frame.
+	float render = 0.0f; // onRender, building the UI.
+	float postRender = 0.0f; // Plugins drawing, e.g. ImGui's draw data.
+	float present = 0.0f; // Including any wait for vsync.
+};
+
 /// <summary>
 /// Base plugin class that can be used to extend the window functionality.
 /// </summary>
@@ -55,6 +65,14 @@ public:
 	/// <param name="window">The window instance.</param>
 	virtual void PostRender(Window&) {}
 
+	/// <summary>
+	/// Called whenever the message loop wakes up, at least every few hundred milliseconds. Frames are only drawn when
+	/// there was input, Window::RequestRedraw was called or a plugin returns true here.
+	/// </summary>
+	/// <param name="window">The window instance.</param>
+	/// <returns>Whether what is on screen is out of date, e.g. new data arrived or something is animating.</returns>
+	virtual bool NeedsRedraw(Window&) { return false; }
+
 	/// <summary>
 	/// Called when the window receives a message but previous handlers have not processed it.
 	/// </summary>
@@ -87,15 +105,17 @@ public:
 
 	/// <summary>
 	/// Shows the window and enters the message loop.
+	/// Nothing is drawn or presented while nothing changed, an idle window costs a wake up to poll the plugins now and then.
 	/// </summary>
 	void Show() {
 		MSG msg = {};
-		constexpr DWORD idleWaitMs = 100; // 10 FPS
+		constexpr DWORD idleWaitMs = 100; // How often plugins are asked whether they need a redraw when there are no events.
 		constexpr DWORD eventsMask = QS_ALLINPUT;
 
 		while (msg.message != WM_QUIT) {
-			// Wait for any event or timeout (for 10 FPS idle rendering)
-			DWORD result = MsgWaitForMultipleObjects(0, nullptr, FALSE, idleWaitMs, eventsMask);
+			// Wait for any event, or just long enough to poll the plugins again. Don't wait at all if a frame is already due
+			DWORD waitMs = pendingFrames.load() > 0 ? 0 : idleWaitMs;
+			MsgWaitForMultipleObjects(0, nullptr, FALSE, waitMs, eventsMask);
 
 			// Messages are available
 			while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
@@ -103,19 +123,41 @@ public:
 				DispatchMessage(&msg);
 			}
 
-			// Always render once per loop, regardless of message presence
+			// Every plugin is asked, so each one sees the state it compares against being drawn
+			bool redraw = false;
+			for (auto& plugin : plugins)
+				redraw |= plugin->NeedsRedraw(*this);
+
+			int pending = pendingFrames.load();
+			while (pending > 0 && !pendingFrames.compare_exchange_weak(pending, pending - 1));
+			if (!redraw && pending == 0)
+				continue;
+
+			using Clock = std::chrono::steady_clock;
+			auto elapsed = [](Clock::time_point& since) {
+				auto now = Clock::now();
+				float ms = std::chrono::duration<float, std::milli>(now - since).count();
+				since = now;
+				return ms;
+			};
+			auto stepStart = Clock::now();
+
 			context->ClearRenderTargetView(renderTargetView, clearColor.data());
 
 			for (auto& plugin : plugins)
 				plugin->PreRender(*this);
+			lastFrame.preRender = elapsed(stepStart);
 
 			if (onRender)
 				onRender(*this);
+			lastFrame.render = elapsed(stepStart);
 
 			for (auto& plugin : plugins)
 				plugin->PostRender(*this);
+			lastFrame.postRender = elapsed(stepStart);
 
 			swapChain->Present(vsync ? 1 : 0, 0);
+			lastFrame.present = elapsed(stepStart);
 		}
 
 		for (auto& plugin : plugins)
@@ -244,6 +286,15 @@ public:
 			plugin->OnLoad(*this);
 	}
 
+	/// <summary>
+	/// Asks for the next `frames` frames to be drawn even if nothing else changed. Safe to call from any thread.
+	/// </summary>
+	void RequestRedraw(int frames = 1) {
+		AddPendingFrames(frames);
+		// Wake the message loop up if it is waiting
+		PostMessage(hWnd, WM_NULL, 0, 0);
+	}
+
 	// DX11/Win32 objects
 	ID3D11Device* device = nullptr;
 	ID3D11DeviceContext* context = nullptr;
@@ -264,11 +315,17 @@ public:
 	std::vector<std::unique_ptr<WBPlugin>> plugins = {};
 	bool useImmersiveTitlebar = false;
 	bool vsync = false;
+	FrameTimings lastFrame; // Of the last frame drawn, the one being drawn still has the previous one's.
+	std::atomic<int> pendingFrames = 1; // Frames still to be drawn whether or not anything changed. The first frame is always drawn.
 
 	// Window procedure
 	static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
 		Window* window = reinterpret_cast<Window*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
 		if (window) {
+			// Any event might change what is drawn. ImGui only settles on hover and active items a frame after the input
+			if (message != WM_NULL)
+				window->AddPendingFrames(inputFrames);
+
 			switch (message) {
 			case WM_SIZE:
 				window->width = LOWORD(lParam);
@@ -290,6 +347,13 @@ public:
 	}
 
 private:
+	static constexpr int inputFrames = 2; // Frames drawn after every event.
+
+	void AddPendingFrames(int frames) {
+		int pending = pendingFrames.load();
+		while (pending < frames && !pendingFrames.compare_exchange_weak(pending, frames));
+	}
+
 	// Default callback implementations
 	static void defaultOnResize(Window& window) {
 		if (window.renderTargetView) window.renderTargetView->Release();
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+/// <summary>
+/// Runs ImGui frames without a window or a GPU, for benchmarking the UI code. Draw lists are built as usual and then
+/// dropped, input is whatever the caller feeds in.
+/// </summary>
+class HeadlessImGui {
+public:
+	/// <summary>
+	/// How long each step of a frame took, in milliseconds.
+	/// </summary>
+	struct FrameTimings {
+		float newFrame = 0.0f;
+		float build = 0.0f; // The callback passed to Frame.
+		float render = 0.0f; // ImGui::Render, finishing the draw lists.
+		int vertices = 0; // Drawn by the frame, to check the UI actually drew something.
+	};
+
+	/// <summary>
+	/// Creates an ImGui context of its own and makes it current.
+	/// </summary>
+	HeadlessImGui(int width, int height) {
+		IMGUI_CHECKVERSION();
+		context = ImGui::CreateContext();
+
+		ImGuiIO& io = ImGui::GetIO();
+		io.IniFilename = nullptr;
+		io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+		io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+		io.DisplaySize = ImVec2(static_cast<float>(width), static_cast<float>(height));
+		io.DeltaTime = 1.0f / 60.0f;
+
+		// Nothing is uploaded anywhere, but ImGui only draws text with a built atlas that has a texture
+		unsigned char* pixels = nullptr;
+		int atlasWidth = 0, atlasHeight = 0;
+		io.Fonts->AddFontDefault();
+		io.Fonts->GetTexDataAsAlpha8(&pixels, &atlasWidth, &atlasHeight);
+		io.Fonts->SetTexID((ImTextureID)(intptr_t)1);
+	}
+
+	~HeadlessImGui() {
+		ImGui::DestroyContext(context);
+	}
+
+	HeadlessImGui(const HeadlessImGui&) = delete;
+	HeadlessImGui& operator=(const HeadlessImGui&) = delete;
+
+	/// <summary>
+	/// Runs one frame with `build` drawing the UI, as onRender would.
+	/// </summary>
+	FrameTimings Frame(const std::function<void()>& build) {
+		using Clock = std::chrono::steady_clock;
+		auto elapsed = [](Clock::time_point& since) {
+			auto now = Clock::now();
+			float ms = std::chrono::duration<float, std::milli>(now - since).count();
+			since = now;
+			return ms;
+		};
+
+		FrameTimings timings;
+		auto stepStart = Clock::now();
+
+		ImGui::NewFrame();
+		timings.newFrame = elapsed(stepStart);
+
+		build();
+		timings.build = elapsed(stepStart);
+
+		ImGui::Render();
+		timings.render = elapsed(stepStart);
+
+		timings.vertices = ImGui::GetDrawData()->TotalVtxCount;
+		return timings;
+	}
+
+	// Synthetic input, takes effect on the next frame
+
+	void MouseMove(float x, float y) { ImGui::GetIO().AddMousePosEvent(x, y); }
+	void MouseButton(int button, bool down) { ImGui::GetIO().AddMouseButtonEvent(button, down); }
+	void MouseWheel(float y) { ImGui::GetIO().AddMouseWheelEvent(0.0f, y); }
+	void Key(ImGuiKey key, bool down) { ImGui::GetIO().AddKeyEvent(key, down); }
+	void Text(const char* text) { ImGui::GetIO().AddInputCharactersUTF8(text); }
+
+private:
+	ImGuiContext* context = nullptr;
+};
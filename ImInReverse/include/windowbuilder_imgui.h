@@ -34,7 +34,17 @@ public:
 		io.Fonts->AddFontFromMemoryTTF((void*)s_lucide_ttf, sizeof(s_lucide_ttf), iconFontSize, &icons_config, icons_ranges);
 		io.Fonts->Build();
 
-		// ImInReverse style from ImThemes
+		ApplyStyle();
+
+		ImGui_ImplWin32_Init(window.hWnd);
+		ImGui_ImplDX11_Init(window.device, window.context);
+	}
+
+	/// <summary>
+	/// The ImInReverse style from ImThemes, applied to the current context. Shared with the headless frames of the benchmark
+	/// so they lay out like the real window.
+	/// </summary>
+	static void ApplyStyle() {
 		ImGuiStyle& style = ImGui::GetStyle();
 
 		style.Alpha = 1.0f;
@@ -122,9 +132,6 @@ public:
 		style.Colors[ImGuiCol_NavWindowingHighlight] = ImVec4(1.0f, 1.0f, 1.0f, 0.699999988079071f);
 		style.Colors[ImGuiCol_NavWindowingDimBg] = ImVec4(0.800000011920929f, 0.800000011920929f, 0.800000011920929f, 0.2000000029802322f);
 		style.Colors[ImGuiCol_ModalWindowDimBg] = ImVec4(0.800000011920929f, 0.800000011920929f, 0.800000011920929f, 0.3499999940395355f);
-
-		ImGui_ImplWin32_Init(window.hWnd);
-		ImGui_ImplDX11_Init(window.device, window.context);
 	}
 
 	void OnUnload(Window& window) override {
@@ -144,7 +151,18 @@ public:
 		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 	}
 
+	bool NeedsRedraw(Window& window) override {
+		// Text cursors blink, held buttons repeat and tooltips show up after a delay, all without any new input
+		const ImGuiIO& io = ImGui::GetIO();
+		return io.WantTextInput || ImGui::IsAnyMouseDown() || std::chrono::steady_clock::now() - lastInput < settleTime;
+	}
+
 	void HandleMessage(Window& window, UINT message, WPARAM wParam, LPARAM lParam) override {
+		if (message != WM_NULL) lastInput = std::chrono::steady_clock::now();
 		ImGui_ImplWin32_WndProcHandler(window.hWnd, message, wParam, lParam);
 	}
+
+private:
+	static constexpr auto settleTime = std::chrono::seconds(1); // Longer than any ImGui hover delay.
+	std::chrono::steady_clock::time_point lastInput;
 };
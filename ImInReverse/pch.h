@@ -8,6 +8,7 @@
 #include <Windows.h>
 #include <dwmapi.h>
 #include <Psapi.h>
+#include <commdlg.h>
 #include <tlhelp32.h>
 #include <Wbemidl.h>
 #include <comdef.h>
@@ -30,6 +31,7 @@
 #include <cstring>
 #include <cassert>
 #include <vector>
+#include <set>
 #include <memory>
 #include <array>
 #include <string>
@@ -0,0 +1,265 @@
+#include "pch.h"
+#include "iir/analyzer.h"
+#include "iir/process.h"
+
+#include <cmath>
+
+using namespace IIR;
+
+namespace {
+	bool IsPlausibleFloat(float value) {
+		float magnitude = std::fabs(value);
+		return std::isfinite(value) && magnitude >= 1e-5f && magnitude <= 1e7f;
+	}
+
+	bool IsPlausibleDouble(double value) {
+		double magnitude = std::fabs(value);
+		return std::isfinite(value) && magnitude >= 1e-5 && magnitude <= 1e12;
+	}
+
+	/// At least four printable characters, optionally followed by a terminator and zeros.
+	bool IsText(uint64_t value) {
+		int printable = 0;
+		for (; printable < 8; printable++) {
+			unsigned char c = static_cast<unsigned char>(value >> (printable * 8));
+			if (c < 32 || c > 126) break;
+		}
+		return printable >= 4 && (printable == 8 || (value >> (printable * 8)) == 0);
+	}
+}
+
+FieldAnalyzer& FieldAnalyzer::GetInstance() {
+	static FieldAnalyzer instance;
+	return instance;
+}
+
+FieldAnalyzer::FieldAnalyzer() = default;
+
+FieldAnalyzer::~FieldAnalyzer() {
+	this->running = false;
+	if (this->hUpdateThread.joinable()) {
+		this->hUpdateThread.join();
+	}
+}
+
+void FieldAnalyzer::Init() {
+	this->running = true;
+	this->hUpdateThread = std::thread(&FieldAnalyzer::UpdateFunction, this);
+}
+
+void FieldAnalyzer::SetTarget(uintptr_t base, size_t classIndex, FieldList layout) {
+	std::lock_guard<std::mutex> lock(targetMtx);
+	target.base = base;
+	target.classIndex = classIndex;
+	target.layout = std::move(layout);
+	target.lastSeen = std::chrono::steady_clock::now();
+}
+
+bool FieldAnalyzer::IsVtable(HANDLE handle, const RegionSnapshot& regions, uintptr_t value) {
+	// Vtables live in the read-only data of a module
+	const MemoryRegion* region = regions.Find(value);
+	if (!region || !region->IsImage() || region->IsExecutable() || !region->IsReadable()) return false;
+
+	auto cached = vtableCache.find(value);
+	if (cached != vtableCache.end()) return cached->second;
+
+	// and their first entry points at code in a module. Only read once per distinct value.
+	uintptr_t entry = 0;
+	SIZE_T sizeRead = 0;
+	bool isVtable = ReadProcessMemory(handle, reinterpret_cast<LPCVOID>(value), &entry, sizeof(entry), &sizeRead) && sizeRead == sizeof(entry);
+	if (isVtable) {
+		const MemoryRegion* code = regions.Find(entry);
+		isVtable = code && code->IsImage() && code->IsExecutable();
+	}
+
+	vtableCache.emplace(value, isVtable);
+	return isVtable;
+}
+
+void FieldAnalyzer::Sample(HANDLE handle, const RegionSnapshot& regions, const std::vector<uint8_t>& bytes) {
+	for (size_t i = 0; i < stats.size(); i++) {
+		auto& s = stats[i];
+
+		uint64_t value;
+		std::memcpy(&value, bytes.data() + i * sizeof(value), sizeof(value));
+
+		if (s.samples > 0 && value != s.last) s.changes = true;
+		s.last = value;
+		s.samples++;
+
+		if (value == 0) {
+			s.zero++;
+		}
+		else {
+			if (regions.IsPointer(static_cast<uintptr_t>(value))) {
+				s.pointers++;
+				if (IsVtable(handle, regions, static_cast<uintptr_t>(value))) s.vtables++;
+			}
+
+			double d;
+			std::memcpy(&d, &value, sizeof(d));
+			if (IsPlausibleDouble(d)) s.doubles++;
+
+			if (IsText(value)) s.text++;
+		}
+
+		for (int h = 0; h < 2; h++) {
+			uint32_t half = static_cast<uint32_t>(value >> (h * 32));
+			if (half == 0) {
+				s.halfZero[h]++;
+				continue;
+			}
+
+			if (half == 1) s.halfBool[h]++;
+
+			int32_t asInt = static_cast<int32_t>(half);
+			if (asInt > -65536 && asInt < 65536) s.halfInt[h]++;
+
+			float f;
+			std::memcpy(&f, &half, sizeof(f));
+			if (IsPlausibleFloat(f)) s.halfFloat[h]++;
+		}
+	}
+}
+
+SlotGuess FieldAnalyzer::Classify(const SlotStats& s, size_t offset) {
+	SlotGuess guess{ offset };
+	guess.changes = s.changes;
+
+	uint32_t n = s.samples;
+	if (n < minSamples) return guess;
+
+	// Zero is compatible with anything, a null pointer or a 0.0 is still that type
+	if (s.zero == n) guess.kind = SlotKind::padding;
+	else if (s.vtables > 0 && s.vtables + s.zero == n) guess.kind = SlotKind::vtable;
+	else if (s.pointers > 0 && s.pointers + s.zero == n) guess.kind = SlotKind::pointer;
+	else if (s.text == n) guess.kind = SlotKind::text;
+	else if (s.doubles > 0 && s.doubles + s.zero == n) guess.kind = SlotKind::f64;
+	else {
+		bool any = false;
+		for (int h = 0; h < 2; h++) {
+			HalfKind& kind = guess.halves[h];
+			if (s.halfZero[h] == n) kind = HalfKind::zero;
+			else if (s.halfBool[h] + s.halfZero[h] == n) kind = HalfKind::boolean;
+			else if (s.halfInt[h] + s.halfZero[h] == n) kind = HalfKind::i32;
+			else if (s.halfFloat[h] + s.halfZero[h] == n) kind = HalfKind::f32;
+
+			any |= kind != HalfKind::unknown && kind != HalfKind::zero;
+		}
+		if (any) guess.kind = SlotKind::halves;
+	}
+
+	return guess;
+}
+
+std::shared_ptr<LayoutProposal> FieldAnalyzer::Propose(const Target& target) const {
+	auto result = std::make_shared<LayoutProposal>();
+	result->classIndex = target.classIndex;
+	result->basis = target.layout;
+
+	result->slots.reserve(stats.size());
+	for (size_t i = 0; i < stats.size(); i++) {
+		result->slots.push_back(Classify(stats[i], i * sizeof(uint64_t)));
+		result->samples = std::max<size_t>(result->samples, stats[i].samples);
+	}
+
+	std::vector<Field> current;
+	current.reserve(target.layout.Size());
+	target.layout.ForEach([&](const Field& f) { current.push_back(f); });
+
+	auto& fields = result->fields;
+	for (size_t i = 0; i < current.size();) {
+		const Field& field = current[i];
+		size_t slot = field.offset / sizeof(uint64_t);
+		bool slotStart = field.offset % sizeof(uint64_t) == 0 && slot < result->slots.size();
+
+		// Only slots made entirely of untyped fields are up for grabs
+		size_t next = i;
+		size_t end = field.offset;
+		while (slotStart && next < current.size() && end < field.offset + 8 &&
+			current[next].fieldType == FieldType::unk && current[next].offset == end) {
+			end += current[next].size;
+			next++;
+		}
+
+		const SlotGuess* guess = slotStart && end == field.offset + 8 ? &result->slots[slot] : nullptr;
+		if (!guess || guess->kind == SlotKind::unknown || guess->kind == SlotKind::padding || guess->kind == SlotKind::text) {
+			fields.push_back(field);
+			i++;
+			continue;
+		}
+
+		size_t offset = field.offset;
+		switch (guess->kind) {
+		case SlotKind::vtable:
+		case SlotKind::pointer:
+			fields.push_back(Field{ FieldType::pointer, offset, 8 });
+			break;
+		case SlotKind::f64:
+			fields.push_back(Field{ FieldType::f64, offset, 8 });
+			break;
+		default:
+			for (int h = 0; h < 2; h++) {
+				size_t halfOffset = offset + h * 4;
+				switch (guess->halves[h]) {
+				case HalfKind::boolean:
+					fields.push_back(Field{ FieldType::boolean, halfOffset, 1 });
+					fields.push_back(Field{ FieldType::unk, halfOffset + 1, 3 });
+					break;
+				case HalfKind::i32: fields.push_back(Field{ FieldType::i32, halfOffset, 4 }); break;
+				case HalfKind::f32: fields.push_back(Field{ FieldType::f32, halfOffset, 4 }); break;
+				default: fields.push_back(Field{ FieldType::unk, halfOffset, 4 }); break;
+				}
+			}
+			break;
+		}
+
+		result->changedSlots++;
+		i = next;
+	}
+
+	return result;
+}
+
+void FieldAnalyzer::UpdateFunction() {
+	auto& pm = IIR::ProcessManager::GetInstance();
+	Target current;
+	uintptr_t lastBase = 0;
+	size_t lastClass = SIZE_MAX;
+	std::vector<uint8_t> bytes;
+
+	while (this->running) {
+		{
+			std::lock_guard<std::mutex> lock(targetMtx);
+			current = target;
+		}
+
+		auto handle = pm.GetHandle();
+		if (handle == nullptr || current.layout.Empty() || std::chrono::steady_clock::now() - current.lastSeen > idleTimeout) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+
+		if (resetRequested.exchange(false) || current.base != lastBase || current.classIndex != lastClass) {
+			stats.clear();
+			vtableCache.clear();
+			proposal.store(nullptr);
+			lastBase = current.base;
+			lastClass = current.classIndex;
+		}
+
+		// Slots are counted from the start of the class, a trailing partial slot is left alone
+		const Field& last = current.layout.Back();
+		size_t slots = (last.offset + last.size) / sizeof(uint64_t);
+		stats.resize(slots);
+		bytes.resize(slots * sizeof(uint64_t));
+
+		SIZE_T sizeRead = 0;
+		if (!bytes.empty() && ReadProcessMemory(handle, reinterpret_cast<LPCVOID>(current.base), bytes.data(), bytes.size(), &sizeRead) && sizeRead == bytes.size()) {
+			Sample(handle, *RegionMap::GetInstance().Get(), bytes);
+			proposal.store(Propose(current));
+		}
+
+		std::this_thread::sleep_for(sampleInterval);
+	}
+}
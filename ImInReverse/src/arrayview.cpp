@@ -0,0 +1,194 @@
+#include "pch.h"
+#include "iir/views.h"
+#include "iir/reader.h"
+
+using namespace IIR;
+
+namespace {
+	struct ArrayViewState {
+		char baseBuf[32] = "0";
+		uintptr_t base = 0;
+		int count = 1024;
+		int stride = 0; // 0 means the size of the class.
+		size_t classIndex = 0;
+		std::vector<size_t> columns; // Offsets of the fields shown as columns, sorted.
+	};
+
+	ArrayViewState state;
+
+	/// Writes a short representation of one field of one element into `out`.
+	void FormatCell(const Field& field, const uint8_t* data, char* out, size_t outSize) {
+		if (!data) {
+			snprintf(out, outSize, "??");
+			return;
+		}
+
+		if (field.fieldType != FieldType::unk) {
+			GetFieldTypeInfo(field.fieldType).format(data, field.size, out, outSize);
+			return;
+		}
+
+		// Untyped columns stay compact
+		auto value = reinterpret_cast<const MemoryData*>(data);
+		switch (field.size) {
+		case 1: snprintf(out, outSize, "%02X", value->u8); break;
+		case 2: snprintf(out, outSize, "%04X", value->u16); break;
+		case 4: snprintf(out, outSize, "%08X", value->u32); break;
+		case 8: snprintf(out, outSize, "%016llX", value->u64); break;
+		default: {
+			// Leading bytes of odd-sized fields
+			size_t written = 0;
+			for (int i = 0; i < std::min(field.size, 8) && written + 3 < outSize; i++)
+				written += snprintf(out + written, outSize - written, "%02X ", data[i]);
+			break;
+		}
+		}
+	}
+}
+
+void IIR::ArrayView(StructureManager& sm, OptionsManager& om, bool* open) {
+	ImGui::SetNextWindowSize(ImVec2(720, 480), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin(ICON_LC_TABLE " Array", open)) {
+		ImGui::End();
+		return;
+	}
+
+	if (state.classIndex >= sm.ClassCount()) state.classIndex = 0;
+	const auto& cls = sm.GetClass(state.classIndex);
+	const auto fields = cls.fields;
+
+	ImGui::SetNextItemWidth(160.0f);
+	if (ImGui::InputText("Base", state.baseBuf, sizeof(state.baseBuf), ImGuiInputTextFlags_CharsHexadecimal)) {
+		state.base = static_cast<uintptr_t>(std::strtoull(state.baseBuf, nullptr, 16));
+	}
+
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(160.0f);
+	if (ImGui::BeginCombo("Class", cls.name.c_str())) {
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(sm.ClassCount()));
+		while (clipper.Step()) {
+			for (size_t c = clipper.DisplayStart; c < static_cast<size_t>(clipper.DisplayEnd); c++) {
+				ImGui::PushID(static_cast<int>(c));
+				if (ImGui::Selectable(sm.ClassName(c).c_str(), c == state.classIndex)) {
+					state.classIndex = c;
+					state.columns.clear();
+				}
+				ImGui::PopID();
+			}
+		}
+		ImGui::EndCombo();
+	}
+
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(120.0f);
+	ImGui::InputInt("Count", &state.count, 1, 1000);
+	state.count = std::clamp(state.count, 0, 10'000'000);
+
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(120.0f);
+	ImGui::InputInt("Stride", &state.stride, 8, 64);
+	state.stride = std::max(state.stride, 0);
+	ImGui::SetItemTooltip("Bytes between elements, 0 uses the size of the class");
+
+	// Default to the first few fields so a huge class doesn't start out as a huge table
+	if (state.columns.empty()) {
+		fields.ForEach(0, std::min<size_t>(fields.Size(), 8), [](const Field& f) { state.columns.push_back(f.offset); });
+	}
+
+	ImGui::SameLine();
+	if (ImGui::Button(ICON_LC_COLUMNS_3 " Columns")) {
+		ImGui::OpenPopup("##array_columns");
+	}
+	if (ImGui::BeginPopup("##array_columns")) {
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(fields.Size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				const auto& f = fields[i];
+				auto it = std::lower_bound(state.columns.begin(), state.columns.end(), f.offset);
+				bool shown = it != state.columns.end() && *it == f.offset;
+
+				char label[32];
+				snprintf(label, sizeof(label), "+0x%zX (%d)", f.offset, f.size);
+				if (ImGui::Checkbox(label, &shown)) {
+					shown ? (void)state.columns.insert(it, f.offset) : (void)state.columns.erase(it);
+				}
+			}
+		}
+		ImGui::EndPopup();
+	}
+
+	// Resolve the chosen columns against the current layout, skipping any that no longer start a field
+	std::vector<Field> columns;
+	for (size_t offset : state.columns) {
+		size_t idx = fields.PartitionPoint([offset](const Field& f) { return f.offset < offset; });
+		if (idx < fields.Size() && fields[idx].offset == offset)
+			columns.push_back(fields[idx]);
+	}
+
+	size_t stride = state.stride > 0 ? static_cast<size_t>(state.stride) : cls.TotalSize();
+	if (columns.empty() || stride == 0 || columns.size() > 62) {
+		ImGui::TextDisabled(columns.size() > 62 ? "Too many columns" : "Nothing to show");
+		ImGui::End();
+		return;
+	}
+
+	// Only the bytes between the first and last shown column are needed from each element
+	size_t spanStart = columns.front().offset;
+	size_t spanEnd = columns.back().offset + columns.back().size;
+
+	auto& reader = MemoryReader::GetInstance();
+	const auto& snapshot = reader.Frame();
+
+	constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_ScrollX | ImGuiTableFlags_RowBg |
+		ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingFixedFit;
+
+	if (ImGui::BeginTable("##array", static_cast<int>(columns.size()) + 2, tableFlags)) {
+		ImGui::TableSetupScrollFreeze(2, 1);
+		ImGui::TableSetupColumn("#");
+		ImGui::TableSetupColumn("Address");
+		for (const auto& column : columns) {
+			char header[24];
+			snprintf(header, sizeof(header), "+0x%zX", column.offset);
+			ImGui::TableSetupColumn(header);
+		}
+		ImGui::TableHeadersRow();
+
+		ImGuiListClipper clipper;
+		clipper.Begin(state.count);
+		while (clipper.Step()) {
+			uintptr_t first = state.base + clipper.DisplayStart * stride;
+			reader.RequestStrided(first + spanStart, stride, spanEnd - spanStart, clipper.DisplayEnd - clipper.DisplayStart);
+
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				uintptr_t element = state.base + i * stride;
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextColored(om.numberColour, "%d", i);
+				ImGui::TableNextColumn();
+				ImGui::TextColored(om.addressColour, "%012llX", (unsigned long long)element);
+
+				for (const auto& column : columns) {
+					ImGui::TableNextColumn();
+
+					char text[256];
+					const uint8_t* data = snapshot.Find(element + column.offset, column.size);
+					FormatCell(column, data, text, sizeof(text));
+					ImGui::TextColored(data ? om.textColour : om.offsetColour, "%s", text);
+
+					if (data && column.size <= 8 && ImGui::IsItemHovered()) {
+						auto value = reinterpret_cast<const MemoryData*>(data);
+						ImGui::SetTooltip("%lld", column.size == 8 ? value->i64 : column.size == 4 ? value->i32 : column.size == 2 ? value->i16 : value->i8);
+					}
+				}
+			}
+		}
+		clipper.End();
+
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "iir/compare.h"
+
+#include <emmintrin.h>
+
+using namespace IIR;
+
+namespace {
+	/// Marks every byte where `a` and `b` differ in `mask`, bytes already marked stay marked.
+	void AccumulateDiff(const uint8_t* a, const uint8_t* b, uint8_t* mask, size_t size) {
+		size_t i = 0;
+		for (; i + 16 <= size; i += 16) {
+			__m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+			__m128i marked = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(mask + i), _mm_or_si128(marked, _mm_andnot_si128(equal, _mm_set1_epi8(-1))));
+		}
+		for (; i < size; i++) mask[i] |= a[i] != b[i] ? 0xFF : 0;
+	}
+
+	bool AnyMarked(const uint8_t* mask, size_t size) {
+		size_t i = 0;
+		for (; i + 16 <= size; i += 16) {
+			if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i)))) return true;
+		}
+		for (; i < size; i++) {
+			if (mask[i]) return true;
+		}
+		return false;
+	}
+
+	/// Maps the raw bytes of a value to a key that sorts the same way the value does for its type.
+	uint64_t SortKey(uint64_t raw, int size, FieldType type) {
+		constexpr uint64_t signBit = 1ull << 63;
+		int unused = 64 - size * 8;
+
+		switch (type) {
+		case FieldType::i8:
+		case FieldType::i16:
+		case FieldType::i32:
+		case FieldType::i64:
+			// Sign extend, then flip the sign so negative numbers sort first
+			return static_cast<uint64_t>(static_cast<int64_t>(raw << unused) >> unused) ^ signBit;
+		case FieldType::f32:
+		case FieldType::f64: {
+			// IEEE floats sort like sign-magnitude integers
+			uint64_t bits = raw << unused;
+			return bits & signBit ? ~bits : bits | signBit;
+		}
+		default:
+			return raw;
+		}
+	}
+
+	uint64_t HashBytes(const uint8_t* data, size_t size) {
+		uint64_t hash = 0xCBF29CE484222325ull; // FNV-1a
+		for (size_t i = 0; i < size; i++) hash = (hash ^ data[i]) * 0x100000001B3ull;
+		return hash;
+	}
+}
+
+Comparison IIR::CompareInstances(const MemorySnapshot& snapshot, std::span<const uintptr_t> bases, const FieldList& layout, size_t size) {
+	Comparison result;
+	result.generation = snapshot.generation;
+	result.layout = layout;
+	result.instances = bases.size();
+
+	std::vector<const uint8_t*> rows;
+	rows.reserve(bases.size());
+	for (uintptr_t base : bases) {
+		if (auto data = snapshot.Find(base, size)) rows.push_back(data);
+	}
+	result.readable = rows.size();
+
+	result.byteDiffers.assign(size, 0);
+	for (size_t i = 1; i < rows.size(); i++) AccumulateDiff(rows[0], rows[i], result.byteDiffers.data(), size);
+
+	result.fields.reserve(layout.Size());
+	std::vector<std::pair<uint64_t, uint64_t>> values; // Sort key and raw value of each instance.
+	values.reserve(rows.size());
+
+	size_t fieldIndex = 0;
+	layout.ForEach([&](const Field& field) {
+		FieldComparison& stats = result.fields.emplace_back();
+		stats.fieldIndex = fieldIndex++;
+		if (rows.empty() || field.offset + field.size > size) return;
+
+		bool small = field.size <= 8;
+		stats.differs = AnyMarked(result.byteDiffers.data() + field.offset, field.size);
+
+		if (!stats.differs) {
+			// Nothing to sort, every instance holds the first one's value
+			stats.distinct = 1;
+			if (small) {
+				stats.hasRange = true;
+				std::memcpy(&stats.min, rows[0] + field.offset, field.size);
+				stats.max = stats.min;
+			}
+			return;
+		}
+
+		values.clear();
+		for (const uint8_t* row : rows) {
+			uint64_t raw = 0;
+			if (small) std::memcpy(&raw, row + field.offset, field.size);
+			else raw = HashBytes(row + field.offset, field.size);
+			values.emplace_back(small ? SortKey(raw, field.size, field.fieldType) : raw, raw);
+		}
+
+		std::sort(values.begin(), values.end());
+		stats.distinct = 1;
+		for (size_t i = 1; i < values.size(); i++) {
+			if (values[i].first != values[i - 1].first) stats.distinct++;
+		}
+
+		if (small) {
+			stats.hasRange = true;
+			stats.min.u64 = values.front().second;
+			stats.max.u64 = values.back().second;
+		}
+	});
+
+	return result;
+}
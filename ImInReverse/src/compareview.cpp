@@ -0,0 +1,201 @@
+#include "pch.h"
+#include "iir/views.h"
+#include "iir/compare.h"
+
+using namespace IIR;
+
+namespace {
+	struct CompareViewState {
+		std::vector<uintptr_t> bases; // Of the watched instances of the current class, gathered every frame.
+
+		char addBuf[512] = "";
+		int arrayCount = 16;
+		int arrayStride = 0; // 0 means the size of the class.
+		bool onlyDiffering = false;
+
+		std::shared_ptr<const Comparison> comparison;
+		uint64_t comparedVersion = 0; // Of the instance list.
+		size_t comparedClass = 0;
+	};
+
+	CompareViewState state;
+
+	// Instances beyond this are still compared, they just don't get a column of their own
+	constexpr size_t maxInstanceColumns = 32;
+
+	/// Watches an instance of the current class at every hex address in `text`, separated by spaces, commas or new lines.
+	void AddBases(StructureManager& sm, const char* text) {
+		for (const char* p = text; *p;) {
+			char* end = nullptr;
+			unsigned long long value = std::strtoull(p, &end, 16);
+			if (end == p) {
+				p++;
+				continue;
+			}
+			if (value) sm.AddInstance(sm.GetCurrentClass(), static_cast<uintptr_t>(value));
+			p = end;
+		}
+	}
+
+	void FormatValue(const Field& field, const uint8_t* data, char* out, size_t outSize) {
+		if (data) GetFieldTypeInfo(field.fieldType).format(data, field.size, out, outSize);
+		else snprintf(out, outSize, "??");
+	}
+}
+
+void IIR::CompareView(StructureManager& sm, OptionsManager& om, bool* open) {
+	ImGui::SetNextWindowSize(ImVec2(820, 520), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin(ICON_LC_GIT_COMPARE " Compare", open)) {
+		ImGui::End();
+		return;
+	}
+
+	if (ImGui::Button(ICON_LC_PLUS " Current")) sm.AddInstance(sm.GetCurrentClass(), sm.GetBase());
+	ImGui::SetItemTooltip("Adds the address the memory pane is showing");
+
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(260.0f);
+	if (ImGui::InputTextWithHint("##add", "Addresses, e.g. 7FF6A000 7FF6B000", state.addBuf, sizeof(state.addBuf), ImGuiInputTextFlags_EnterReturnsTrue)) {
+		AddBases(sm, state.addBuf);
+		state.addBuf[0] = '\0';
+	}
+
+	ImGui::SameLine();
+	if (ImGui::Button(ICON_LC_TABLE " Array")) ImGui::OpenPopup("##compare_array");
+	ImGui::SetItemTooltip("Adds consecutive instances starting at the current address");
+	if (ImGui::BeginPopup("##compare_array")) {
+		ImGui::SetNextItemWidth(120.0f);
+		ImGui::InputInt("Count", &state.arrayCount, 1, 100);
+		state.arrayCount = std::clamp(state.arrayCount, 1, 100'000);
+		ImGui::SetNextItemWidth(120.0f);
+		ImGui::InputInt("Stride", &state.arrayStride, 8, 64);
+		state.arrayStride = std::max(state.arrayStride, 0);
+
+		if (ImGui::Button("Add")) {
+			size_t stride = state.arrayStride > 0 ? static_cast<size_t>(state.arrayStride) : sm.GetSize();
+			for (int i = 0; i < state.arrayCount; i++) sm.AddInstance(sm.GetCurrentClass(), sm.GetBase() + i * stride);
+			ImGui::CloseCurrentPopup();
+		}
+		ImGui::EndPopup();
+	}
+
+	state.bases.clear();
+	sm.GetInstanceBases(sm.GetCurrentClass(), state.bases);
+
+	ImGui::SameLine();
+	ImGui::BeginDisabled(state.bases.empty());
+	if (ImGui::Button(ICON_LC_TRASH " Clear")) sm.ClearInstances(sm.GetCurrentClass());
+	ImGui::EndDisabled();
+
+	ImGui::SameLine();
+	ImGui::Checkbox("Only differing", &state.onlyDiffering);
+
+	// Every instance is read in the same pass, the reader merges the ones that sit close together
+	auto& reader = MemoryReader::GetInstance();
+	const auto layout = sm.GetFields();
+	size_t size = sm.GetSize();
+	RequestInstances(reader, state.bases, size);
+
+	// Only redo the comparison when something it depends on changed
+	const auto& snapshot = reader.Frame();
+	if (!state.comparison || state.comparison->generation != snapshot.generation || !state.comparison->layout.SameVersion(layout) ||
+		state.comparedVersion != sm.GetInstancesVersion() || state.comparedClass != sm.GetCurrentClass()) {
+		state.comparison = std::make_shared<const Comparison>(CompareInstances(snapshot, state.bases, layout, size));
+		state.comparedVersion = sm.GetInstancesVersion();
+		state.comparedClass = sm.GetCurrentClass();
+	}
+	const auto& comparison = *state.comparison;
+
+	ImGui::TextColored(om.numberColour, "%zu instances, %zu readable", comparison.instances, comparison.readable);
+
+	if (comparison.readable < 2) {
+		ImGui::TextDisabled("Add at least two readable instances of %s to compare them", sm.GetName().c_str());
+		ImGui::End();
+		return;
+	}
+
+	size_t instanceColumns = std::min(state.bases.size(), maxInstanceColumns);
+	constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_ScrollX | ImGuiTableFlags_RowBg |
+		ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingFixedFit;
+
+	if (ImGui::BeginTable("##compare", static_cast<int>(instanceColumns) + 5, tableFlags)) {
+		ImGui::TableSetupScrollFreeze(2, 1);
+		ImGui::TableSetupColumn("Offset");
+		ImGui::TableSetupColumn("Field");
+		ImGui::TableSetupColumn("Distinct");
+		ImGui::TableSetupColumn("Min");
+		ImGui::TableSetupColumn("Max");
+		for (size_t i = 0; i < instanceColumns; i++) {
+			char header[24];
+			snprintf(header, sizeof(header), "%llX", static_cast<unsigned long long>(state.bases[i]));
+			ImGui::TableSetupColumn(header);
+		}
+		ImGui::TableHeadersRow();
+
+		// Rows to show, the filter is applied up front so the clipper sees the real row count
+		std::vector<size_t> rows;
+		rows.reserve(comparison.fields.size());
+		for (size_t i = 0; i < comparison.fields.size(); i++) {
+			if (!state.onlyDiffering || comparison.fields[i].differs) rows.push_back(i);
+		}
+
+		ImVec4 differsColour = om.numberColour;
+		differsColour.w = 0.15f;
+
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(rows.size()));
+		while (clipper.Step()) {
+			for (int r = clipper.DisplayStart; r < clipper.DisplayEnd; ++r) {
+				const auto& stats = comparison.fields[rows[r]];
+				const auto& field = layout[stats.fieldIndex];
+
+				ImGui::TableNextRow();
+				if (stats.differs) ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg1, ImGui::GetColorU32(differsColour));
+
+				ImGui::TableNextColumn();
+				ImGui::TextColored(om.offsetColour, "%04zX", field.offset);
+
+				ImGui::TableNextColumn();
+				if (!field.name.empty()) {
+					ImGui::TextColored(om.nameColour, "%s", field.name.c_str());
+					ImGui::SameLine();
+				}
+				ImGui::TextColored(om.typeColour, "%s", GetFieldTypeInfo(field.fieldType).name);
+
+				ImGui::TableNextColumn();
+				if (stats.differs) ImGui::TextColored(om.numberColour, "%zu", stats.distinct);
+				else ImGui::TextDisabled("constant");
+
+				char text[256];
+				ImGui::TableNextColumn();
+				if (stats.hasRange) {
+					FormatValue(field, reinterpret_cast<const uint8_t*>(&stats.min), text, sizeof(text));
+					ImGui::TextColored(om.textColour, "%s", text);
+				}
+				ImGui::TableNextColumn();
+				if (stats.hasRange && stats.differs) {
+					FormatValue(field, reinterpret_cast<const uint8_t*>(&stats.max), text, sizeof(text));
+					ImGui::TextColored(om.textColour, "%s", text);
+				}
+
+				const uint8_t* first = nullptr;
+				for (size_t i = 0; i < instanceColumns; i++) {
+					ImGui::TableNextColumn();
+
+					const uint8_t* data = snapshot.Find(state.bases[i] + field.offset, field.size);
+					if (!first) first = data;
+
+					// Values that differ from the first readable instance stand out
+					bool same = data && first && std::memcmp(data, first, field.size) == 0;
+					FormatValue(field, data, text, sizeof(text));
+					ImGui::TextColored(same ? om.textColour : om.numberColour, "%s", text);
+				}
+			}
+		}
+		clipper.End();
+
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
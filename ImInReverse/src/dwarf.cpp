@@ -0,0 +1,1168 @@
+#include "pch.h"
+#include "iir/dwarf.h"
+
+using namespace IIR;
+
+namespace {
+	// Constants from the DWARF 5 spec, only the ones used here
+	constexpr uint16_t DW_TAG_array_type = 0x01;
+	constexpr uint16_t DW_TAG_class_type = 0x02;
+	constexpr uint16_t DW_TAG_enumeration_type = 0x04;
+	constexpr uint16_t DW_TAG_member = 0x0d;
+	constexpr uint16_t DW_TAG_pointer_type = 0x0f;
+	constexpr uint16_t DW_TAG_reference_type = 0x10;
+	constexpr uint16_t DW_TAG_compile_unit = 0x11;
+	constexpr uint16_t DW_TAG_structure_type = 0x13;
+	constexpr uint16_t DW_TAG_typedef = 0x16;
+	constexpr uint16_t DW_TAG_union_type = 0x17;
+	constexpr uint16_t DW_TAG_inheritance = 0x1c;
+	constexpr uint16_t DW_TAG_ptr_to_member_type = 0x1f;
+	constexpr uint16_t DW_TAG_subrange_type = 0x21;
+	constexpr uint16_t DW_TAG_base_type = 0x24;
+	constexpr uint16_t DW_TAG_const_type = 0x26;
+	constexpr uint16_t DW_TAG_packed_type = 0x2d;
+	constexpr uint16_t DW_TAG_volatile_type = 0x35;
+	constexpr uint16_t DW_TAG_restrict_type = 0x37;
+	constexpr uint16_t DW_TAG_namespace = 0x39;
+	constexpr uint16_t DW_TAG_partial_unit = 0x3c;
+	constexpr uint16_t DW_TAG_type_unit = 0x41;
+	constexpr uint16_t DW_TAG_rvalue_reference_type = 0x42;
+	constexpr uint16_t DW_TAG_atomic_type = 0x47;
+	constexpr uint16_t DW_TAG_immutable_type = 0x4b;
+
+	constexpr uint16_t DW_AT_sibling = 0x01;
+	constexpr uint16_t DW_AT_name = 0x03;
+	constexpr uint16_t DW_AT_byte_size = 0x0b;
+	constexpr uint16_t DW_AT_bit_offset = 0x0c;
+	constexpr uint16_t DW_AT_bit_size = 0x0d;
+	constexpr uint16_t DW_AT_upper_bound = 0x2f;
+	constexpr uint16_t DW_AT_count = 0x37;
+	constexpr uint16_t DW_AT_data_member_location = 0x38;
+	constexpr uint16_t DW_AT_declaration = 0x3c;
+	constexpr uint16_t DW_AT_encoding = 0x3e;
+	constexpr uint16_t DW_AT_specification = 0x47;
+	constexpr uint16_t DW_AT_type = 0x49;
+	constexpr uint16_t DW_AT_signature = 0x69;
+	constexpr uint16_t DW_AT_data_bit_offset = 0x6b;
+	constexpr uint16_t DW_AT_str_offsets_base = 0x72;
+
+	constexpr uint16_t DW_FORM_addr = 0x01;
+	constexpr uint16_t DW_FORM_block2 = 0x03;
+	constexpr uint16_t DW_FORM_block4 = 0x04;
+	constexpr uint16_t DW_FORM_data2 = 0x05;
+	constexpr uint16_t DW_FORM_data4 = 0x06;
+	constexpr uint16_t DW_FORM_data8 = 0x07;
+	constexpr uint16_t DW_FORM_string = 0x08;
+	constexpr uint16_t DW_FORM_block = 0x09;
+	constexpr uint16_t DW_FORM_block1 = 0x0a;
+	constexpr uint16_t DW_FORM_data1 = 0x0b;
+	constexpr uint16_t DW_FORM_flag = 0x0c;
+	constexpr uint16_t DW_FORM_sdata = 0x0d;
+	constexpr uint16_t DW_FORM_strp = 0x0e;
+	constexpr uint16_t DW_FORM_udata = 0x0f;
+	constexpr uint16_t DW_FORM_ref_addr = 0x10;
+	constexpr uint16_t DW_FORM_ref1 = 0x11;
+	constexpr uint16_t DW_FORM_ref2 = 0x12;
+	constexpr uint16_t DW_FORM_ref4 = 0x13;
+	constexpr uint16_t DW_FORM_ref8 = 0x14;
+	constexpr uint16_t DW_FORM_ref_udata = 0x15;
+	constexpr uint16_t DW_FORM_indirect = 0x16;
+	constexpr uint16_t DW_FORM_sec_offset = 0x17;
+	constexpr uint16_t DW_FORM_exprloc = 0x18;
+	constexpr uint16_t DW_FORM_flag_present = 0x19;
+	constexpr uint16_t DW_FORM_strx = 0x1a;
+	constexpr uint16_t DW_FORM_addrx = 0x1b;
+	constexpr uint16_t DW_FORM_ref_sup4 = 0x1c;
+	constexpr uint16_t DW_FORM_strp_sup = 0x1d;
+	constexpr uint16_t DW_FORM_data16 = 0x1e;
+	constexpr uint16_t DW_FORM_line_strp = 0x1f;
+	constexpr uint16_t DW_FORM_ref_sig8 = 0x20;
+	constexpr uint16_t DW_FORM_implicit_const = 0x21;
+	constexpr uint16_t DW_FORM_loclistx = 0x22;
+	constexpr uint16_t DW_FORM_rnglistx = 0x23;
+	constexpr uint16_t DW_FORM_ref_sup8 = 0x24;
+	constexpr uint16_t DW_FORM_strx1 = 0x25;
+	constexpr uint16_t DW_FORM_strx2 = 0x26;
+	constexpr uint16_t DW_FORM_strx3 = 0x27;
+	constexpr uint16_t DW_FORM_strx4 = 0x28;
+	constexpr uint16_t DW_FORM_addrx1 = 0x29;
+	constexpr uint16_t DW_FORM_addrx2 = 0x2a;
+	constexpr uint16_t DW_FORM_addrx3 = 0x2b;
+	constexpr uint16_t DW_FORM_addrx4 = 0x2c;
+	constexpr uint16_t DW_FORM_GNU_addr_index = 0x1f01;
+	constexpr uint16_t DW_FORM_GNU_str_index = 0x1f02;
+	constexpr uint16_t DW_FORM_GNU_ref_alt = 0x1f20;
+	constexpr uint16_t DW_FORM_GNU_strp_alt = 0x1f21;
+
+	constexpr uint8_t DW_UT_type = 0x02;
+	constexpr uint8_t DW_UT_skeleton = 0x04;
+	constexpr uint8_t DW_UT_split_compile = 0x05;
+	constexpr uint8_t DW_UT_split_type = 0x06;
+
+	constexpr uint64_t DW_ATE_boolean = 0x02;
+	constexpr uint64_t DW_ATE_float = 0x04;
+	constexpr uint64_t DW_ATE_signed = 0x05;
+	constexpr uint64_t DW_ATE_signed_char = 0x06;
+	constexpr uint64_t DW_ATE_unsigned = 0x07;
+	constexpr uint64_t DW_ATE_unsigned_char = 0x08;
+	constexpr uint64_t DW_ATE_UTF = 0x10;
+
+	constexpr uint8_t DW_OP_constu = 0x10;
+	constexpr uint8_t DW_OP_plus_uconst = 0x23;
+
+	constexpr uint32_t SHT_NOBITS = 8;
+	constexpr uint64_t SHF_COMPRESSED = 0x800;
+
+	/// Bounds checked little endian reads from a section. Reading past the end sets a flag and returns zeros instead.
+	class Cursor {
+	public:
+		Cursor(const uint8_t* data, uint64_t size) : begin(data), pos(data), end(data + size) {}
+
+		bool Ok() const { return ok; }
+		uint64_t Tell() const { return static_cast<uint64_t>(pos - begin); }
+		uint64_t Remaining() const { return static_cast<uint64_t>(end - pos); }
+
+		void Seek(uint64_t offset) {
+			if (offset > static_cast<uint64_t>(end - begin)) {
+				ok = false;
+				pos = end;
+				return;
+			}
+			pos = begin + offset;
+		}
+
+		void Skip(uint64_t bytes) { Seek(Tell() + std::min(bytes, Remaining() + 1)); }
+
+		uint64_t Read(size_t bytes) {
+			if (Remaining() < bytes) {
+				ok = false;
+				pos = end;
+				return 0;
+			}
+			uint64_t value = 0;
+			for (size_t i = 0; i < bytes; i++) value |= static_cast<uint64_t>(pos[i]) << (i * 8);
+			pos += bytes;
+			return value;
+		}
+
+		uint8_t U8() { return static_cast<uint8_t>(Read(1)); }
+		uint16_t U16() { return static_cast<uint16_t>(Read(2)); }
+		uint32_t U32() { return static_cast<uint32_t>(Read(4)); }
+		uint64_t U64() { return Read(8); }
+		uint64_t Offset(bool is64) { return Read(is64 ? 8 : 4); }
+
+		uint64_t ULEB() {
+			uint64_t value = 0;
+			for (int shift = 0; pos < end; shift += 7) {
+				uint8_t byte = *pos++;
+				if (shift < 64) value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				if (!(byte & 0x80)) return value;
+			}
+			ok = false;
+			return value;
+		}
+
+		int64_t SLEB() {
+			int64_t value = 0;
+			for (int shift = 0; pos < end;) {
+				uint8_t byte = *pos++;
+				if (shift < 64) value |= static_cast<int64_t>(byte & 0x7F) << shift;
+				shift += 7;
+				if (!(byte & 0x80)) {
+					if (shift < 64 && (byte & 0x40)) value |= -(static_cast<int64_t>(1) << shift);
+					return value;
+				}
+			}
+			ok = false;
+			return value;
+		}
+
+		std::string_view CString() {
+			size_t length = strnlen(reinterpret_cast<const char*>(pos), Remaining());
+			std::string_view str(reinterpret_cast<const char*>(pos), length);
+			Skip(length + 1);
+			return str;
+		}
+
+		const uint8_t* Position() const { return pos; }
+
+	private:
+		const uint8_t* begin;
+		const uint8_t* pos;
+		const uint8_t* end;
+		bool ok = true;
+	};
+
+	/// One decoded attribute value.
+	struct Value {
+		enum class Kind { none, constant, reference, string, block, flag } kind = Kind::none;
+		uint64_t number = 0;
+		std::string_view text;
+		const uint8_t* block = nullptr;
+		uint64_t blockSize = 0;
+	};
+
+	/// The offset in a member location expression, which older compilers emit instead of a constant.
+	std::optional<uint64_t> EvaluateLocation(const uint8_t* expr, uint64_t size) {
+		Cursor cursor(expr, size);
+		uint8_t op = cursor.U8();
+		uint64_t value = cursor.ULEB();
+		if (!cursor.Ok() || (op != DW_OP_plus_uconst && op != DW_OP_constu)) return std::nullopt;
+		return value;
+	}
+
+	bool IsRecord(uint16_t tag) {
+		return tag == DW_TAG_structure_type || tag == DW_TAG_class_type || tag == DW_TAG_union_type;
+	}
+}
+
+/// <summary>
+/// Reads DIEs of one unit in order, decoding only the attributes in DwarfFile::Die and skipping the rest.
+/// </summary>
+class DwarfFile::DieReader {
+public:
+	DieReader(DwarfFile& dwarf, Unit& unit) : dwarf(dwarf), unit(unit), abbrevs(dwarf.GetAbbrevs(unit.abbrevOffset)), cursor(dwarf.info.data, dwarf.info.size) {
+		if (!unit.prepared) {
+			// strx forms are relative to an attribute of the unit DIE, fall back to the first contribution until it is read
+			unit.prepared = true;
+			unit.strOffsetsBase = unit.is64 ? 16 : 8;
+
+			Die root;
+			Seek(unit.dieOffset);
+			Next(root);
+		}
+	}
+
+	void Seek(uint64_t offset) { cursor.Seek(offset); }
+	uint64_t Tell() const { return cursor.Tell(); }
+
+	/// <returns>False at the end of the unit or if the DIE could not be decoded.</returns>
+	bool Next(Die& die) {
+		die = Die{};
+		die.offset = cursor.Tell();
+		if (die.offset >= unit.end || !cursor.Ok()) return false;
+
+		uint64_t code = cursor.ULEB();
+		if (code == 0) return cursor.Ok();
+		if (!abbrevs || code >= abbrevs->size() || (*abbrevs)[code].tag == 0) return false;
+
+		const Abbrev& abbrev = (*abbrevs)[code];
+		die.tag = abbrev.tag;
+		die.hasChildren = abbrev.hasChildren;
+
+		for (const auto& spec : abbrev.attributes) {
+			uint16_t form = spec.form;
+			while (form == DW_FORM_indirect && cursor.Ok()) form = static_cast<uint16_t>(cursor.ULEB());
+
+			Value value;
+			if (!ReadValue(form, spec.implicitConst, value)) return false;
+
+			bool constant = value.kind == Value::Kind::constant;
+			switch (spec.name) {
+			case DW_AT_name:
+				if (value.kind == Value::Kind::string) die.name = value.text;
+				break;
+			case DW_AT_byte_size:
+				if (constant) die.byteSize = value.number;
+				break;
+			case DW_AT_bit_size:
+				if (constant) die.bitSize = value.number;
+				break;
+			case DW_AT_bit_offset:
+				if (constant) die.bitOffset = value.number;
+				break;
+			case DW_AT_data_bit_offset:
+				if (constant) die.dataBitOffset = value.number;
+				break;
+			case DW_AT_data_member_location:
+				if (constant) die.memberLocation = value.number;
+				else if (value.kind == Value::Kind::block) die.memberLocation = EvaluateLocation(value.block, value.blockSize);
+				break;
+			case DW_AT_upper_bound:
+				if (constant && !die.count) die.count = value.number + 1;
+				break;
+			case DW_AT_count:
+				if (constant) die.count = value.number;
+				break;
+			case DW_AT_type:
+				if (value.kind == Value::Kind::reference) die.type = value.number;
+				break;
+			case DW_AT_sibling:
+				if (value.kind == Value::Kind::reference) die.sibling = value.number;
+				break;
+			case DW_AT_specification:
+				if (value.kind == Value::Kind::reference) die.specification = value.number;
+				break;
+			case DW_AT_signature:
+				if (value.kind == Value::Kind::reference) die.signature = value.number;
+				break;
+			case DW_AT_encoding:
+				if (constant) die.encoding = value.number;
+				break;
+			case DW_AT_declaration:
+				die.declaration = value.kind == Value::Kind::flag && value.number;
+				break;
+			case DW_AT_str_offsets_base:
+				if (constant) unit.strOffsetsBase = value.number;
+				break;
+			}
+		}
+
+		return cursor.Ok();
+	}
+
+	/// Moves past the children of the DIE that was just read.
+	void SkipChildren(const Die& parent) {
+		if (!parent.hasChildren) return;
+		if (parent.sibling > parent.offset && parent.sibling < unit.end) {
+			Seek(parent.sibling);
+			return;
+		}
+
+		for (int depth = 1; depth > 0;) {
+			Die die;
+			if (!Next(die)) return;
+			if (die.tag == 0) depth--;
+			else if (die.hasChildren) {
+				if (die.sibling > die.offset && die.sibling < unit.end) Seek(die.sibling);
+				else depth++;
+			}
+		}
+	}
+
+private:
+	bool ReadValue(uint16_t form, int64_t implicitConst, Value& value) {
+		auto constant = [&](uint64_t number) { value.kind = Value::Kind::constant; value.number = number; };
+		auto reference = [&](uint64_t offset) { value.kind = Value::Kind::reference; value.number = offset; };
+		auto block = [&](uint64_t size) {
+			value.kind = Value::Kind::block;
+			value.block = cursor.Position();
+			value.blockSize = std::min(size, cursor.Remaining());
+			cursor.Skip(size);
+		};
+		auto string = [&](std::string_view text) { value.kind = Value::Kind::string; value.text = text; };
+		auto flag = [&](bool set) { value.kind = Value::Kind::flag; value.number = set; };
+
+		switch (form) {
+		case DW_FORM_addr: cursor.Skip(unit.addressSize); break;
+		case DW_FORM_block1: block(cursor.U8()); break;
+		case DW_FORM_block2: block(cursor.U16()); break;
+		case DW_FORM_block4: block(cursor.U32()); break;
+		case DW_FORM_block:
+		case DW_FORM_exprloc: block(cursor.ULEB()); break;
+		case DW_FORM_data1: constant(cursor.U8()); break;
+		case DW_FORM_data2: constant(cursor.U16()); break;
+		case DW_FORM_data4: constant(cursor.U32()); break;
+		case DW_FORM_data8: constant(cursor.U64()); break;
+		case DW_FORM_data16: cursor.Skip(16); break;
+		case DW_FORM_sdata: constant(static_cast<uint64_t>(cursor.SLEB())); break;
+		case DW_FORM_udata: constant(cursor.ULEB()); break;
+		case DW_FORM_implicit_const: constant(static_cast<uint64_t>(implicitConst)); break;
+		case DW_FORM_string: string(cursor.CString()); break;
+		case DW_FORM_strp: string(StringAt(dwarf.str, cursor.Offset(unit.is64))); break;
+		case DW_FORM_line_strp: string(StringAt(dwarf.lineStr, cursor.Offset(unit.is64))); break;
+		case DW_FORM_strx:
+		case DW_FORM_GNU_str_index: string(IndexedString(cursor.ULEB())); break;
+		case DW_FORM_strx1: string(IndexedString(cursor.Read(1))); break;
+		case DW_FORM_strx2: string(IndexedString(cursor.Read(2))); break;
+		case DW_FORM_strx3: string(IndexedString(cursor.Read(3))); break;
+		case DW_FORM_strx4: string(IndexedString(cursor.Read(4))); break;
+		case DW_FORM_strp_sup:
+		case DW_FORM_GNU_strp_alt: cursor.Offset(unit.is64); break; // In a supplementary file we do not have.
+		case DW_FORM_flag: flag(cursor.U8() != 0); break;
+		case DW_FORM_flag_present: flag(true); break;
+		case DW_FORM_ref1: reference(unit.offset + cursor.Read(1)); break;
+		case DW_FORM_ref2: reference(unit.offset + cursor.Read(2)); break;
+		case DW_FORM_ref4: reference(unit.offset + cursor.Read(4)); break;
+		case DW_FORM_ref8: reference(unit.offset + cursor.Read(8)); break;
+		case DW_FORM_ref_udata: reference(unit.offset + cursor.ULEB()); break;
+		case DW_FORM_ref_addr: reference(unit.version == 2 ? cursor.Read(unit.addressSize) : cursor.Offset(unit.is64)); break;
+		case DW_FORM_ref_sig8: {
+			auto it = dwarf.typeSignatures.find(cursor.U64());
+			if (it != dwarf.typeSignatures.end()) reference(it->second);
+			break;
+		}
+		case DW_FORM_ref_sup4: cursor.Skip(4); break;
+		case DW_FORM_ref_sup8: cursor.Skip(8); break;
+		case DW_FORM_GNU_ref_alt: cursor.Offset(unit.is64); break;
+		case DW_FORM_sec_offset: constant(cursor.Offset(unit.is64)); break;
+		case DW_FORM_addrx:
+		case DW_FORM_loclistx:
+		case DW_FORM_rnglistx:
+		case DW_FORM_GNU_addr_index: cursor.ULEB(); break;
+		case DW_FORM_addrx1: cursor.Skip(1); break;
+		case DW_FORM_addrx2: cursor.Skip(2); break;
+		case DW_FORM_addrx3: cursor.Skip(3); break;
+		case DW_FORM_addrx4: cursor.Skip(4); break;
+		default:
+			// Without knowing its size nothing after it can be read
+			spdlog::warn("Unknown DWARF form 0x{:X} in the unit at 0x{:X}", form, unit.offset);
+			return false;
+		}
+
+		return cursor.Ok();
+	}
+
+	static std::string_view StringAt(const Section& section, uint64_t offset) {
+		if (offset >= section.size) return {};
+		auto str = reinterpret_cast<const char*>(section.data + offset);
+		return std::string_view(str, strnlen(str, section.size - offset));
+	}
+
+	std::string_view IndexedString(uint64_t index) {
+		uint64_t entrySize = unit.is64 ? 8 : 4;
+		if (index >= dwarf.strOffsets.size / entrySize) return {};
+
+		Cursor entry(dwarf.strOffsets.data, dwarf.strOffsets.size);
+		entry.Seek(unit.strOffsetsBase + index * entrySize);
+		uint64_t offset = entry.Offset(unit.is64);
+		return entry.Ok() ? StringAt(dwarf.str, offset) : std::string_view();
+	}
+
+	DwarfFile& dwarf;
+	Unit& unit;
+	const std::vector<Abbrev>* abbrevs;
+	Cursor cursor;
+};
+
+/// <summary>
+/// Turns a record DIE into classes. Embedded records become classes of their own (once each), anonymous ones are flattened
+/// into their parent, and the layouts are only handed to the StructureManager at the end so pointers can find their pointee.
+/// </summary>
+class DwarfFile::Importer {
+public:
+	Importer(DwarfFile& dwarf, StructureManager& sm) : dwarf(dwarf), sm(sm) {}
+
+	/// <param name="reuse">Use an existing class with the same name instead, for the types a record depends on.</param>
+	size_t ImportRecord(const Die& record, const std::string& name, bool reuse) {
+		auto known = classes.find(record.offset);
+		if (known != classes.end()) return known->second;
+
+		if (reuse) {
+			for (size_t c = 0; c < sm.ClassCount(); c++) {
+				if (sm.ClassName(c) == name && static_cast<uint64_t>(sm.ClassSize(c)) == record.byteSize.value_or(0)) {
+					classes.emplace(record.offset, c);
+					return c;
+				}
+			}
+		}
+
+		// Registered before the members so a member pointing back at this record finds it
+		size_t classIndex = sm.AddClass(name);
+		classes.emplace(record.offset, classIndex);
+		size_t slot = pending.size();
+		pending.push_back({ classIndex, {} });
+
+		std::vector<Piece> pieces;
+		CollectMembers(record, 0, pieces, 0);
+		pending[slot].pieces = Layout(std::move(pieces), std::max<uint64_t>(record.byteSize.value_or(1), 1));
+
+		return classIndex;
+	}
+
+	/// Gives every imported class its fields.
+	void Finish() {
+		for (auto& [classIndex, pieces] : pending) {
+			std::vector<Field> fields;
+			fields.reserve(pieces.size());
+			for (auto& piece : pieces) {
+				if (piece.pointee) {
+					auto target = classes.find(piece.pointee);
+					if (target != classes.end()) piece.field.classIndex = static_cast<int>(target->second);
+				}
+				fields.push_back(std::move(piece.field));
+			}
+			sm.SetClassFields(classIndex, FieldList().Insert(0, fields));
+		}
+		pending.clear();
+	}
+
+private:
+	struct Piece {
+		Field field;
+		uint64_t pointee = 0; // DIE of the record a pointer points at.
+	};
+
+	struct Pending {
+		size_t classIndex;
+		std::vector<Piece> pieces;
+	};
+
+	static constexpr int maxDepth = 32;
+
+	template<typename F>
+	void ForEachChild(uint64_t offset, F&& callback) {
+		Unit* unit = dwarf.FindUnit(offset);
+		if (!unit) return;
+
+		DieReader reader(dwarf, *unit);
+		reader.Seek(offset);
+
+		Die parent;
+		if (!reader.Next(parent) || !parent.hasChildren) return;
+
+		Die child;
+		while (reader.Next(child) && child.tag != 0) {
+			callback(child);
+			reader.SkipChildren(child);
+		}
+	}
+
+	/// Follows typedefs and qualifiers to the type they name.
+	std::optional<Die> Resolve(uint64_t type) {
+		Die die;
+		for (int i = 0; i < maxDepth; i++) {
+			if (!type || !dwarf.ReadDie(type, die)) return std::nullopt;
+
+			switch (die.tag) {
+			case DW_TAG_typedef:
+			case DW_TAG_const_type:
+			case DW_TAG_volatile_type:
+			case DW_TAG_restrict_type:
+			case DW_TAG_atomic_type:
+			case DW_TAG_immutable_type:
+			case DW_TAG_packed_type:
+				type = die.type;
+				continue;
+			}
+
+			if (IsRecord(die.tag) && die.signature) {
+				type = die.signature;
+				continue;
+			}
+
+			// Forward declarations are common, look for the definition among the units indexed so far
+			if (IsRecord(die.tag) && die.declaration && !die.name.empty()) {
+				auto name = dwarf.DeclarationName(die.offset);
+				if (!name) return std::nullopt;
+				auto definition = dwarf.index.find(std::string(*name));
+				if (definition == dwarf.index.end() || definition->second == die.offset || !dwarf.ReadDie(definition->second, die)) return std::nullopt;
+			}
+			return die;
+		}
+		return std::nullopt;
+	}
+
+	uint8_t AddressSize(const Die& die) {
+		Unit* unit = dwarf.FindUnit(die.offset);
+		return unit ? unit->addressSize : 8;
+	}
+
+	std::optional<uint64_t> ArrayCount(const Die& array) {
+		uint64_t count = 1;
+		bool any = false;
+		ForEachChild(array.offset, [&](const Die& child) {
+			if (child.tag != DW_TAG_subrange_type) return;
+			count *= child.count.value_or(0);
+			any = true;
+		});
+		return any && count ? std::optional<uint64_t>(count) : std::nullopt;
+	}
+
+	std::optional<uint64_t> TypeSize(uint64_t type, int depth) {
+		auto die = Resolve(type);
+		if (!die || depth > maxDepth) return std::nullopt;
+		if (die->byteSize) return die->byteSize;
+
+		switch (die->tag) {
+		case DW_TAG_pointer_type:
+		case DW_TAG_reference_type:
+		case DW_TAG_rvalue_reference_type:
+			return AddressSize(*die);
+		case DW_TAG_array_type: {
+			auto count = ArrayCount(*die);
+			auto element = TypeSize(die->type, depth + 1);
+			if (count && element) return *count * *element;
+			break;
+		}
+		}
+		return std::nullopt;
+	}
+
+	static FieldType IntegerType(uint64_t size, bool isSigned) {
+		switch (size) {
+		case 1: return isSigned ? FieldType::i8 : FieldType::u8;
+		case 2: return isSigned ? FieldType::i16 : FieldType::u16;
+		case 4: return isSigned ? FieldType::i32 : FieldType::u32;
+		case 8: return isSigned ? FieldType::i64 : FieldType::u64;
+		default: return FieldType::unk;
+		}
+	}
+
+	static FieldType BaseType(const Die& die) {
+		uint64_t size = die.byteSize.value_or(0);
+		switch (die.encoding) {
+		case DW_ATE_boolean: return size == 1 ? FieldType::boolean : IntegerType(size, false);
+		case DW_ATE_float: return size == 4 ? FieldType::f32 : size == 8 ? FieldType::f64 : FieldType::unk;
+		case DW_ATE_signed:
+		case DW_ATE_signed_char: return IntegerType(size, true);
+		case DW_ATE_unsigned:
+		case DW_ATE_unsigned_char:
+		case DW_ATE_UTF: return IntegerType(size, false);
+		default: return FieldType::unk;
+		}
+	}
+
+	static bool IsCharacter(const Die& die) {
+		return die.tag == DW_TAG_base_type && die.byteSize == 1 &&
+			(die.encoding == DW_ATE_signed_char || die.encoding == DW_ATE_unsigned_char || die.encoding == DW_ATE_UTF);
+	}
+
+	static void AddBytes(uint64_t offset, uint64_t size, std::string name, std::vector<Piece>& out) {
+		if (size) out.push_back({ Field{ FieldType::unk, offset, static_cast<int>(std::min<uint64_t>(size, INT_MAX)), -1, std::move(name) } });
+	}
+
+	static void AddTyped(FieldType type, uint64_t offset, uint64_t size, std::string name, std::vector<Piece>& out) {
+		if (type != FieldType::unk && FitsType(type, static_cast<int>(size)))
+			out.push_back({ Field{ type, offset, static_cast<int>(size), -1, std::move(name) } });
+		else
+			AddBytes(offset, size, std::move(name), out);
+	}
+
+	void AddMember(uint64_t type, uint64_t offset, std::string name, std::optional<uint64_t> size, std::vector<Piece>& out, int depth) {
+		auto die = depth < maxDepth ? Resolve(type) : std::nullopt;
+		if (!die) {
+			AddBytes(offset, size.value_or(0), std::move(name), out);
+			return;
+		}
+
+		switch (die->tag) {
+		case DW_TAG_base_type:
+			AddTyped(BaseType(*die), offset, die->byteSize.value_or(0), std::move(name), out);
+			return;
+
+		case DW_TAG_enumeration_type:
+			AddTyped(IntegerType(die->byteSize.value_or(0), false), offset, die->byteSize.value_or(0), std::move(name), out);
+			return;
+
+		case DW_TAG_pointer_type:
+		case DW_TAG_reference_type:
+		case DW_TAG_rvalue_reference_type: {
+			uint64_t pointerSize = die->byteSize.value_or(AddressSize(*die));
+			auto pointee = Resolve(die->type);
+			if (pointee && IsCharacter(*pointee)) {
+				AddTyped(FieldType::str, offset, pointerSize, std::move(name), out);
+				return;
+			}
+
+			AddTyped(FieldType::pointer, offset, pointerSize, std::move(name), out);
+			if (pointee && IsRecord(pointee->tag) && out.back().field.fieldType == FieldType::pointer) out.back().pointee = pointee->offset;
+			return;
+		}
+
+		case DW_TAG_structure_type:
+		case DW_TAG_class_type:
+		case DW_TAG_union_type:
+			if (!die->byteSize) break;
+			if (die->name.empty()) {
+				// Anonymous structs and unions are only ever used in place, their members belong to the parent
+				CollectMembers(*die, offset, out, depth + 1);
+			}
+			else if (*die->byteSize) {
+				int classIndex = static_cast<int>(ImportRecord(*die, std::string(die->name), true));
+				out.push_back({ Field{ FieldType::instance, offset, static_cast<int>(*die->byteSize), classIndex, std::move(name) } });
+			}
+			return;
+
+		case DW_TAG_array_type: {
+			auto count = ArrayCount(*die);
+			auto elementSize = TypeSize(die->type, depth);
+			auto element = Resolve(die->type);
+			if (!count || !elementSize || !element || !*elementSize) break;
+
+			if (element->tag == DW_TAG_base_type && element->encoding == DW_ATE_float && element->byteSize == 4) {
+				FieldType vector = FieldType::unk;
+				switch (*count) {
+				case 2: vector = FieldType::vec2; break;
+				case 3: vector = FieldType::vec3; break;
+				case 4: vector = FieldType::vec4; break;
+				case 12: vector = FieldType::mat3x4; break;
+				case 16: vector = FieldType::mat4x4; break;
+				}
+				if (vector != FieldType::unk) {
+					AddTyped(vector, offset, *count * 4, std::move(name), out);
+					return;
+				}
+			}
+
+			// Short arrays read better one element per row, text and big buffers stay as bytes
+			constexpr uint64_t maxExpanded = 16;
+			if (*count <= maxExpanded && !IsCharacter(*element)) {
+				for (uint64_t i = 0; i < *count; i++)
+					AddMember(die->type, offset + i * *elementSize, std::format("{}[{}]", name, i), elementSize, out, depth + 1);
+				return;
+			}
+
+			AddBytes(offset, *count * *elementSize, std::move(name), out);
+			return;
+		}
+		}
+
+		AddBytes(offset, size ? *size : die->byteSize.value_or(0), std::move(name), out);
+	}
+
+	/// True for records without data members, e.g. allocators and tag types.
+	bool IsEmpty(const Die& record, int depth) {
+		bool empty = true;
+		ForEachChild(record.offset, [&](const Die& child) {
+			if (!empty || child.declaration) return;
+			if (child.tag == DW_TAG_member) {
+				empty = false;
+			}
+			else if (child.tag == DW_TAG_inheritance) {
+				auto baseRecord = depth < maxDepth ? Resolve(child.type) : std::nullopt;
+				empty = baseRecord && IsRecord(baseRecord->tag) && IsEmpty(*baseRecord, depth + 1);
+			}
+		});
+		return empty;
+	}
+
+	void CollectMembers(const Die& record, uint64_t base, std::vector<Piece>& out, int depth) {
+		if (record.tag == DW_TAG_union_type) {
+			// Only one member of a union can be shown, use the biggest so every byte is covered by it
+			std::vector<Piece> best;
+			uint64_t bestEnd = 0;
+			ForEachChild(record.offset, [&](const Die& member) {
+				if (member.tag != DW_TAG_member || member.declaration) return;
+
+				std::vector<Piece> pieces;
+				AddMember(member.type, base, std::string(member.name), member.byteSize, pieces, depth);
+				uint64_t end = 0;
+				for (const auto& piece : pieces) end = std::max(end, piece.field.offset + piece.field.size);
+				if (end > bestEnd) {
+					best = std::move(pieces);
+					bestEnd = end;
+				}
+			});
+			out.insert(out.end(), std::make_move_iterator(best.begin()), std::make_move_iterator(best.end()));
+			return;
+		}
+
+		std::vector<Die> members;
+		ForEachChild(record.offset, [&](const Die& member) {
+			if ((member.tag == DW_TAG_member || member.tag == DW_TAG_inheritance) && !member.declaration) // Static members are declarations.
+				members.push_back(member);
+		});
+
+		auto locationOf = [](const Die& member) { return member.memberLocation.value_or(member.dataBitOffset.value_or(0) / 8); };
+
+		for (const auto& member : members) {
+			uint64_t location = locationOf(member);
+
+			if (member.bitSize) {
+				// Bitfields are shown as the bytes that hold them
+				std::optional<uint64_t> firstBit = member.dataBitOffset;
+				if (!firstBit && member.bitOffset && member.byteSize)
+					firstBit = location * 8 + *member.byteSize * 8 - *member.bitOffset - *member.bitSize;
+
+				uint64_t begin = location, end = location + member.byteSize.value_or(1);
+				if (firstBit) {
+					begin = *firstBit / 8;
+					end = (*firstBit + *member.bitSize + 7) / 8;
+				}
+				AddBytes(base + begin, end - begin, std::string(member.name), out);
+				continue;
+			}
+
+			if (member.tag == DW_TAG_inheritance) {
+				auto baseRecord = depth < maxDepth ? Resolve(member.type) : std::nullopt;
+				if (baseRecord && IsRecord(baseRecord->tag) && baseRecord->byteSize) {
+					// Empty bases take no space, the first member is usually at the same offset
+					if (IsEmpty(*baseRecord, depth)) continue;
+
+					// The ABI can put members in the tail padding of a base, then the base can not be one field
+					uint64_t end = location + *baseRecord->byteSize;
+					bool shared = std::any_of(members.begin(), members.end(), [&](const Die& other) {
+						return &other != &member && locationOf(other) >= location && locationOf(other) < end;
+					});
+					if (shared) {
+						CollectMembers(*baseRecord, base + location, out, depth + 1);
+						continue;
+					}
+				}
+			}
+
+			AddMember(member.type, base + location, std::string(member.name), member.byteSize, out, depth);
+		}
+	}
+
+	/// <summary>
+	/// Sorts the pieces of a record into a contiguous layout of exactly `size` bytes. Gaps and untyped bytes become
+	/// pieces of at most 8 bytes, and pieces overlapping one already placed are dropped.
+	/// </summary>
+	static std::vector<Piece> Layout(std::vector<Piece> pieces, uint64_t size) {
+		// Typed pieces go first at the same offset, untyped bytes there are usually the storage of a bitfield
+		std::stable_sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) {
+			bool aBytes = a.field.fieldType == FieldType::unk, bBytes = b.field.fieldType == FieldType::unk;
+			return a.field.offset != b.field.offset ? a.field.offset < b.field.offset : !aBytes && bBytes;
+		});
+
+		std::vector<Piece> layout;
+		uint64_t cursor = 0;
+
+		auto addBytes = [&](uint64_t end, std::string name) {
+			while (cursor < end) {
+				// Keep the pieces aligned so the 8-byte rows line up with pointers and doubles
+				uint64_t length = 8;
+				while (length > 1 && (cursor % length || cursor + length > end)) length /= 2;
+				layout.push_back({ Field{ FieldType::unk, cursor, static_cast<int>(length), -1, std::move(name) } });
+				name.clear();
+				cursor += length;
+			}
+		};
+
+		for (auto& piece : pieces) {
+			uint64_t begin = piece.field.offset;
+			uint64_t end = std::min(begin + piece.field.size, size);
+
+			if (piece.field.fieldType == FieldType::unk) {
+				// Bitfields sharing storage overlap, keep whatever part is new
+				addBytes(std::max(cursor, begin), {});
+				addBytes(end, std::move(piece.field.name));
+				continue;
+			}
+
+			if (begin < cursor || begin + piece.field.size > size) continue;
+			addBytes(begin, {});
+			cursor = begin + piece.field.size;
+			layout.push_back(std::move(piece));
+		}
+
+		addBytes(size, {});
+		return layout;
+	}
+
+	DwarfFile& dwarf;
+	StructureManager& sm;
+	std::unordered_map<uint64_t, size_t> classes; // Record DIE to the class made for it.
+	std::vector<Pending> pending;
+};
+
+std::shared_ptr<DwarfFile> DwarfFile::Open(const std::filesystem::path& path) {
+	std::shared_ptr<DwarfFile> dwarf(new DwarfFile());
+
+	dwarf->file = MappedFile::Open(path);
+	if (!dwarf->file) return nullptr;
+
+	const uint8_t* data = dwarf->file->Data();
+	uint64_t size = dwarf->file->Size();
+	if (size < 0x40 || std::memcmp(data, "\x7F" "ELF", 4) != 0) {
+		spdlog::error("{} is not an ELF file", path.string());
+		return nullptr;
+	}
+
+	bool elf64 = data[4] == 2;
+	if ((data[4] != 1 && data[4] != 2) || data[5] != 1) {
+		spdlog::error("{} is not a little endian ELF file", path.string());
+		return nullptr;
+	}
+
+	Cursor elf(data, size);
+	auto read = [&](uint64_t offset, size_t bytes) {
+		elf.Seek(offset);
+		return elf.Read(bytes);
+	};
+
+	uint64_t sectionTable = elf64 ? read(0x28, 8) : read(0x20, 4);
+	uint64_t entrySize = read(elf64 ? 0x3A : 0x2E, 2);
+	uint64_t sectionCount = read(elf64 ? 0x3C : 0x30, 2);
+	uint64_t namesIndex = read(elf64 ? 0x3E : 0x32, 2);
+	if (!sectionTable || entrySize < (elf64 ? 64u : 40u)) {
+		spdlog::error("{} has no section headers", path.string());
+		return nullptr;
+	}
+
+	// Counts that do not fit in the ELF header are kept in the first section header
+	if (sectionCount == 0) sectionCount = elf64 ? read(sectionTable + 32, 8) : read(sectionTable + 20, 4);
+	if (namesIndex == 0xFFFF) namesIndex = read(sectionTable + (elf64 ? 40 : 24), 4);
+
+	if (!elf.Ok() || sectionTable > size || sectionCount > (size - sectionTable) / entrySize || namesIndex >= sectionCount) {
+		spdlog::error("{} has corrupt section headers", path.string());
+		return nullptr;
+	}
+
+	struct SectionHeader {
+		uint64_t name, type, flags, offset, size;
+	};
+	auto header = [&](uint64_t index) {
+		uint64_t at = sectionTable + index * entrySize;
+		if (elf64) return SectionHeader{ read(at, 4), read(at + 4, 4), read(at + 8, 8), read(at + 24, 8), read(at + 32, 8) };
+		return SectionHeader{ read(at, 4), read(at + 4, 4), read(at + 8, 4), read(at + 16, 4), read(at + 20, 4) };
+	};
+
+	SectionHeader names = header(namesIndex);
+	if (!dwarf->file->Contains(names.offset, names.size)) {
+		spdlog::error("{} has corrupt section headers", path.string());
+		return nullptr;
+	}
+
+	const std::pair<std::string_view, Section*> wanted[] = {
+		{ ".debug_info", &dwarf->info },
+		{ ".debug_abbrev", &dwarf->abbrev },
+		{ ".debug_str", &dwarf->str },
+		{ ".debug_line_str", &dwarf->lineStr },
+		{ ".debug_str_offsets", &dwarf->strOffsets },
+	};
+
+	for (uint64_t i = 0; i < sectionCount; i++) {
+		SectionHeader section = header(i);
+		if (section.name >= names.size || section.type == SHT_NOBITS) continue;
+
+		auto nameChars = reinterpret_cast<const char*>(data + names.offset + section.name);
+		std::string_view name(nameChars, strnlen(nameChars, names.size - section.name));
+		if (name.starts_with(".zdebug_")) section.flags |= SHF_COMPRESSED;
+		if (name == ".debug_types") spdlog::warn("{} has DWARF 4 type units in .debug_types, types defined only there are not found", path.string());
+
+		for (auto& [sectionName, target] : wanted) {
+			// Split DWARF (.dwo) files use the same sections with a suffix, .zdebug is the old GNU compression
+			if (name.ends_with(".dwo")) name.remove_suffix(4);
+			if (name != sectionName && !(name.starts_with(".z") && name.substr(2) == sectionName.substr(1))) continue;
+
+			if (section.flags & SHF_COMPRESSED) {
+				spdlog::error("{} has compressed debug info, decompress it with `objcopy --decompress-debug-sections` first", path.string());
+				return nullptr;
+			}
+			if (!dwarf->file->Contains(section.offset, section.size)) {
+				spdlog::error("Section {} of {} is outside the file", name, path.string());
+				return nullptr;
+			}
+			*target = { data + section.offset, section.size };
+		}
+	}
+
+	if (!dwarf->info.size || !dwarf->abbrev.size) {
+		spdlog::error("{} has no DWARF debug info", path.string());
+		return nullptr;
+	}
+
+	// Only the unit headers are read here, everything inside a unit waits until it is indexed
+	Cursor info(dwarf->info.data, dwarf->info.size);
+	while (info.Remaining() > 0 && info.Ok()) {
+		Unit unit;
+		unit.offset = info.Tell();
+
+		uint64_t length = info.U32();
+		if (length == 0xFFFFFFFF) {
+			unit.is64 = true;
+			length = info.U64();
+		}
+		if (!info.Ok() || length > info.Remaining()) {
+			spdlog::warn("{} has a truncated unit at 0x{:X}", path.string(), unit.offset);
+			break;
+		}
+		unit.end = info.Tell() + length;
+
+		unit.version = info.U16();
+		if (unit.version >= 5) {
+			uint8_t type = info.U8();
+			unit.addressSize = info.U8();
+			unit.abbrevOffset = info.Offset(unit.is64);
+			if (type == DW_UT_skeleton || type == DW_UT_split_compile) {
+				info.Skip(8); // dwo_id
+			}
+			else if (type == DW_UT_type || type == DW_UT_split_type) {
+				uint64_t signature = info.U64();
+				uint64_t typeOffset = info.Offset(unit.is64);
+				dwarf->typeSignatures.emplace(signature, unit.offset + typeOffset);
+			}
+		}
+		else {
+			unit.abbrevOffset = info.Offset(unit.is64);
+			unit.addressSize = info.U8();
+		}
+		unit.dieOffset = info.Tell();
+
+		if (info.Ok() && unit.version >= 2 && unit.version <= 5 && unit.dieOffset <= unit.end)
+			dwarf->units.push_back(unit);
+
+		info.Seek(unit.end);
+	}
+
+	spdlog::info("Opened {} ({} units)", path.string(), dwarf->units.size());
+	return dwarf;
+}
+
+DwarfFile::Unit* DwarfFile::FindUnit(uint64_t dieOffset) {
+	auto it = std::upper_bound(units.begin(), units.end(), dieOffset, [](uint64_t offset, const Unit& unit) { return offset < unit.offset; });
+	if (it == units.begin()) return nullptr;
+
+	Unit& unit = *std::prev(it);
+	return dieOffset >= unit.dieOffset && dieOffset < unit.end ? &unit : nullptr;
+}
+
+bool DwarfFile::ReadDie(uint64_t offset, Die& die) {
+	Unit* unit = FindUnit(offset);
+	if (!unit) return false;
+
+	DieReader reader(*this, *unit);
+	reader.Seek(offset);
+	return reader.Next(die) && die.tag != 0;
+}
+
+const std::vector<DwarfFile::Abbrev>* DwarfFile::GetAbbrevs(uint64_t offset) {
+	auto cached = abbrevTables.find(offset);
+	if (cached != abbrevTables.end()) return &cached->second;
+
+	// Most units of a file share a handful of tables, so each is parsed once
+	std::vector<Abbrev> table;
+	Cursor cursor(abbrev.data, abbrev.size);
+	cursor.Seek(offset);
+	while (cursor.Ok()) {
+		uint64_t code = cursor.ULEB();
+		if (code == 0) break;
+
+		constexpr uint64_t maxCode = 1 << 20; // Codes are numbered from 1 in practice, anything bigger is corrupt.
+		if (code > maxCode) {
+			spdlog::warn("Abbreviation table at 0x{:X} is corrupt", offset);
+			break;
+		}
+		if (code >= table.size()) table.resize(code + 1);
+
+		Abbrev& entry = table[code];
+		entry.tag = static_cast<uint16_t>(cursor.ULEB());
+		entry.hasChildren = cursor.U8() != 0;
+		while (cursor.Ok()) {
+			auto name = static_cast<uint16_t>(cursor.ULEB());
+			auto form = static_cast<uint16_t>(cursor.ULEB());
+			if (name == 0 && form == 0) break;
+			int64_t implicitConst = form == DW_FORM_implicit_const ? cursor.SLEB() : 0;
+			entry.attributes.push_back({ name, form, implicitConst });
+		}
+	}
+
+	return &abbrevTables.emplace(offset, std::move(table)).first->second;
+}
+
+void DwarfFile::IndexUnit(Unit& unit) {
+	DieReader reader(*this, unit);
+	reader.Seek(unit.dieOffset);
+
+	// Scopes that contain types, e.g. namespaces and classes, add to the qualified name of what is inside them
+	struct Scope {
+		size_t prefixLength;
+		bool indexed;
+	};
+	std::vector<Scope> scopes;
+	std::string prefix;
+
+	std::vector<std::pair<std::string, uint64_t>> typedefs;
+
+	Die die;
+	while (reader.Next(die)) {
+		if (die.tag == 0) {
+			if (scopes.empty()) break;
+			prefix.resize(scopes.back().prefixLength);
+			scopes.pop_back();
+			continue;
+		}
+
+		bool indexed = scopes.empty() || scopes.back().indexed;
+		bool record = IsRecord(die.tag);
+
+		std::string_view name = die.name;
+		if (indexed && record && die.declaration && !name.empty()) {
+			declarationNames.emplace(die.offset, prefix + std::string(name));
+		}
+		else if (indexed && record && die.byteSize) {
+			// Definitions can be outside the scope they belong to and point back at a declaration inside it instead
+			auto declaration = declarationNames.find(die.specification);
+			if (declaration != declarationNames.end()) index.try_emplace(declaration->second, die.offset);
+			else if (!name.empty()) index.try_emplace(prefix + std::string(name), die.offset);
+		}
+		else if (indexed && die.tag == DW_TAG_typedef && die.type && !die.name.empty()) {
+			typedefs.emplace_back(prefix + std::string(die.name), die.type);
+		}
+
+		if (!die.hasChildren) continue;
+
+		bool scope = die.tag == DW_TAG_namespace || record || die.tag == DW_TAG_compile_unit || die.tag == DW_TAG_partial_unit || die.tag == DW_TAG_type_unit;
+		if (!indexed || !scope) {
+			// Functions and the like never hold types worth importing
+			reader.SkipChildren(die);
+			continue;
+		}
+
+		scopes.push_back({ prefix.size(), true });
+		if (die.tag == DW_TAG_namespace || record) {
+			auto declaration = declarationNames.find(die.specification);
+			if (declaration != declarationNames.end()) prefix = declaration->second;
+			else prefix += name.empty() ? (die.tag == DW_TAG_namespace ? "(anonymous namespace)" : "(anonymous)") : name;
+			prefix += "::";
+		}
+	}
+
+	// Only anonymous records go by their typedef's name, the target can be in another unit (e.g. a type unit)
+	for (auto& [name, target] : typedefs) {
+		Die record;
+		if (!index.contains(name) && ReadDie(target, record) && IsRecord(record.tag) && record.name.empty() && record.byteSize && !record.declaration)
+			index.emplace(std::move(name), target);
+	}
+}
+
+std::optional<std::string_view> DwarfFile::DeclarationName(uint64_t offset) {
+	Unit* unit = FindUnit(offset);
+	if (!unit) return std::nullopt;
+
+	size_t unitIndex = unit - units.data();
+	while (nextUnit <= unitIndex) IndexUnit(units[nextUnit++]);
+
+	// Declarations inside functions are not indexed, they have no name to look the definition up by
+	auto it = declarationNames.find(offset);
+	if (it == declarationNames.end()) return std::nullopt;
+	return it->second;
+}
+
+bool DwarfFile::IndexUnits(std::chrono::microseconds budget) {
+	auto start = std::chrono::steady_clock::now();
+	while (nextUnit < units.size()) {
+		IndexUnit(units[nextUnit++]);
+		if (std::chrono::steady_clock::now() - start > budget) break;
+	}
+	return FullyIndexed();
+}
+
+std::optional<uint64_t> DwarfFile::FindType(std::string_view name) {
+	std::string key(name);
+	for (;;) {
+		auto it = index.find(key);
+		if (it != index.end()) return it->second;
+		if (nextUnit == units.size()) return std::nullopt;
+		IndexUnit(units[nextUnit++]);
+	}
+}
+
+std::vector<std::string_view> DwarfFile::Search(std::string_view needle, size_t maxResults) const {
+	auto equalIgnoreCase = [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); };
+
+	std::vector<std::string_view> results;
+	for (const auto& [name, offset] : index) {
+		if (std::search(name.begin(), name.end(), needle.begin(), needle.end(), equalIgnoreCase) != name.end()) results.push_back(name);
+	}
+
+	size_t shown = std::min(results.size(), maxResults);
+	std::partial_sort(results.begin(), results.begin() + shown, results.end());
+	results.resize(shown);
+	return results;
+}
+
+std::optional<size_t> DwarfFile::Import(StructureManager& sm, std::string_view name) {
+	auto offset = FindType(name);
+	if (!offset) {
+		spdlog::warn("No type named {} in the debug info", name);
+		return std::nullopt;
+	}
+
+	Die record;
+	if (!ReadDie(*offset, record)) {
+		spdlog::error("Failed to read the DIE of {} at 0x{:X}", name, *offset);
+		return std::nullopt;
+	}
+
+	Importer importer(*this, sm);
+	size_t before = sm.ClassCount();
+	size_t classIndex = importer.ImportRecord(record, std::string(name), false);
+	importer.Finish();
+
+	spdlog::info("Imported {} ({} classes)", name, sm.ClassCount() - before);
+	return classIndex;
+}
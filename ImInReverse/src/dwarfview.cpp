@@ -0,0 +1,102 @@
+#include "pch.h"
+#include "iir/views.h"
+#include "iir/dwarf.h"
+
+using namespace IIR;
+
+namespace {
+	std::shared_ptr<DwarfFile> g_dwarf;
+	char g_pathBuf[MAX_PATH];
+	char g_searchBuf[256];
+	bool g_indexing = false;
+
+	std::vector<std::string> g_results;
+	std::string g_selected;
+	size_t g_resultsIndexed = SIZE_MAX; // Units indexed when the results were made, they are redone as more are indexed.
+	std::chrono::steady_clock::time_point g_resultsTime;
+
+	void UpdateResults(bool force) {
+		// Searching every name is not free, while indexing only redo it a few times a second
+		auto now = std::chrono::steady_clock::now();
+		if (!force && (g_resultsIndexed == g_dwarf->IndexedUnitCount() || now - g_resultsTime < std::chrono::milliseconds(250))) return;
+
+		constexpr size_t maxResults = 500;
+		g_results.clear();
+		for (auto name : g_dwarf->Search(g_searchBuf, maxResults)) g_results.emplace_back(name);
+
+		g_resultsIndexed = g_dwarf->IndexedUnitCount();
+		g_resultsTime = now;
+	}
+}
+
+void IIR::DwarfImportView(StructureManager& sm, OptionsManager& om, bool* open) {
+	ImGui::SetNextWindowSize(ImVec2(520, 480), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin(ICON_LC_DOWNLOAD " Import types", open)) {
+		ImGui::End();
+		return;
+	}
+
+	ImGui::SetNextItemWidth(-ImGui::CalcTextSize("Open").x - ImGui::GetStyle().FramePadding.x * 2 - ImGui::GetStyle().ItemSpacing.x);
+	bool submitted = ImGui::InputTextWithHint("##path", "ELF file with DWARF debug info", g_pathBuf, sizeof(g_pathBuf), ImGuiInputTextFlags_EnterReturnsTrue);
+	ImGui::SameLine();
+	if (ImGui::Button("Open") || submitted) {
+		g_dwarf = DwarfFile::Open(g_pathBuf);
+		g_indexing = false;
+		g_results.clear();
+		g_selected.clear();
+		g_resultsIndexed = SIZE_MAX;
+	}
+
+	if (!g_dwarf) {
+		ImGui::TextDisabled("Open a file to search its types. Only the units a search needs are read.");
+		ImGui::End();
+		return;
+	}
+
+	if (g_indexing) g_indexing = !g_dwarf->IndexUnits(std::chrono::milliseconds(4));
+
+	ImGui::BeginDisabled(g_dwarf->FullyIndexed());
+	if (ImGui::Button(g_indexing ? ICON_LC_PAUSE " Pause" : ICON_LC_PLAY " Index all")) g_indexing = !g_indexing;
+	ImGui::EndDisabled();
+	ImGui::SameLine();
+	ImGui::TextColored(om.numberColour, "%zu / %zu units", g_dwarf->IndexedUnitCount(), g_dwarf->UnitCount());
+
+	ImGui::SetNextItemWidth(-FLT_MIN);
+	bool searchChanged = ImGui::InputTextWithHint("##search", "Search types", g_searchBuf, sizeof(g_searchBuf));
+	UpdateResults(searchChanged);
+
+	ImGui::BeginDisabled(g_selected.empty());
+	if (ImGui::Button(ICON_LC_CHECK " Import")) {
+		if (auto classIndex = g_dwarf->Import(sm, g_selected)) sm.SelectClass(*classIndex);
+	}
+	ImGui::EndDisabled();
+	ImGui::SetItemTooltip("Adds the type and every type embedded in it as new classes");
+
+	ImGui::SameLine();
+	ImGui::TextColored(om.typeColour, "%s", g_selected.c_str());
+
+	if (ImGui::BeginChild("##types", ImVec2(0, 0), true)) {
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(g_results.size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				const auto& name = g_results[i];
+				ImGui::PushID(i);
+				if (ImGui::Selectable(name.c_str(), name == g_selected, ImGuiSelectableFlags_AllowDoubleClick)) {
+					g_selected = name;
+					if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+						if (auto classIndex = g_dwarf->Import(sm, g_selected)) sm.SelectClass(*classIndex);
+					}
+				}
+				ImGui::PopID();
+			}
+		}
+		clipper.End();
+
+		if (g_results.empty())
+			ImGui::TextDisabled(g_dwarf->FullyIndexed() ? "No matching types" : "No matching types in the units indexed so far");
+	}
+	ImGui::EndChild();
+
+	ImGui::End();
+}
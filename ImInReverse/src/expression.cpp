@@ -0,0 +1,348 @@
+#include "pch.h"
+#include "iir/expression.h"
+
+#include <charconv>
+
+using namespace IIR;
+
+/// <summary>
+/// Recursive descent over the text. Every bracket is compiled into a scratch buffer of its own, which becomes a
+/// dereference program when the bracket closes; the enclosing buffer only gets a load of its result.
+/// </summary>
+class AddressExpression::Compiler {
+public:
+	Compiler(std::string_view input, AddressExpression& out) : input(input), out(out) {}
+
+	bool Compile(std::string& error) {
+		open.emplace_back();
+		bool ok = ParseExpression() && Expect('\0');
+		if (!ok) {
+			error = std::format("{} at column {}", this->error, pos + 1);
+			return false;
+		}
+
+		Finish();
+		if (!CheckStack()) {
+			error = "Expression is too deeply nested";
+			return false;
+		}
+		return true;
+	}
+
+private:
+	struct Buffer {
+		std::vector<Instruction> code;
+		uint32_t level = 0; // Deepest dereference loaded so far.
+	};
+
+	struct PendingDeref {
+		std::vector<Instruction> code;
+		uint32_t level;
+	};
+
+	std::string_view input;
+	size_t pos = 0;
+	AddressExpression& out;
+	std::string error;
+
+	std::vector<Buffer> open; // The innermost bracket being parsed is at the back.
+	std::vector<PendingDeref> derefs; // In the order their brackets closed.
+
+	void SkipSpaces() {
+		while (pos < input.size() && std::isspace(static_cast<unsigned char>(input[pos]))) pos++;
+	}
+
+	char Peek() {
+		SkipSpaces();
+		return pos < input.size() ? input[pos] : '\0';
+	}
+
+	bool Expect(char c) {
+		if (Peek() != c) {
+			error = c == '\0' ? std::format("Unexpected '{}'", input[pos]) : std::format("Expected '{}'", c);
+			return false;
+		}
+		if (c != '\0') pos++;
+		return true;
+	}
+
+	void Emit(Op op, uint32_t operand = 0) { open.back().code.push_back({ op, operand }); }
+
+	void EmitName(std::string_view name) {
+		auto it = std::find(out.names.begin(), out.names.end(), name);
+		if (it == out.names.end()) it = out.names.insert(out.names.end(), std::string(name));
+		Emit(Op::name, static_cast<uint32_t>(it - out.names.begin()));
+	}
+
+	// expression := ['+'] term { ('+' | '-') term }
+	// A leading '+' is relative to the executable, like "+1A0"
+	bool ParseExpression() {
+		if (Peek() == '+') EmitName("");
+		else if (!ParseTerm()) return false;
+
+		while (true) {
+			char c = Peek();
+			if (c != '+' && c != '-') return true;
+			pos++;
+			if (!ParseTerm()) return false;
+			Emit(c == '+' ? Op::add : Op::subtract);
+		}
+	}
+
+	// term := unary { '*' unary }
+	bool ParseTerm() {
+		if (!ParseUnary()) return false;
+		while (Peek() == '*') {
+			pos++;
+			if (!ParseUnary()) return false;
+			Emit(Op::multiply);
+		}
+		return true;
+	}
+
+	// unary := '-' unary | primary
+	bool ParseUnary() {
+		if (Peek() == '-') {
+			pos++;
+			if (!ParseUnary()) return false;
+			Emit(Op::negate);
+			return true;
+		}
+		return ParsePrimary();
+	}
+
+	// primary := number | name | '"' name '"' | '[' expression ']' | '(' expression ')'
+	bool ParsePrimary() {
+		char c = Peek();
+		if (c == '(') {
+			pos++;
+			return ParseExpression() && Expect(')');
+		}
+
+		if (c == '[') {
+			pos++;
+			open.emplace_back();
+			if (!ParseExpression() || !Expect(']')) return false;
+
+			Buffer inner = std::move(open.back());
+			open.pop_back();
+
+			uint32_t slot = AddDeref(std::move(inner.code), inner.level + 1);
+			open.back().level = std::max(open.back().level, inner.level + 1);
+			Emit(Op::load, slot);
+			return true;
+		}
+
+		if (c == '"') {
+			size_t end = input.find('"', pos + 1);
+			if (end == std::string_view::npos) {
+				error = "Unterminated name";
+				return false;
+			}
+			EmitName(input.substr(pos + 1, end - pos - 1));
+			pos = end + 1;
+			return true;
+		}
+
+		size_t start = pos;
+		while (pos < input.size() && (std::isalnum(static_cast<unsigned char>(input[pos])) || std::strchr("_.!?@$", input[pos]))) pos++;
+		std::string_view token = input.substr(start, pos - start);
+		if (token.empty()) {
+			error = c == '\0' ? "Unexpected end of expression" : std::format("Unexpected '{}'", c);
+			return false;
+		}
+
+		// Anything that reads as hex is a number, names that look like one have to be quoted
+		std::string_view digits = token;
+		if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) digits.remove_prefix(2);
+		uint64_t value = 0;
+		auto result = std::from_chars(digits.data(), digits.data() + digits.size(), value, 16);
+		if (result.ec == std::errc() && result.ptr == digits.data() + digits.size()) {
+			out.constants.push_back(value);
+			Emit(Op::constant, static_cast<uint32_t>(out.constants.size() - 1));
+		}
+		else if (result.ec == std::errc::result_out_of_range) {
+			pos = start;
+			error = "Number is too large";
+			return false;
+		}
+		else {
+			EmitName(token);
+		}
+		return true;
+	}
+
+	/// Returns the slot of the dereference of `code`, the same pointer written twice is only read once.
+	uint32_t AddDeref(std::vector<Instruction> code, uint32_t level) {
+		auto same = [&](const PendingDeref& deref) {
+			return deref.code.size() == code.size() && std::equal(code.begin(), code.end(), deref.code.begin(), [&](const Instruction& a, const Instruction& b) {
+				return a.op == b.op && (a.op == Op::constant ? out.constants[a.operand] == out.constants[b.operand] : a.operand == b.operand);
+			});
+		};
+		auto it = std::find_if(derefs.begin(), derefs.end(), same);
+		if (it != derefs.end()) return static_cast<uint32_t>(it - derefs.begin());
+
+		derefs.push_back({ std::move(code), level });
+		return static_cast<uint32_t>(derefs.size() - 1);
+	}
+
+	/// Lays the programs out by level and points every load at its dereference's new place.
+	void Finish() {
+		std::vector<uint32_t> order(derefs.size());
+		for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return derefs[a].level < derefs[b].level; });
+
+		std::vector<uint32_t> slotOf(derefs.size());
+		for (uint32_t i = 0; i < order.size(); i++) slotOf[order[i]] = i;
+
+		auto append = [&](const std::vector<Instruction>& code) {
+			Program program{ static_cast<uint32_t>(out.code.size()), 0 };
+			for (Instruction instruction : code) {
+				if (instruction.op == Op::load) instruction.operand = slotOf[instruction.operand];
+				out.code.push_back(instruction);
+			}
+			program.end = static_cast<uint32_t>(out.code.size());
+			return program;
+		};
+
+		for (uint32_t index : order) {
+			out.derefs.push_back({ append(derefs[index].code), derefs[index].level });
+			out.levels = std::max(out.levels, derefs[index].level);
+		}
+		out.result = append(open.back().code);
+	}
+
+	/// Each program starts with an empty stack, so each is checked on its own.
+	bool CheckStack() const {
+		auto fits = [&](Program program) {
+			int depth = 0;
+			for (uint32_t i = program.begin; i < program.end; i++) {
+				switch (out.code[i].op) {
+				case Op::constant:
+				case Op::name:
+				case Op::load:
+					depth++;
+					break;
+				case Op::add:
+				case Op::subtract:
+				case Op::multiply:
+					depth--;
+					break;
+				case Op::negate:
+					break;
+				}
+				if (depth > static_cast<int>(maxStack)) return false;
+			}
+			return true;
+		};
+
+		return std::all_of(out.derefs.begin(), out.derefs.end(), [&](const Deref& deref) { return fits(deref.address); }) && fits(out.result);
+	}
+};
+
+std::optional<AddressExpression> AddressExpression::Compile(std::string_view text, std::string& error) {
+	AddressExpression expression;
+	expression.text = text;
+
+	Compiler compiler(text, expression);
+	if (!compiler.Compile(error)) return std::nullopt;
+	return expression;
+}
+
+std::optional<uintptr_t> AddressExpression::Run(Program program, std::span<const std::optional<uintptr_t>> nameValues, std::span<const uintptr_t> slots) const {
+	uint64_t stack[maxStack];
+	size_t top = 0;
+
+	for (uint32_t i = program.begin; i < program.end; i++) {
+		const Instruction& instruction = code[i];
+		switch (instruction.op) {
+		case Op::constant:
+			stack[top++] = constants[instruction.operand];
+			break;
+		case Op::name:
+			if (!nameValues[instruction.operand]) return std::nullopt;
+			stack[top++] = *nameValues[instruction.operand];
+			break;
+		case Op::load:
+			stack[top++] = slots[instruction.operand];
+			break;
+		case Op::add:
+			top--;
+			stack[top - 1] += stack[top];
+			break;
+		case Op::subtract:
+			top--;
+			stack[top - 1] -= stack[top];
+			break;
+		case Op::multiply:
+			top--;
+			stack[top - 1] *= stack[top];
+			break;
+		case Op::negate:
+			stack[top - 1] = 0 - stack[top - 1];
+			break;
+		}
+	}
+
+	return static_cast<uintptr_t>(stack[0]);
+}
+
+void AddressExpression::Evaluate(std::span<const AddressExpression* const> expressions, const Resolver& resolve, const Reader& read,
+	std::span<std::optional<uintptr_t>> out) {
+	struct State {
+		std::vector<std::optional<uintptr_t>> names;
+		std::vector<uintptr_t> slots;
+		size_t next = 0; // First dereference not read yet.
+		bool failed = false;
+	};
+
+	std::vector<State> states(expressions.size());
+	uint32_t levels = 0;
+	for (size_t i = 0; i < expressions.size(); i++) {
+		const auto& expression = *expressions[i];
+		auto& state = states[i];
+
+		state.names.reserve(expression.names.size());
+		for (const auto& name : expression.names) {
+			state.names.push_back(resolve(name));
+			if (!state.names.back()) state.failed = true;
+		}
+		state.slots.resize(expression.derefs.size());
+		levels = std::max(levels, expression.levels);
+	}
+
+	// One batch per level, every read in it only depends on reads of the levels before
+	std::vector<ScatterRead> batch;
+	std::vector<std::pair<size_t, size_t>> owners; // Expression and slot of each read.
+	for (uint32_t level = 1; level <= levels; level++) {
+		batch.clear();
+		owners.clear();
+
+		for (size_t i = 0; i < expressions.size(); i++) {
+			const auto& expression = *expressions[i];
+			auto& state = states[i];
+			for (; !state.failed && state.next < expression.derefs.size() && expression.derefs[state.next].level == level; state.next++) {
+				auto address = expression.Run(expression.derefs[state.next].address, state.names, state.slots);
+				if (!address) {
+					state.failed = true;
+					break;
+				}
+				batch.push_back({ *address });
+				owners.emplace_back(i, state.next);
+			}
+		}
+
+		if (batch.empty()) break;
+		read(batch);
+
+		for (size_t k = 0; k < batch.size(); k++) {
+			auto& state = states[owners[k].first];
+			if (batch[k].valid) state.slots[owners[k].second] = batch[k].value;
+			else state.failed = true;
+		}
+	}
+
+	for (size_t i = 0; i < expressions.size(); i++) {
+		out[i] = states[i].failed ? std::nullopt : expressions[i]->Run(expressions[i]->result, states[i].names, states[i].slots);
+	}
+}
@@ -0,0 +1,310 @@
+#include "pch.h"
+#include "iir/views.h"
+#include "iir/pagecache.h"
+#include "iir/expression.h"
+#include "iir/modules.h"
+#include "iir/symbols.h"
+#include "iir/process.h"
+#include "iir/profiler.h"
+#include "iir/textformat.h"
+
+using namespace IIR;
+
+namespace {
+	constexpr uintptr_t bytesPerRow = 16;
+	// Classes made from a selection are capped at this, a drag across a whole region is not a structure
+	constexpr size_t maxClassSize = 0x10000;
+	// Shown when the address is in neither a region nor a module, e.g. before the first region walk
+	constexpr uintptr_t fallbackScope = 0x100000;
+
+	// Columns, in characters: the address, two spaces, 16 "XX " and a space before the ASCII
+	constexpr int hexColumn = 18;
+	constexpr int asciiColumn = hexColumn + static_cast<int>(bytesPerRow) * 3 + 1;
+
+	struct HexViewState {
+		char jumpBuf[256] = "";
+		std::optional<uintptr_t> target; // The address last jumped to, the scope is whatever contains it.
+
+		bool preferModule = true; // Scroll through the module containing the target rather than its allocation.
+		bool inModule = false;
+		uintptr_t scopeBegin = 0;
+		uintptr_t scopeEnd = 0;
+		std::string scopeName;
+
+		// Rows are counted in 64 bits and scrolled by hand, ImGui's float scroll positions run out of precision long
+		// before the end of a 4 GB region
+		ImS64 topRow = 0;
+		ImS64 lastTopRow = 0;
+		int direction = 0;
+
+		std::optional<uintptr_t> anchor; // Where the selection started, it runs to `cursor` inclusive.
+		uintptr_t cursor = 0;
+	};
+
+	HexViewState state;
+
+	/// Scrolls through the module containing `address`, or else the allocation it is part of.
+	void SetScope(uintptr_t address) {
+		auto modules = ModuleMap::GetInstance().Get();
+		auto regions = RegionMap::GetInstance().Get();
+
+		const Module* module = modules->Find(address);
+		state.inModule = module != nullptr;
+		if (module && state.preferModule) {
+			state.scopeBegin = module->base;
+			state.scopeEnd = module->base + module->size;
+			state.scopeName = module->name;
+			return;
+		}
+
+		const MemoryRegion* region = regions->Find(address);
+		if (!region) {
+			state.scopeBegin = address & ~(fallbackScope - 1);
+			state.scopeEnd = state.scopeBegin + fallbackScope;
+			state.scopeName = "Unmapped";
+			return;
+		}
+
+		// Regions are split wherever the protection changes, the whole allocation is what the user thinks of as one
+		size_t first = region - regions->regions.data(), last = first;
+		const auto& all = regions->regions;
+		while (first > 0 && all[first - 1].allocationBase == region->allocationBase && all[first - 1].base + all[first - 1].size == all[first].base) first--;
+		while (last + 1 < all.size() && all[last + 1].allocationBase == region->allocationBase && all[last].base + all[last].size == all[last + 1].base) last++;
+
+		state.scopeBegin = all[first].base;
+		state.scopeEnd = all[last].base + all[last].size;
+		state.scopeName = region->type == MEM_IMAGE ? "Image" : region->type == MEM_MAPPED ? "Mapped" : "Private";
+	}
+
+	void Jump(uintptr_t address, ImS64 visibleRows) {
+		state.target = address;
+		SetScope(address);
+
+		// Leave a few rows above the target so it is not stuck to the top edge
+		ImS64 row = static_cast<ImS64>((address - state.scopeBegin) / bytesPerRow);
+		state.topRow = std::max<ImS64>(row - visibleRows / 4, 0);
+		state.anchor = address;
+		state.cursor = address;
+	}
+
+	/// Evaluates the jump box once, dereferences are read straight away rather than followed like the memory pane does.
+	std::optional<uintptr_t> Evaluate(const char* text) {
+		std::string error;
+		auto compiled = AddressExpression::Compile(text, error);
+		if (!compiled) {
+			spdlog::error("Invalid address \"{}\": {}", text, error);
+			return std::nullopt;
+		}
+
+		auto modules = ModuleMap::GetInstance().Get();
+		auto symbols = SymbolIndex::GetInstance().Get();
+		HANDLE handle = ProcessManager::GetInstance().GetHandle();
+		auto address = compiled->Evaluate([&](std::string_view name) { return ResolveName(*modules, *symbols, name); },
+			[&](std::span<ScatterRead> reads) {
+				for (auto& read : reads) {
+					SIZE_T sizeRead = 0;
+					read.valid = ReadProcessMemory(handle, reinterpret_cast<LPCVOID>(read.address), &read.value, sizeof(read.value), &sizeRead) && sizeRead == sizeof(read.value);
+				}
+			});
+
+		if (!address) spdlog::warn("Could not evaluate \"{}\", a name is unknown or a pointer unreadable", text);
+		return address;
+	}
+
+	/// Makes a class the size of the selection out of 8-byte unknowns and shows it at the start of the selection.
+	void ClassFromSelection(StructureManager& sm, uintptr_t begin, size_t size) {
+		std::vector<Field> fields;
+		for (size_t offset = 0; offset < size; offset += 8)
+			fields.push_back(Field{ FieldType::unk, offset, static_cast<int>(std::min<size_t>(8, size - offset)) });
+
+		size_t classIndex = sm.AddClass(std::format("class{}", sm.ClassCount()), FieldList().Insert(0, fields));
+		sm.SelectClass(classIndex);
+
+		// The memory pane goes to a class' address when it is selected
+		char address[32];
+		TextWriter(address, sizeof(address)).Hex(begin).Length();
+		sm.SetAddress(address);
+		sm.SetBase(begin);
+	}
+
+	void Toolbar(StructureManager& sm, ImS64 visibleRows) {
+		ImGui::SetNextItemWidth(280.0f);
+		if (ImGui::InputTextWithHint("##jump", "Address, e.g. ntdll.dll+1000 or [game.exe+10]", state.jumpBuf, sizeof(state.jumpBuf), ImGuiInputTextFlags_EnterReturnsTrue)) {
+			if (auto address = Evaluate(state.jumpBuf)) Jump(*address, visibleRows);
+		}
+
+		ImGui::SameLine();
+		if (ImGui::Button(ICON_LC_CROSSHAIR " Structure")) Jump(sm.GetBase(), visibleRows);
+		ImGui::SetItemTooltip("Jumps to the address the memory pane is showing");
+
+		if (state.inModule) {
+			ImGui::SameLine();
+			if (ImGui::Checkbox("Whole module", &state.preferModule) && state.target) SetScope(*state.target);
+			ImGui::SetItemTooltip("Scrolls through every section of the module instead of only the allocation the address is in");
+		}
+
+		ImGui::SameLine();
+		char range[96];
+		TextWriter(range, sizeof(range)).Put(state.scopeName).Put("  ").Hex(state.scopeBegin).Put(" - ").Hex(state.scopeEnd).Length();
+		ImGui::AlignTextToFramePadding();
+		ImGui::TextDisabled("%s (%.1f MB)", range, (state.scopeEnd - state.scopeBegin) / (1024.0 * 1024.0));
+
+		if (!state.anchor) return;
+
+		uintptr_t begin = std::min(*state.anchor, state.cursor);
+		size_t size = std::max(*state.anchor, state.cursor) - begin + 1;
+		char selection[64];
+		TextWriter(selection, sizeof(selection)).Put("Selected ").Hex(begin).Put(", ").Int(size).Put(size == 1 ? " byte" : " bytes").Length();
+		ImGui::AlignTextToFramePadding();
+		ImGui::TextUnformatted(selection);
+
+		ImGui::SameLine();
+		ImGui::BeginDisabled(size > maxClassSize);
+		if (ImGui::Button(ICON_LC_PLUS " Class from selection")) ClassFromSelection(sm, begin, size);
+		ImGui::EndDisabled();
+		ImGui::SetItemTooltip("Creates a class the size of the selection and shows it at its start in the memory pane");
+	}
+
+	void Rows(OptionsManager& om) {
+		auto& cache = PageCache::GetInstance();
+		const ImGuiStyle& style = ImGui::GetStyle();
+
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		ImVec2 avail = ImGui::GetContentRegionAvail();
+		float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+		float charWidth = ImGui::CalcTextSize("F").x;
+
+		ImS64 totalRows = static_cast<ImS64>((state.scopeEnd - state.scopeBegin + bytesPerRow - 1) / bytesPerRow);
+		ImS64 visibleRows = std::max<ImS64>(static_cast<ImS64>(avail.y / lineHeight), 1);
+		float rowsWidth = std::max(avail.x - style.ScrollbarSize, 1.0f);
+
+		// The rows are one item, so dragging a selection does not move the window
+		ImGui::InvisibleButton("##rows", ImVec2(rowsWidth, std::max(avail.y, 1.0f)));
+		bool hovered = ImGui::IsItemHovered();
+		bool active = ImGui::IsItemActive();
+		bool clicked = ImGui::IsItemClicked(ImGuiMouseButton_Left);
+
+		if (hovered) state.topRow -= static_cast<ImS64>(ImGui::GetIO().MouseWheel * 3.0f);
+		if (ImGui::IsWindowFocused()) {
+			if (ImGui::IsKeyPressed(ImGuiKey_PageDown)) state.topRow += visibleRows;
+			if (ImGui::IsKeyPressed(ImGuiKey_PageUp)) state.topRow -= visibleRows;
+			if (ImGui::IsKeyPressed(ImGuiKey_DownArrow)) state.topRow++;
+			if (ImGui::IsKeyPressed(ImGuiKey_UpArrow)) state.topRow--;
+			if (ImGui::IsKeyPressed(ImGuiKey_Home)) state.topRow = 0;
+			if (ImGui::IsKeyPressed(ImGuiKey_End)) state.topRow = totalRows;
+		}
+
+		// Keep the selection moving when it is dragged past an edge
+		ImVec2 mouse = ImGui::GetMousePos();
+		if (active && mouse.y < origin.y) state.topRow--;
+		if (active && mouse.y > origin.y + avail.y) state.topRow++;
+
+		ImRect bar(ImVec2(origin.x + rowsWidth, origin.y), ImVec2(origin.x + avail.x, origin.y + avail.y));
+		ImGui::ScrollbarEx(bar, ImGui::GetID("##scroll"), ImGuiAxis_Y, &state.topRow, visibleRows, totalRows, ImDrawFlags_RoundCornersAll);
+		state.topRow = std::clamp<ImS64>(state.topRow, 0, std::max<ImS64>(totalRows - visibleRows, 0));
+
+		if (state.topRow != state.lastTopRow) state.direction = state.topRow > state.lastTopRow ? 1 : -1;
+		state.lastTopRow = state.topRow;
+
+		if (totalRows == 0) return;
+
+		uintptr_t firstAddress = state.scopeBegin + static_cast<uintptr_t>(state.topRow) * bytesPerRow;
+		ImS64 shownRows = std::min(visibleRows, totalRows - state.topRow);
+		uintptr_t endAddress = std::min<uintptr_t>(firstAddress + static_cast<uintptr_t>(shownRows) * bytesPerRow, state.scopeEnd);
+		cache.Want(&state, { PageCache::PageOf(firstAddress), PageCache::PageOf(endAddress - 1), state.direction, state.scopeBegin, state.scopeEnd });
+
+		// Hex or ASCII column under the mouse, both select the same byte
+		auto byteAt = [&](ImVec2 pos) {
+			ImS64 row = state.topRow + static_cast<ImS64>(std::floor((pos.y - origin.y) / lineHeight));
+			row = std::clamp<ImS64>(row, 0, totalRows - 1);
+			float x = (pos.x - origin.x) / charWidth;
+			float column = x < asciiColumn ? (x - hexColumn) / 3.0f : x - asciiColumn;
+			uintptr_t offset = static_cast<uintptr_t>(std::clamp(static_cast<int>(column), 0, static_cast<int>(bytesPerRow) - 1));
+			return std::min(state.scopeBegin + static_cast<uintptr_t>(row) * bytesPerRow + offset, state.scopeEnd - 1);
+		};
+
+		if (clicked) {
+			uintptr_t byte = byteAt(mouse);
+			if (!ImGui::GetIO().KeyShift || !state.anchor) state.anchor = byte;
+			state.cursor = byte;
+		}
+		else if (active && state.anchor) {
+			state.cursor = byteAt(mouse);
+		}
+
+		uintptr_t selectionBegin = state.anchor ? std::min(*state.anchor, state.cursor) : 0;
+		uintptr_t selectionEnd = state.anchor ? std::max(*state.anchor, state.cursor) + 1 : 0;
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		drawList->PushClipRect(origin, ImVec2(origin.x + rowsWidth, origin.y + avail.y), true);
+		ImU32 addressColour = ImGui::GetColorU32(om.addressColour);
+		ImU32 textColour = ImGui::GetColorU32(om.textColour);
+		ImU32 disabledColour = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+		ImU32 selectionColour = ImGui::GetColorU32(ImGuiCol_TextSelectedBg);
+
+		std::shared_ptr<const MemoryPage> page;
+		for (ImS64 i = 0; i < shownRows; i++) {
+			uintptr_t rowAddress = firstAddress + static_cast<uintptr_t>(i) * bytesPerRow;
+			size_t count = static_cast<size_t>(std::min<uintptr_t>(bytesPerRow, state.scopeEnd - rowAddress));
+			float y = origin.y + i * lineHeight;
+
+			// A page covers 256 rows, it is only looked up again when the rows cross into the next one
+			if (!page || page->address != PageCache::PageOf(rowAddress)) page = cache.Get(PageCache::PageOf(rowAddress));
+
+			uintptr_t highlightBegin = std::max(selectionBegin, rowAddress), highlightEnd = std::min(selectionEnd, rowAddress + count);
+			if (highlightBegin < highlightEnd) {
+				float first = static_cast<float>(highlightBegin - rowAddress), last = static_cast<float>(highlightEnd - rowAddress);
+				drawList->AddRectFilled(ImVec2(origin.x + (hexColumn + first * 3) * charWidth, y),
+					ImVec2(origin.x + (hexColumn + last * 3 - 1) * charWidth, y + lineHeight), selectionColour);
+				drawList->AddRectFilled(ImVec2(origin.x + (asciiColumn + first) * charWidth, y),
+					ImVec2(origin.x + (asciiColumn + last) * charWidth, y + lineHeight), selectionColour);
+			}
+
+			char address[20];
+			auto addressText = TextWriter(address, sizeof(address)).Hex(rowAddress, 16).View();
+			bool readable = page && page->IsReadable();
+			drawList->AddText(ImVec2(origin.x, y), readable ? addressColour : disabledColour, addressText.data(), addressText.data() + addressText.size());
+
+			// Unreadable pages are left as gaps, labelled on their first row and wherever they scroll into view
+			if (!readable) {
+				if (page && (rowAddress == page->address || i == 0))
+					drawList->AddText(ImVec2(origin.x + hexColumn * charWidth, y), disabledColour, "unreadable page");
+				continue;
+			}
+
+			const uint8_t* bytes = page->data.data() + (rowAddress - page->address);
+			char hex[bytesPerRow * 3 + 1];
+			size_t hexLength = FormatHexBytes(bytes, count, hex);
+			drawList->AddText(ImVec2(origin.x + hexColumn * charWidth, y), textColour, hex, hex + hexLength);
+
+			char ascii[bytesPerRow];
+			size_t asciiLength = FormatAsciiBytes(bytes, count, ascii);
+			drawList->AddText(ImVec2(origin.x + asciiColumn * charWidth, y), textColour, ascii, ascii + asciiLength);
+		}
+
+		drawList->PopClipRect();
+	}
+}
+
+void IIR::HexView(StructureManager& sm, OptionsManager& om, bool* open) {
+	static auto& viewTimer = Profiler::GetInstance().GetTimer("Hex view");
+	ScopedTimer timer(viewTimer);
+
+	ImGui::SetNextWindowSize(ImVec2(820, 600), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin(ICON_LC_BINARY " Hex view", open)) {
+		ImGui::End();
+		return;
+	}
+
+	// A rough row count for placing jumps, the exact one is only known inside the child
+	ImS64 visibleRows = static_cast<ImS64>(ImGui::GetContentRegionAvail().y / ImGui::GetTextLineHeightWithSpacing());
+	if (!state.target) Jump(sm.GetBase(), visibleRows);
+
+	Toolbar(sm, visibleRows);
+
+	if (ImGui::BeginChild("##hex", ImVec2(0, 0), false, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse))
+		Rows(om);
+	ImGui::EndChild();
+
+	ImGui::End();
+}
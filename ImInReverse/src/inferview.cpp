@@ -0,0 +1,101 @@
+#include "pch.h"
+#include "iir/views.h"
+#include "iir/analyzer.h"
+
+using namespace IIR;
+
+namespace {
+	const char* SlotKindName(SlotKind kind) {
+		switch (kind) {
+		case SlotKind::padding: return "padding";
+		case SlotKind::vtable: return "vtable";
+		case SlotKind::pointer: return "pointer";
+		case SlotKind::f64: return "f64";
+		case SlotKind::text: return "text";
+		case SlotKind::halves: return "split";
+		default: return "?";
+		}
+	}
+
+	const char* HalfKindName(HalfKind kind) {
+		switch (kind) {
+		case HalfKind::zero: return "zero";
+		case HalfKind::boolean: return "bool";
+		case HalfKind::i32: return "i32";
+		case HalfKind::f32: return "f32";
+		default: return "?";
+		}
+	}
+}
+
+void IIR::InferenceView(StructureManager& sm, OptionsManager& om, bool* open) {
+	ImGui::SetNextWindowSize(ImVec2(420, 480), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin(ICON_LC_WAND_SPARKLES " Infer types", open)) {
+		ImGui::End();
+		return;
+	}
+
+	auto& analyzer = FieldAnalyzer::GetInstance();
+	analyzer.SetTarget(sm.GetBase(), sm.GetCurrentClass(), sm.GetFields());
+
+	auto proposal = analyzer.GetProposal();
+	bool current = proposal && proposal->classIndex == sm.GetCurrentClass() && proposal->basis.SameVersion(sm.GetFields());
+
+	ImGui::BeginDisabled(!current || proposal->changedSlots == 0);
+	if (ImGui::Button(std::format(ICON_LC_CHECK " Accept ({} slots)###accept", current ? proposal->changedSlots : 0).c_str())) {
+		sm.ApplyLayout(proposal->classIndex, proposal->basis, proposal->fields);
+	}
+	ImGui::EndDisabled();
+	ImGui::SetItemTooltip("Retypes every untyped slot the analyzer has a guess for, in one undo step");
+
+	ImGui::SameLine();
+	if (ImGui::Button(ICON_LC_ROTATE_CCW " Reset")) {
+		analyzer.Reset();
+	}
+
+	ImGui::SameLine();
+	ImGui::TextColored(om.numberColour, "%zu samples", proposal ? proposal->samples : 0);
+
+	if (!proposal) {
+		ImGui::TextDisabled("Waiting for samples...");
+		ImGui::End();
+		return;
+	}
+
+	constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp;
+	if (ImGui::BeginTable("##slots", 3, tableFlags)) {
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Offset");
+		ImGui::TableSetupColumn("Guess");
+		ImGui::TableSetupColumn("Changes");
+		ImGui::TableHeadersRow();
+
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(proposal->slots.size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				const auto& slot = proposal->slots[i];
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextColored(om.offsetColour, "%04zX", slot.offset);
+
+				ImGui::TableNextColumn();
+				if (slot.kind == SlotKind::halves)
+					ImGui::TextColored(om.typeColour, "%s / %s", HalfKindName(slot.halves[0]), HalfKindName(slot.halves[1]));
+				else if (slot.kind == SlotKind::unknown)
+					ImGui::TextDisabled("?");
+				else
+					ImGui::TextColored(om.typeColour, "%s", SlotKindName(slot.kind));
+
+				ImGui::TableNextColumn();
+				if (slot.changes) ImGui::TextColored(om.numberColour, ICON_LC_ACTIVITY);
+			}
+		}
+		clipper.End();
+
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,111 @@
+#include "pch.h"
+#include "iir/views.h"
+#include "iir/instance.h"
+#include "iir/textformat.h"
+
+using namespace IIR;
+
+namespace {
+	char g_addBuf[32];
+	size_t g_selected = SIZE_MAX;
+}
+
+void IIR::ShowInstance(StructureManager& sm, const Instance& instance) {
+	sm.SelectClass(instance.classIndex);
+
+	char address[32];
+	TextWriter(address, sizeof(address)).Hex(instance.base).Length();
+	sm.SetAddress(address);
+	sm.SetBase(instance.base);
+}
+
+void IIR::InstancesView(StructureManager& sm, OptionsManager& om, bool* open) {
+	ImGui::SetNextWindowSize(ImVec2(460, 520), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin(ICON_LC_LAYERS " Instances", open)) {
+		ImGui::End();
+		return;
+	}
+
+	if (ImGui::Button(ICON_LC_PLUS " Current")) g_selected = sm.AddInstance(sm.GetCurrentClass(), sm.GetBase());
+	ImGui::SetItemTooltip("Watches the address the memory pane is showing as the current class");
+
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(-FLT_MIN);
+	if (ImGui::InputTextWithHint("##add", "Address", g_addBuf, sizeof(g_addBuf), ImGuiInputTextFlags_CharsHexadecimal | ImGuiInputTextFlags_EnterReturnsTrue)) {
+		if (uintptr_t base = static_cast<uintptr_t>(std::strtoull(g_addBuf, nullptr, 16))) g_selected = sm.AddInstance(sm.GetCurrentClass(), base);
+		g_addBuf[0] = '\0';
+	}
+
+	// Every watched instance is polled, however many there are, they all read through their class's layout
+	auto& reader = MemoryReader::GetInstance();
+	const auto& instances = sm.GetInstances();
+	RequestInstances(reader, sm, instances);
+
+	if (instances.empty()) {
+		ImGui::TextDisabled("No instances are being watched");
+		ImGui::End();
+		return;
+	}
+
+	std::optional<size_t> remove;
+	if (ImGui::BeginChild("##instances", ImVec2(0, ImGui::GetContentRegionAvail().y * 0.4f), true)) {
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(instances.size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				const auto& instance = instances[i];
+				ImGui::PushID(i);
+
+				if (ImGui::SmallButton(ICON_LC_X)) remove = i;
+				ImGui::SameLine();
+				if (ImGui::SmallButton(ICON_LC_EYE)) ShowInstance(sm, instance);
+				ImGui::SetItemTooltip("Show in the memory pane");
+				ImGui::SameLine();
+
+				auto label = std::format("{} @ {:X}", sm.ClassName(instance.classIndex), instance.base);
+				if (ImGui::Selectable(label.c_str(), g_selected == static_cast<size_t>(i))) g_selected = i;
+
+				ImGui::PopID();
+			}
+		}
+		clipper.End();
+	}
+	ImGui::EndChild();
+
+	if (g_selected < instances.size()) {
+		auto view = BindInstance(sm, reader, instances[g_selected]);
+
+		if (ImGui::BeginChild("##fields", ImVec2(0, 0), true)) {
+			ImGuiListClipper clipper;
+			clipper.Begin(static_cast<int>(view.layout.Size()));
+			while (clipper.Step()) {
+				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+					const auto& field = view.layout[i];
+
+					ImGui::TextColored(om.offsetColour, "%04zX", field.offset);
+					ImGui::SameLine();
+					ImGui::TextColored(om.typeColour, "%s", GetFieldTypeInfo(field.fieldType).name);
+					if (!field.name.empty()) {
+						ImGui::SameLine();
+						ImGui::TextColored(om.nameColour, "%s", field.name.c_str());
+					}
+					ImGui::SameLine();
+
+					char text[256] = "??";
+					if (auto data = view.Read(field)) GetFieldTypeInfo(field.fieldType).format(data, field.size, text, sizeof(text));
+					ImGui::TextColored(om.textColour, "%s", text);
+				}
+			}
+			clipper.End();
+		}
+		ImGui::EndChild();
+	}
+
+	if (remove) {
+		sm.RemoveInstance(*remove);
+		if (g_selected == *remove) g_selected = SIZE_MAX;
+		else if (g_selected != SIZE_MAX && g_selected > *remove) g_selected--;
+	}
+
+	ImGui::End();
+}
@@ -2,49 +2,117 @@
 
 #include "windowbuilder.h"
 #include "windowbuilder_imgui.h"
+#include "windowbuilder_headless.h"
 
 #include "widgets.h"
 
 #include "iir/process.h"
+#include "iir/processindex.h"
+#include "iir/procinfo.h"
 #include "iir/structure.h"
+#include "iir/reader.h"
+#include "iir/regions.h"
+#include "iir/pagecache.h"
+#include "iir/regionstats.h"
+#include "iir/symbols.h"
+#include "iir/analyzer.h"
+#include "iir/project.h"
+#include "iir/rendercache.h"
+#include "iir/textformat.h"
+#include "iir/profiler.h"
+#include "iir/views.h"
 #include "iir/options.h"
 
+#include <bit>
+
+#pragma comment(lib, "comdlg32.lib")
+
 // Window filling entire screen, shouldn't ever go to top, etc
 constexpr auto windowFlags = ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove |
 ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoBringToFrontOnFocus | ImGuiWindowFlags_NoSavedSettings |
 ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoDocking;
 
-static const IIR::Field* g_selectedField = nullptr;
-
-bool IsProbablyPointer(HANDLE process, uintptr_t value) {
-	if (value < 0x10000 || value % sizeof(uintptr_t) != 0)
-		return false;
-
-	MEMORY_BASIC_INFORMATION mbi;
-	if (VirtualQueryEx(process, (LPCVOID)value, &mbi, sizeof(mbi)) == 0)
-		return false;
-
-	// Check if memory is committed and readable
-	DWORD protect = mbi.Protect;
-	bool isReadable =
-		(protect & PAGE_READONLY) ||
-		(protect & PAGE_READWRITE) ||
-		(protect & PAGE_EXECUTE_READ) ||
-		(protect & PAGE_EXECUTE_READWRITE);
+static std::optional<size_t> g_selectedOffset = std::nullopt;
+static bool g_showArrayView = false;
+static bool g_showInference = false;
+static bool g_showDwarfImport = false;
+static bool g_showCompare = false;
+static bool g_showInstances = false;
+static bool g_showProfiler = false;
+static bool g_showHexView = false;
+static bool g_showMemoryMap = false;
+
+static std::filesystem::path g_projectPath;
+static bool g_classesReplaced = false; // Set when a project is opened, the memory pane resets its state.
+
+/// <summary>
+/// Shows the system open/save dialog.
+/// </summary>
+/// <returns>The chosen path, or nothing if the dialog was cancelled.</returns>
+std::optional<std::filesystem::path> FileDialog(HWND owner, bool save, const char* filter, const char* defaultExtension) {
+	char path[MAX_PATH] = "";
+
+	OPENFILENAMEA ofn = {};
+	ofn.lStructSize = sizeof(ofn);
+	ofn.hwndOwner = owner;
+	ofn.lpstrFilter = filter;
+	ofn.lpstrFile = path;
+	ofn.nMaxFile = sizeof(path);
+	ofn.lpstrDefExt = defaultExtension;
+	ofn.Flags = OFN_NOCHANGEDIR | (save ? OFN_OVERWRITEPROMPT : OFN_FILEMUSTEXIST);
+
+	if (!(save ? GetSaveFileNameA(&ofn) : GetOpenFileNameA(&ofn))) return std::nullopt;
+	return std::filesystem::path(path);
+}
 
-	if (mbi.State != MEM_COMMIT || !isReadable)
-		return false;
+void SaveProjectAs(const Window& window, IIR::StructureManager& sm) {
+	if (auto path = FileDialog(window.hWnd, true, "ImInReverse project (*.iir)\0*.iir\0", "iir")) {
+		if (IIR::SaveProject(sm, *path)) g_projectPath = *path;
+	}
+}
 
-	return true;
+void SaveProject(const Window& window, IIR::StructureManager& sm) {
+	if (g_projectPath.empty()) SaveProjectAs(window, sm);
+	else IIR::SaveProject(sm, g_projectPath);
 }
 
-void MenuBar(const Window& window, IIR::ProcessManager& pm) {
+void MenuBar(const Window& window, IIR::ProcessManager& pm, IIR::StructureManager& sm) {
 	bool openAbout = false;
 	bool openProcPicker = false;
 	bool openSettings = false;
 
 	if (ImGui::BeginMainMenuBar()) {
 		if (ImGui::BeginMenu("File")) {
+			if (ImGui::MenuItem("New project")) {
+				sm.LoadClasses({}, 0, 0);
+				g_projectPath.clear();
+				g_classesReplaced = true;
+			}
+
+			if (ImGui::MenuItem("Open project...")) {
+				if (auto path = FileDialog(window.hWnd, false, "ImInReverse project (*.iir)\0*.iir\0All files\0*.*\0", "iir")) {
+					if (IIR::LoadProject(sm, *path)) {
+						g_projectPath = *path;
+						g_classesReplaced = true;
+					}
+				}
+			}
+
+			if (ImGui::MenuItem("Save project", "Ctrl+S")) {
+				SaveProject(window, sm);
+			}
+
+			if (ImGui::MenuItem("Save project as...")) {
+				SaveProjectAs(window, sm);
+			}
+
+			if (ImGui::MenuItem("Export JSON...")) {
+				if (auto path = FileDialog(window.hWnd, true, "JSON (*.json)\0*.json\0", "json")) {
+					IIR::ExportProjectJson(sm, *path);
+				}
+			}
+
+			ImGui::Separator();
 			if (ImGui::MenuItem("Options")) {
 				openSettings = true;
 			}
@@ -56,6 +124,39 @@ void MenuBar(const Window& window, IIR::ProcessManager& pm) {
 			ImGui::EndMenu();
 		}
 
+		if (ImGui::BeginMenu("Class")) {
+			if (ImGui::MenuItem("New class")) {
+				sm.SelectClass(sm.AddClass(std::format("class{}", sm.ClassCount())));
+			}
+
+			ImGui::Separator();
+			ImGuiListClipper clipper;
+			clipper.Begin(static_cast<int>(sm.ClassCount()));
+			while (clipper.Step()) {
+				for (size_t c = clipper.DisplayStart; c < static_cast<size_t>(clipper.DisplayEnd); c++) {
+					ImGui::PushID(static_cast<int>(c));
+					if (ImGui::MenuItem(sm.ClassName(c).c_str(), nullptr, c == sm.GetCurrentClass())) {
+						sm.SelectClass(c);
+					}
+					ImGui::PopID();
+				}
+			}
+
+			ImGui::EndMenu();
+		}
+
+		if (ImGui::BeginMenu("Edit")) {
+			if (ImGui::MenuItem("Undo", "Ctrl+Z", false, sm.CanUndo())) {
+				sm.Undo();
+			}
+
+			if (ImGui::MenuItem("Redo", "Ctrl+Y", false, sm.CanRedo())) {
+				sm.Redo();
+			}
+
+			ImGui::EndMenu();
+		}
+
 		const auto& selectedProcess = pm.GetSelectedProcess();
 		if (ImGui::BeginMenu("Process")) {
 			// Open process picker
@@ -68,7 +169,9 @@ void MenuBar(const Window& window, IIR::ProcessManager& pm) {
 				pm.CloseProcess();
 			}
 
-			static bool processSuspended = pm.IsProcessSuspended();
+			// Querying only looks at the threads, cheap enough to redo whenever the menu opens
+			static bool processSuspended = false;
+			if (ImGui::IsWindowAppearing()) processSuspended = selectedProcess.has_value() && pm.IsProcessSuspended();
 			if (ImGui::MenuItem(processSuspended ? "Resume Process" : "Suspend Process")) {
 				processSuspended ? pm.ResumeProcess() : pm.SuspendProcess();
 				processSuspended = !processSuspended;
@@ -79,7 +182,13 @@ void MenuBar(const Window& window, IIR::ProcessManager& pm) {
 		}
 
 		if (ImGui::BeginMenu("Memory")) {
-			ImGui::Text("TODO");
+			ImGui::MenuItem(ICON_LC_TABLE " Array view", nullptr, &g_showArrayView);
+			ImGui::MenuItem(ICON_LC_WAND_SPARKLES " Infer types", nullptr, &g_showInference);
+			ImGui::MenuItem(ICON_LC_DOWNLOAD " Import types", nullptr, &g_showDwarfImport);
+			ImGui::MenuItem(ICON_LC_GIT_COMPARE " Compare instances", nullptr, &g_showCompare);
+			ImGui::MenuItem(ICON_LC_LAYERS " Instances", nullptr, &g_showInstances);
+			ImGui::MenuItem(ICON_LC_BINARY " Hex view", nullptr, &g_showHexView);
+			ImGui::MenuItem(ICON_LC_MAP " Memory map", nullptr, &g_showMemoryMap);
 
 			ImGui::EndMenu();
 		}
@@ -91,9 +200,13 @@ void MenuBar(const Window& window, IIR::ProcessManager& pm) {
 			ImGui::EndMenu();
 		}
 
-		const auto fpsText = std::format("FPS: {:.2f}", ImGui::GetIO().Framerate);
-		ImGui::SetCursorPosX(window.width - ImGui::CalcTextSize(fpsText.c_str()).x - 10.0f);
-		ImGui::Text("%s", fpsText.c_str());
+		// CPU time of the last frame drawn, frames are only drawn when something changed so a rate would mean little
+		const auto& last = window.lastFrame;
+		char frameText[64];
+		IIR::TextWriter(frameText, sizeof(frameText)).Put(ICON_LC_GAUGE " ").Float(last.preRender + last.render + last.postRender, 3).Put(" ms").Length();
+		ImGui::SetCursorPosX(window.width - ImGui::CalcTextSize(frameText).x - ImGui::GetStyle().ItemSpacing.x * 2 - 10.0f);
+		ImGui::MenuItem(frameText, nullptr, &g_showProfiler);
+		ImGui::SetItemTooltip("Time spent on the last frame, without presenting it. Click for the profiler");
 
 		ImGui::EndMainMenuBar();
 	}
@@ -134,19 +247,73 @@ void MenuBar(const Window& window, IIR::ProcessManager& pm) {
 		ImRect windowRect = ImGui::GetCurrentWindow()->Rect();
 
 		static char search[128] = "";
-		ImGui::InputText("Search", search, sizeof(search));
+		if (ImGui::IsWindowAppearing()) ImGui::SetKeyboardFocusHere();
+		bool pickFirst = ImGui::InputTextWithHint("Search", "Name, PID or command line", search, sizeof(search), ImGuiInputTextFlags_EnterReturnsTrue);
 		ImGui::Separator();
-		const auto& processes = pm.GetProcesses();
-		for (const auto& process : processes) {
-			ImGui::PushID(&process);
-			if (process.name.find(search) != std::string::npos) {
-				if (ImGui::Selectable(process.name.c_str(), false)) {
-					pm.OpenProcess(process);
-					SetWindowTextA(window.hWnd, std::format("ImInReverse - {} : ({})", process.name, process.pid).c_str());
-					ImGui::CloseCurrentPopup();
+
+		// Only re-indexes the processes that changed since the last version it saw
+		static IIR::ProcessIndex index;
+		index.Update(*pm.GetProcesses());
+		auto matches = index.Search(search);
+
+		std::optional<IIR::Process> picked;
+		if (pickFirst && !matches.empty()) picked = index.Get(matches.front().entry);
+
+		// Details are collected in the background, only for the rows on screen
+		auto& collector = IIR::ProcessInfoCollector::GetInstance();
+		auto infos = collector.Snapshot();
+
+		if (ImGui::BeginChild("##processes", ImVec2(640, 360), false)) {
+			ImGuiListClipper clipper;
+			clipper.Begin(static_cast<int>(matches.size()));
+			while (clipper.Step()) {
+				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+					const auto& process = index.Get(matches[i].entry);
+					collector.Want(process.pid);
+
+					auto it = infos->find(process.pid);
+					const IIR::ProcessInfo* info = it != infos->end() && it->second.valid ? &it->second : nullptr;
+					const std::string& commandLine = process.commandLine.empty() && info ? info->commandLine : process.commandLine;
+
+					ImGui::PushID(static_cast<int>(process.pid));
+					if (ImGui::Selectable(process.name.c_str(), false)) picked = process;
+					if (info && ImGui::BeginItemTooltip()) {
+						ImGui::Text("%s (%u)", process.name.c_str(), process.pid);
+						if (!info->user.empty()) ImGui::Text("User: %s", info->user.c_str());
+						if (info->started.time_since_epoch().count())
+							ImGui::Text("Started: %s", std::format("{:%Y-%m-%d %H:%M:%S} UTC", std::chrono::floor<std::chrono::seconds>(info->started)).c_str());
+						ImGui::Text("Memory: %.1f MB, %u threads, %s", info->memory / (1024.0 * 1024.0), info->threads, IIR::ProcessArchName(info->arch));
+						if (!commandLine.empty()) {
+							ImGui::PushTextWrapPos(ImGui::GetFontSize() * 40.0f);
+							ImGui::TextDisabled("%s", commandLine.c_str());
+							ImGui::PopTextWrapPos();
+						}
+						ImGui::EndTooltip();
+					}
+
+					ImGui::SameLine(220.0f);
+					ImGui::TextDisabled("%u", process.pid);
+					if (info) {
+						ImGui::SameLine(280.0f);
+						ImGui::TextDisabled("%s", IIR::ProcessArchName(info->arch));
+						ImGui::SameLine(330.0f);
+						ImGui::TextDisabled("%.0f MB", info->memory / (1024.0 * 1024.0));
+					}
+					if (!commandLine.empty()) {
+						ImGui::SameLine(400.0f);
+						ImGui::TextDisabled("%s", commandLine.c_str());
+					}
+					ImGui::PopID();
 				}
 			}
-			ImGui::PopID();
+			clipper.End();
+		}
+		ImGui::EndChild();
+
+		if (picked) {
+			pm.OpenProcess(*picked);
+			SetWindowTextA(window.hWnd, std::format("ImInReverse - {} : ({})", picked->name, picked->pid).c_str());
+			ImGui::CloseCurrentPopup();
 		}
 
 		if (ImGui::IsKeyPressed(ImGuiKey_Escape) || (ImGui::IsMouseClicked(0) && !ImGui::IsMouseHoveringRect(windowRect.Min, windowRect.Max) && timeSinceOpened + std::chrono::milliseconds(500) < std::chrono::high_resolution_clock::now())) {
@@ -155,6 +322,8 @@ void MenuBar(const Window& window, IIR::ProcessManager& pm) {
 
 		ImGui::EndPopup();
 	}
+	// Every frame, so the collector stops refreshing once the picker closes
+	IIR::ProcessInfoCollector::GetInstance().Submit();
 
 	ImGui::SetNextWindowPos(ImVec2((float)window.width / 2.0f, (float)window.height / 2.0f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
 	if (ImGui::BeginPopupModal("Settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoTitleBar)) {
@@ -179,13 +348,13 @@ void MenuBar(const Window& window, IIR::ProcessManager& pm) {
 	}
 }
 
-void Ribbon(const Window& window, IIR::StructureManager& sm) {
+void Ribbon(float ribbonWidth, IIR::StructureManager& sm) {
 	ImGui::PushStyleColor(ImGuiCol_ChildBg, ImGui::GetStyleColorVec4(ImGuiCol_MenuBarBg));
 	ImGui::PushStyleVar(ImGuiStyleVar_ChildRounding, 0.0f);
 
 	// (0, height of menu bar)
 	ImGui::SetCursorPos(ImVec2(0.0f, ImGui::GetFrameHeight()));
-	ImGui::BeginChild("##Ribbon", ImVec2((float)window.width, 138), true, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
+	ImGui::BeginChild("##Ribbon", ImVec2(ribbonWidth, 138), true, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
 
 	constexpr float width = 104.0f;
 	ImGui::BeginButtonGroup("Add");
@@ -199,36 +368,55 @@ void Ribbon(const Window& window, IIR::StructureManager& sm) {
 
 	constexpr float width2 = 94.0f;
 	ImGui::BeginButtonGroup("Selected");
-    if (ImGui::GroupedButton(ICON_LC_SQUARE " Hex 64", width2)) {
-        sm.JoinOrSplit(*g_selectedField, 8);
+    if (ImGui::GroupedButton(ICON_LC_SQUARE " Hex 64", width2) && g_selectedOffset) {
+        sm.JoinOrSplit(*g_selectedOffset, 8);
     }
-    if (ImGui::GroupedButton(ICON_LC_ROWS_2 " Hex 32", width2)) {
-        sm.JoinOrSplit(*g_selectedField, 4);
+    if (ImGui::GroupedButton(ICON_LC_ROWS_2 " Hex 32", width2) && g_selectedOffset) {
+        sm.JoinOrSplit(*g_selectedOffset, 4);
     }
-    if (ImGui::GroupedButton(ICON_LC_ROWS_3 " Hex 16", width2)) {
-        sm.JoinOrSplit(*g_selectedField, 2);
+    if (ImGui::GroupedButton(ICON_LC_ROWS_3 " Hex 16", width2) && g_selectedOffset) {
+        sm.JoinOrSplit(*g_selectedOffset, 2);
     }
-    if (ImGui::GroupedButton(ICON_LC_ROWS_4 " Hex 8", width2)) {
-        sm.JoinOrSplit(*g_selectedField, 1);
+    if (ImGui::GroupedButton(ICON_LC_ROWS_4 " Hex 8", width2) && g_selectedOffset) {
+        sm.JoinOrSplit(*g_selectedOffset, 1);
     }
 	ImGui::EndButtonGroup();
 
+	ImGui::BeginButtonGroup("History");
+	if (ImGui::GroupedButton(ICON_LC_UNDO " Undo", width2)) sm.Undo();
+	if (ImGui::GroupedButton(ICON_LC_REDO " Redo", width2)) sm.Redo();
+	ImGui::EndButtonGroup();
+
+	struct Cast {
+		const char* label;
+		IIR::FieldType type;
+	};
+	static constexpr Cast casts[] = {
+		{ ICON_LC_HASH " As i8", IIR::FieldType::i8 },
+		{ ICON_LC_HASH " As u8", IIR::FieldType::u8 },
+		{ ICON_LC_HASH " As i16", IIR::FieldType::i16 },
+		{ ICON_LC_HASH " As u16", IIR::FieldType::u16 },
+		{ ICON_LC_HASH " As i32", IIR::FieldType::i32 },
+		{ ICON_LC_HASH " As u32", IIR::FieldType::u32 },
+		{ ICON_LC_HASH " As i64", IIR::FieldType::i64 },
+		{ ICON_LC_HASH " As u64", IIR::FieldType::u64 },
+		{ ICON_LC_HASH " As f32", IIR::FieldType::f32 },
+		{ ICON_LC_HASH " As f64", IIR::FieldType::f64 },
+		{ ICON_LC_HASH " As bool", IIR::FieldType::boolean },
+		{ ICON_LC_HASH " As char*", IIR::FieldType::str },
+		{ ICON_LC_HASH " As vec2", IIR::FieldType::vec2 },
+		{ ICON_LC_HASH " As vec3", IIR::FieldType::vec3 },
+		{ ICON_LC_HASH " As vec4", IIR::FieldType::vec4 },
+		{ ICON_LC_HASH " As mat3x4", IIR::FieldType::mat3x4 },
+		{ ICON_LC_HASH " As mat4x4", IIR::FieldType::mat4x4 },
+		{ ICON_LC_HASH " As ptr", IIR::FieldType::pointer },
+	};
+
 	ImGui::BeginButtonGroup("Casting");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As i8", width2)) spdlog::info("Cast to int8_t");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As u8", width2)) spdlog::info("Cast to uint8_t");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As i16", width2)) spdlog::info("Cast to int16_t");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As u16", width2)) spdlog::info("Cast to uint16_t");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As i32", width2)) spdlog::info("Cast to int32_t");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As u32", width2)) spdlog::info("Cast to uint32_t");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As i64", width2)) spdlog::info("Cast to int64_t");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As u64", width2)) spdlog::info("Cast to uint64_t");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As f32", width2)) spdlog::info("Cast to float");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As f64", width2)) spdlog::info("Cast to double");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As bool", width2)) spdlog::info("Cast to bool");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As char*", width2)) spdlog::info("Cast to char");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As vec2", width2)) spdlog::info("Cast to vec2");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As vec3", width2)) spdlog::info("Cast to vec3");
-	if (ImGui::GroupedButton(ICON_LC_HASH " As ptr", width2)) spdlog::info("Cast to pointer");
+	for (const auto& cast : casts) {
+		if (ImGui::GroupedButton(cast.label, width2) && g_selectedOffset)
+			sm.SetFieldType(*g_selectedOffset, cast.type);
+	}
 	ImGui::EndButtonGroup();
 
 	ImGui::EndChild();
@@ -236,10 +424,326 @@ void Ribbon(const Window& window, IIR::StructureManager& sm) {
 	ImGui::PopStyleVar();
 }
 
-void MemoryPane(const Window& window, IIR::StructureManager& sm, IIR::OptionsManager& om, IIR::ProcessManager& pm) {
+/// <summary>
+/// One line of the memory pane: a root field or a member of an expanded pointer/instance.
+/// </summary>
+struct PaneRow {
+	IIR::Field field;
+	uintptr_t address = 0;
+	int depth = 0;
+	size_t parent = noParent; // Index of the row this one is a member of, noParent right below a root field.
+	bool cycle = false; // Points back at an object already open further up the tree.
+
+	static constexpr size_t noParent = SIZE_MAX;
+};
+
+static std::set<std::vector<size_t>> g_openNodes;
+
+/// <summary>
+/// Appends the rows of an expanded pointer/instance field, recursing into children that are open too.
+/// Only reads what is needed: the pointer value of each open node, which comes from the last snapshot.
+/// `path` is the node's path on entry and is left that way, it is scratch space for the children's paths.
+/// </summary>
+void ExpandNode(IIR::StructureManager& sm, const IIR::Field& field, uintptr_t address, std::vector<size_t>& path, size_t parent,
+	int depth, std::vector<std::pair<uintptr_t, size_t>>& ancestors, std::vector<PaneRow>& out) {
+	constexpr int maxDepth = 32;
+	if (depth > maxDepth) return;
+
+	auto& reader = IIR::MemoryReader::GetInstance();
+
+	uintptr_t target = address;
+	if (field.fieldType == IIR::FieldType::pointer) {
+		// Keep the pointer itself polled even when its row is scrolled away
+		reader.Request(address, sizeof(uintptr_t));
+		auto data = reader.Frame().Find(address, sizeof(uintptr_t));
+		if (!data) return;
+
+		target = *reinterpret_cast<const uintptr_t*>(data);
+		if (target == 0) return;
+	}
+
+	size_t classIndex = static_cast<size_t>(field.classIndex);
+	if (std::find(ancestors.begin(), ancestors.end(), std::make_pair(target, classIndex)) != ancestors.end()) return;
+	ancestors.push_back({ target, classIndex });
+
+	sm.GetClass(classIndex).fields.ForEach([&](const IIR::Field& child) {
+		PaneRow row{ child, target + child.offset, depth, parent };
+		path.push_back(child.offset);
+
+		bool open = child.IsExpandable() && g_openNodes.contains(path);
+		if (open && child.fieldType == IIR::FieldType::pointer) {
+			auto data = reader.Frame().Find(row.address, sizeof(uintptr_t));
+			uintptr_t childTarget = data ? *reinterpret_cast<const uintptr_t*>(data) : 0;
+			row.cycle = std::find(ancestors.begin(), ancestors.end(), std::make_pair(childTarget, static_cast<size_t>(child.classIndex))) != ancestors.end();
+		}
+
+		out.push_back(row);
+		if (open && !row.cycle)
+			ExpandNode(sm, child, row.address, path, out.size() - 1, depth + 1, ancestors, out);
+		path.pop_back();
+	});
+
+	ancestors.pop_back();
+}
+
+/// <summary>
+/// The field offsets from the root field at `rootOffset` down to children[index], the key of the row in g_openNodes.
+/// </summary>
+void RowPath(const std::vector<PaneRow>& children, size_t rootOffset, size_t index, std::vector<size_t>& out) {
+	out.clear();
+	for (size_t i = index; i != PaneRow::noParent; i = children[i].parent) out.push_back(children[i].field.offset);
+	out.push_back(rootOffset);
+	std::reverse(out.begin(), out.end());
+}
+
+void DrawFieldRow(IIR::StructureManager& sm, IIR::OptionsManager& om, IIR::ProcessManager& pm, const IIR::PointerLabels& labels, const PaneRow& row,
+	const std::vector<size_t>& path) {
+	const auto& field = row.field;
+	auto data = reinterpret_cast<const IIR::MemoryData*>(IIR::MemoryReader::GetInstance().Frame().Find(row.address, field.size));
+
+	ImGui::PushID(static_cast<int>(std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(path.data()), path.size() * sizeof(size_t)))));
+
+	// Only root fields belong to the class being edited
+	bool isRoot = row.depth == 0;
+	bool isSelected = isRoot && (g_selectedOffset == field.offset);
+
+	ImVec4 transparentHighlight = ImGui::GetStyleColorVec4(ImGuiCol_Header);
+	transparentHighlight.w = 0.1f; // or lower for more transparency
+
+	ImGui::PushStyleColor(ImGuiCol_Header, transparentHighlight);
+	ImGui::PushStyleColor(ImGuiCol_HeaderActive, transparentHighlight);
+	ImGui::PushStyleColor(ImGuiCol_HeaderHovered, transparentHighlight);
+
+	if (ImGui::Selectable("##field_line", isSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick | ImGuiSelectableFlags_AllowOverlap)) {
+		if (isRoot) g_selectedOffset = field.offset;
+	}
+
+	ImGui::PopStyleColor(3);
+
+	// Double click to edit the value in the target
+	const auto& typeInfo = IIR::GetFieldTypeInfo(field.fieldType);
+	static char editBuf[256];
+	if (data && ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left) && typeInfo.parse) {
+		typeInfo.format(reinterpret_cast<const uint8_t*>(data), field.size, editBuf, sizeof(editBuf));
+		ImGui::OpenPopup("##edit_value");
+	}
+
+	if (ImGui::BeginPopup("##edit_value")) {
+		ImGui::TextColored(om.typeColour, "%s", typeInfo.name);
+		ImGui::SameLine();
+		if (ImGui::IsWindowAppearing()) ImGui::SetKeyboardFocusHere();
+		if (ImGui::InputText("##value", editBuf, sizeof(editBuf), ImGuiInputTextFlags_EnterReturnsTrue)) {
+			uint8_t bytes[64];
+			if (field.size <= static_cast<int>(sizeof(bytes)) && typeInfo.parse(editBuf, field.size, bytes)) {
+				pm.WriteMemory(row.address, bytes, field.size);
+				ImGui::CloseCurrentPopup();
+			}
+			else {
+				spdlog::warn("'{}' is not a valid {}", editBuf, typeInfo.name);
+			}
+		}
+		ImGui::EndPopup();
+	}
+
+	if (isRoot && ImGui::BeginPopupContextItem("##field_context")) {
+		static char nameBuf[128];
+		if (ImGui::IsWindowAppearing()) strncpy_s(nameBuf, field.name.c_str(), sizeof(nameBuf) - 1);
+		if (ImGui::InputTextWithHint("##field_name", "Name", nameBuf, sizeof(nameBuf), ImGuiInputTextFlags_EnterReturnsTrue)) {
+			sm.SetFieldName(field.offset, nameBuf);
+			ImGui::CloseCurrentPopup();
+		}
+		ImGui::Separator();
+
+		if (ImGui::BeginMenu("Pointer to")) {
+			ImGuiListClipper clipper;
+			clipper.Begin(static_cast<int>(sm.ClassCount()));
+			while (clipper.Step()) {
+				for (size_t c = clipper.DisplayStart; c < static_cast<size_t>(clipper.DisplayEnd); c++) {
+					ImGui::PushID(static_cast<int>(c));
+					if (ImGui::MenuItem(sm.ClassName(c).c_str()))
+						sm.SetFieldClass(field.offset, IIR::FieldType::pointer, c);
+					ImGui::PopID();
+				}
+			}
+			ImGui::Separator();
+			if (ImGui::MenuItem("New class"))
+				sm.SetFieldClass(field.offset, IIR::FieldType::pointer, sm.AddClass(std::format("class{}", sm.ClassCount())));
+			ImGui::EndMenu();
+		}
+
+		if (ImGui::BeginMenu("Embed")) {
+			// Embeds decodes the classes it walks, so it only runs for the rows on screen that fit at all
+			ImGuiListClipper clipper;
+			clipper.Begin(static_cast<int>(sm.ClassCount()));
+			while (clipper.Step()) {
+				for (size_t c = clipper.DisplayStart; c < static_cast<size_t>(clipper.DisplayEnd); c++) {
+					ImGui::PushID(static_cast<int>(c));
+					bool fits = field.offset + sm.ClassSize(c) <= sm.GetSize() && !sm.Embeds(c, sm.GetCurrentClass());
+					if (ImGui::MenuItem(sm.ClassName(c).c_str(), nullptr, false, fits))
+						sm.SetFieldClass(field.offset, IIR::FieldType::instance, c);
+					ImGui::PopID();
+				}
+			}
+			ImGui::EndMenu();
+		}
+
+		ImGui::EndPopup();
+	}
+
+	// Highlight the row if selected
+	if (isSelected) {
+		ImVec2 min = ImGui::GetItemRectMin();
+		ImVec2 max = ImGui::GetItemRectMax();
+		ImU32 col = ImGui::GetColorU32(ImGuiCol_HeaderActive, 0.1f);
+		ImGui::GetWindowDrawList()->AddRectFilled(min, max, col);
+	}
+
+	ImGui::SameLine(0, 0);
+
+	ImGui::BeginGroup();
+
+	if (row.depth > 0) {
+		ImGui::Dummy(ImVec2(row.depth * ImGui::GetStyle().IndentSpacing, 0.0f));
+		ImGui::SameLine(0, 0);
+	}
+
+	if (field.IsExpandable()) {
+		bool open = g_openNodes.contains(path);
+		const char* icon = row.cycle ? ICON_LC_REFRESH_CW : open ? ICON_LC_CHEVRON_DOWN : ICON_LC_CHEVRON_RIGHT;
+		if (ImGui::SmallButton(icon)) {
+			open ? (void)g_openNodes.erase(path) : (void)g_openNodes.insert(path);
+		}
+		if (row.cycle) ImGui::SetItemTooltip("Points back at an object that is already open above");
+	}
+	else {
+		ImGui::TextUnformatted(" ");
+	}
+	ImGui::SameLine();
+
+	auto& cache = IIR::FieldTextCache::GetInstance();
+	const auto& text = cache.Get(field, row.address, reinterpret_cast<const uint8_t*>(data), IIR::MemoryReader::GetInstance().GetGeneration(), labels,
+		[](uintptr_t value) { return value % sizeof(uintptr_t) == 0 && IIR::RegionMap::GetInstance().Get()->IsPointer(value); });
+
+	// Every piece of the row is plain text, nothing goes through a format string
+	auto drawText = [](const ImVec4& colour, std::string_view str) {
+		ImGui::PushStyleColor(ImGuiCol_Text, colour);
+		ImGui::TextUnformatted(str.data(), str.data() + str.size());
+		ImGui::PopStyleColor();
+	};
+	char buf[256];
+
+	drawText(om.offsetColour, cache.View(text.offset));
+	ImGui::SameLine();
+	drawText(om.addressColour, cache.View(text.addressText));
+	ImGui::SameLine();
+
+	if (!field.name.empty()) {
+		drawText(om.nameColour, field.name);
+		ImGui::SameLine();
+	}
+
+	if (field.fieldType == IIR::FieldType::instance && field.IsExpandable()) {
+		// The members show the bytes, the row itself is just a header
+		drawText(om.typeColour, sm.ClassName(static_cast<size_t>(field.classIndex)));
+		ImGui::SameLine();
+		drawText(om.numberColour, IIR::TextWriter(buf, sizeof(buf)).Put('(').Int(field.size).Put(" bytes)").View());
+	}
+	else if (!data) {
+		drawText(om.textColour, "??");
+	}
+	else {
+		drawText(om.typeColour, cache.View(text.ascii));
+		ImGui::SameLine();
+		drawText(om.textColour, cache.View(text.hex));
+
+		if (field.fieldType == IIR::FieldType::pointer && field.IsExpandable()) {
+			ImGui::SameLine();
+			drawText(om.typeColour, IIR::TextWriter(buf, sizeof(buf)).Put(sm.ClassName(static_cast<size_t>(field.classIndex))).Put('*').View());
+		}
+		else if (field.fieldType != IIR::FieldType::unk) {
+			ImGui::SameLine();
+			drawText(om.typeColour, typeInfo.name);
+		}
+		ImGui::SameLine();
+		drawText(om.numberColour, cache.View(text.numeric));
+
+		if (field.fieldType == IIR::FieldType::str) {
+			// The text lives elsewhere, poll the start of it alongside the row
+			constexpr size_t previewSize = 64;
+			auto& reader = IIR::MemoryReader::GetInstance();
+			uintptr_t target = data->u64;
+			reader.Request(target, previewSize);
+
+			if (auto str = reader.Frame().Find(target, previewSize)) {
+				auto chars = reinterpret_cast<const char*>(str);
+				ImGui::SameLine();
+				drawText(om.textColour, IIR::TextWriter(buf, sizeof(buf)).Put('"').Put(std::string_view(chars, strnlen(chars, previewSize))).Put('"').View());
+			}
+		}
+
+		if (text.pointer.end != text.pointer.begin) {
+			ImGui::SameLine();
+			drawText(om.offsetColour, cache.View(text.pointer));
+		}
+	}
+
+	ImGui::EndGroup();
+
+	ImGui::PopID();
+}
+
+static std::shared_ptr<const IIR::AddressExpression> g_addressExpression = nullptr; // What the address box compiled to.
+static std::optional<uintptr_t> g_addressValue = std::nullopt; // What it evaluated to last frame.
+static std::optional<uintptr_t> g_appliedBase = std::nullopt; // The last value the structure was moved to.
+
+/// Compiles the expression typed in the address box, the pane keeps the structure at its address from then on.
+void ApplyAddress(const char* expression) {
+	std::string error;
+	auto compiled = IIR::AddressExpression::Compile(expression, error);
+	if (!compiled) {
+		spdlog::error("Invalid address \"{}\": {}", expression, error);
+		return;
+	}
+
+	g_addressExpression = std::make_shared<const IIR::AddressExpression>(std::move(*compiled));
+	g_appliedBase = std::nullopt;
+}
+
+/// <summary>
+/// Moves the structure to wherever the address expression evaluates to this frame. Names are resolved against the
+/// frame's modules and symbols, pointer chains are followed by the reader thread on every pass. Stops following once the
+/// view was moved somewhere else (e.g. to an instance) until a new address is typed.
+/// </summary>
+void FollowAddress(IIR::StructureManager& sm, const IIR::PointerLabels& labels) {
+	g_addressValue = std::nullopt;
+	if (!g_addressExpression) return;
+
+	if (g_addressExpression->HasDereferences()) {
+		auto& reader = IIR::MemoryReader::GetInstance();
+		reader.Resolve(g_addressExpression);
+		if (auto resolved = reader.Frame().FindResolved(g_addressExpression.get())) g_addressValue = resolved->value;
+	}
+	else {
+		g_addressValue = g_addressExpression->Evaluate([&](std::string_view name) { return IIR::ResolveName(labels.Modules(), labels.Symbols(), name); },
+			[](std::span<IIR::ScatterRead>) {});
+	}
+
+	if (g_addressValue && g_addressValue != g_appliedBase && (!g_appliedBase || *g_appliedBase == sm.GetBase())) {
+		sm.SetBase(*g_addressValue);
+		g_appliedBase = g_addressValue;
+	}
+}
+
+void MemoryPane(IIR::StructureManager& sm, IIR::OptionsManager& om, IIR::ProcessManager& pm) {
+	static auto& paneTimer = IIR::Profiler::GetInstance().GetTimer("Memory pane");
+	IIR::ScopedTimer timer(paneTimer);
+
 	static char buf[128] = "0";
 	static char nameBuf[128] = "unnamed";
 
+	// Hold on to these for the whole frame, every pointer on screen is labelled with them
+	const IIR::PointerLabels labels(IIR::ModuleMap::GetInstance().Get(), IIR::SymbolIndex::GetInstance().Get());
+
 	ImGui::PushStyleColor(ImGuiCol_Text, om.offsetColour);
 	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(4.0f, 0.0f));
 	ImGui::Text(ICON_LC_SHAPES);
@@ -251,27 +755,18 @@ void MemoryPane(const Window& window, IIR::StructureManager& sm, IIR::OptionsMan
 			buf[i] = std::toupper(static_cast<unsigned char>(buf[i]));
 		}
 
-		// Extremely basic parser for now, just try to convert
-		try {
-			if (buf[0] == '+') {
-				size_t ptr = std::stoll(&buf[1], nullptr, 16);
-				HMODULE hMods[1024]; DWORD cbNeeded;
-				if (EnumProcessModulesEx(IIR::ProcessManager::GetInstance().GetHandle(), hMods, sizeof(hMods), &cbNeeded, LIST_MODULES_ALL)) {
-					sm.SetBase(ptr + reinterpret_cast<uintptr_t>(hMods[0]));
-				}
-			}
-			else {
-				size_t ptr = std::stoll(buf, nullptr, 16);
-				sm.SetBase(ptr);
-			}
-		}
-		catch (std::exception e) {
-			spdlog::error("{}", e.what());
-		}
+		ApplyAddress(buf);
+		sm.SetAddress(buf);
 	}
 	ImGui::PopStyleVar();
 	ImGui::PopStyleColor();
-	ImGui::SetItemTooltip(std::format("The memory address of the structure. Current absolute value: 0x{:X}", sm.GetBase()).c_str());
+	if (ImGui::IsItemHovered(ImGuiHoveredFlags_ForTooltip)) {
+		if (g_addressExpression && !g_addressValue)
+			ImGui::SetTooltip("The memory address of the structure. It cannot be resolved right now: a module is not loaded or a pointer on the way cannot be read");
+		else
+			ImGui::SetTooltip("The memory address of the structure, e.g. 1A2B, +1A2B, module.dll+1A2B or [[+10]+20]+8. Current absolute value: 0x%llX",
+				static_cast<unsigned long long>(sm.GetBase()));
+	}
 
 	if (ImGui::BeginPopupContextWindow("Memory address")) {
 		if (ImGui::Button("Copy absolute")) {
@@ -294,130 +789,425 @@ void MemoryPane(const Window& window, IIR::StructureManager& sm, IIR::OptionsMan
 	ImGui::PopStyleColor();
 
 	ImGui::SameLine();
-	ImGui::TextColored(om.numberColour, std::format("[{} {} 0x{:X}]", sm.GetSize(), ICON_LC_ARROW_LEFT_RIGHT, sm.GetSize()).c_str());
+	char sizeBuf[64];
+	IIR::TextWriter sizeText(sizeBuf, sizeof(sizeBuf));
+	sizeText.Put('[').Int(sm.GetSize()).Put(" " ICON_LC_ARROW_LEFT_RIGHT " 0x").Hex(sm.GetSize()).Put(']');
+	ImGui::PushStyleColor(ImGuiCol_Text, om.numberColour);
+	ImGui::TextUnformatted(sizeBuf, sizeBuf + sizeText.Length());
+	ImGui::PopStyleColor();
+
+	ImGui::SameLine();
+	static char notesBuf[4096];
+	if (ImGui::SmallButton(ICON_LC_STICKY_NOTE)) {
+		strncpy_s(notesBuf, sm.GetNotes().c_str(), sizeof(notesBuf) - 1);
+		ImGui::OpenPopup("##class_notes");
+	}
+	ImGui::SetItemTooltip("%s", sm.GetNotes().empty() ? "Notes" : sm.GetNotes().c_str());
+
+	if (ImGui::BeginPopup("##class_notes")) {
+		if (ImGui::InputTextMultiline("##notes", notesBuf, sizeof(notesBuf), ImVec2(400.0f, 200.0f))) {
+			sm.SetNotes(notesBuf);
+		}
+		ImGui::EndPopup();
+	}
 
 	ImGui::Indent();
 
-	auto& fields = sm.GetFields();
+	// Hold on to this version for the whole frame, edits produce a new one
+	const auto fields = sm.GetFields();
+
+	// Open nodes are keyed by their path of offsets so they stay open while pointers change
+	static size_t lastClass = sm.GetCurrentClass();
+	if (lastClass != sm.GetCurrentClass() || g_classesReplaced) {
+		lastClass = sm.GetCurrentClass();
+		g_classesReplaced = false;
+		g_openNodes.clear();
+		g_selectedOffset = std::nullopt;
+		strncpy_s(nameBuf, sm.GetName().c_str(), sizeof(nameBuf) - 1);
+
+		// Go back to where this class was last looked at
+		if (!sm.GetAddress().empty()) {
+			strncpy_s(buf, sm.GetAddress().c_str(), sizeof(buf) - 1);
+			ApplyAddress(buf);
+		}
+	}
+
+	FollowAddress(sm, labels);
+
+	// Rows of every expanded root field, laid out between the root rows
+	struct Block {
+		size_t rootIndex;
+		size_t firstChild; // Index into `children`.
+		size_t count;
+		size_t firstRow; // Row index of the first child.
+	};
+	std::vector<Block> blocks;
+	std::vector<PaneRow> children;
+	std::vector<std::pair<uintptr_t, size_t>> ancestors;
+	// Paths are only built for the node being expanded and the rows drawn, always into this one vector
+	static std::vector<size_t> path;
+
+	for (const auto& key : g_openNodes) {
+		if (key.size() != 1) continue;
+
+		auto idx = sm.FindField(key[0]);
+		if (!idx || !fields[*idx].IsExpandable()) continue;
+
+		ancestors = { { sm.GetBase(), sm.GetCurrentClass() } };
+		size_t first = children.size();
+		path = key;
+		ExpandNode(sm, fields[*idx], sm.GetBase() + fields[*idx].offset, path, PaneRow::noParent, 1, ancestors, children);
+
+		size_t previousRows = blocks.empty() ? 0 : blocks.back().firstRow + blocks.back().count - blocks.back().rootIndex - 1;
+		blocks.push_back({ *idx, first, children.size() - first, *idx + 1 + previousRows });
+	}
+
+	auto& reader = IIR::MemoryReader::GetInstance();
+	size_t rowCount = fields.Size() + children.size();
+
 	ImGuiListClipper clipper;
-	clipper.Begin(static_cast<int>(fields.size()));
+	clipper.Begin(static_cast<int>(rowCount));
 	while (clipper.Step()) {
 		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
-			auto& field = fields[i];
-			auto data = sm.GetFieldData(field);
+			size_t row = static_cast<size_t>(i);
+
+			// Map the row to either a root field or a child row of the nearest block above it
+			auto it = std::upper_bound(blocks.begin(), blocks.end(), row, [](size_t r, const Block& b) { return r < b.firstRow; });
+			size_t rootIndex = row;
+			if (it != blocks.begin()) {
+				const Block& block = *std::prev(it);
+				if (row < block.firstRow + block.count) {
+					size_t index = block.firstChild + (row - block.firstRow);
+					const PaneRow& child = children[index];
+					reader.Request(child.address, child.field.size);
+					RowPath(children, fields[block.rootIndex].offset, index, path);
+					DrawFieldRow(sm, om, pm, labels, child, path);
+					continue;
+				}
+				rootIndex = row - (block.firstRow + block.count - block.rootIndex - 1);
+			}
+
+			const auto& field = fields[rootIndex];
+			PaneRow root{ field, sm.GetBase() + field.offset, 0 };
+			reader.Request(root.address, field.size);
+			path.assign(1, field.offset);
+			DrawFieldRow(sm, om, pm, labels, root, path);
+		}
+	}
+	clipper.End();
 
-			if (field.fieldType == IIR::FieldType::unk) {
-				ImGui::PushID(&field);
+	ImGui::Unindent();
+}
 
-				// Check if this field is currently selected
-				bool isSelected = (g_selectedField == &field);
+/// <summary>
+/// Records the steps of the last frame the window drew, the frame being built only finishes after Render returns.
+/// </summary>
+void RecordFrameTimings(const FrameTimings& timings) {
+	auto& profiler = IIR::Profiler::GetInstance();
+	static auto& preRender = profiler.GetTimer("New frame");
+	static auto& render = profiler.GetTimer("Build UI");
+	static auto& postRender = profiler.GetTimer("Render");
+	static auto& present = profiler.GetTimer("Present");
+
+	preRender.Record(timings.preRender);
+	render.Record(timings.render);
+	postRender.Record(timings.postRender);
+	present.Record(timings.present);
+}
 
-				ImVec4 transparentHighlight = ImGui::GetStyleColorVec4(ImGuiCol_Header);
-				transparentHighlight.w = 0.1f; // or lower for more transparency
+void Render(const Window& window) {
+	auto& pm = IIR::ProcessManager::GetInstance();
+	auto& sm = IIR::StructureManager::GetInstance();
+	auto& om = IIR::OptionsManager::GetInstance();
+	auto& reader = IIR::MemoryReader::GetInstance();
 
-				ImGui::PushStyleColor(ImGuiCol_Header, transparentHighlight);
-				ImGui::PushStyleColor(ImGuiCol_HeaderActive, transparentHighlight);
-				ImGui::PushStyleColor(ImGuiCol_HeaderHovered, transparentHighlight);
+	// Only pay for the timers while someone is looking at them
+	IIR::Profiler::SetEnabled(g_showProfiler);
+	RecordFrameTimings(window.lastFrame);
 
-				if (ImGui::Selectable("##field_line", isSelected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick)) {
-					g_selectedField = &field;
-				}
+	reader.BeginFrame();
 
-				ImGui::PopStyleColor(3);
+	MenuBar(window, pm, sm);
 
-				// Highlight the row if selected
-				if (isSelected) {
-					ImVec2 min = ImGui::GetItemRectMin();
-					ImVec2 max = ImGui::GetItemRectMax();
-					ImU32 col = ImGui::GetColorU32(ImGuiCol_HeaderActive, 0.1f);
-					ImGui::GetWindowDrawList()->AddRectFilled(min, max, col);
-				}
+	if (!ImGui::GetIO().WantTextInput) {
+		if (ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_Z)) sm.Undo();
+		if (ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_Y) || ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiMod_Shift | ImGuiKey_Z)) sm.Redo();
+		if (ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_S)) SaveProject(window, sm);
+	}
 
-				ImGui::SameLine(0, 0);
+	static auto origin = ImVec2(0.0f, 0.0f);
+	ImGui::SetNextWindowPos(origin);
+	ImGui::SetNextWindowSize(ImVec2((float)window.width, (float)window.height));
+	ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
+	ImGui::Begin("ImInReverse", nullptr, windowFlags | ImGuiWindowFlags_MenuBar);
+	Ribbon((float)window.width, sm);
+	MemoryPane(sm, om, pm);
+	IIR::FieldTextCache::GetInstance().EndFrame();
+	ImGui::End();
+	ImGui::PopStyleVar();
 
-				ImGui::BeginGroup();
+	if (g_showArrayView) IIR::ArrayView(sm, om, &g_showArrayView);
+	if (g_showInference) IIR::InferenceView(sm, om, &g_showInference);
+	if (g_showDwarfImport) IIR::DwarfImportView(sm, om, &g_showDwarfImport);
+	if (g_showCompare) IIR::CompareView(sm, om, &g_showCompare);
+	if (g_showInstances) IIR::InstancesView(sm, om, &g_showInstances);
+	if (g_showProfiler) IIR::ProfilerView(om, &g_showProfiler);
+	if (g_showHexView) IIR::HexView(sm, om, &g_showHexView);
+	if (g_showMemoryMap) IIR::MemoryMapView(sm, om, &g_showMemoryMap);
 
-				ImGui::TextColored(om.offsetColour, "%04X", (uint32_t)field.offset);
-				ImGui::SameLine();
-				ImGui::TextColored(om.addressColour, "%012llX", (uintptr_t)(sm.GetBase() + field.offset));
-				ImGui::SameLine();
+	reader.Submit();
+}
 
-				// Text view (variable bytes as ASCII)
-				{
-					int asciiLen = std::min(field.size, 32); // safety
-					char asciiBytes[33] = {};
-					for (int j = 0; j < asciiLen; ++j) {
-						unsigned char c = ((const unsigned char*)data)[j];
-						asciiBytes[j] = (c >= 32 && c <= 126) ? c : '.';
-					}
-					asciiBytes[asciiLen] = '\0';
-					ImGui::TextColored(om.typeColour, "%s", asciiBytes);
-				}
-				ImGui::SameLine();
+/// <summary>
+/// Redraws the window when a background thread publishes something that is on screen. Snapshots are never changed once
+/// published, so a new one is a new pointer.
+/// </summary>
+class SnapshotRedraw : public WBPlugin {
+public:
+	bool NeedsRedraw(Window&) override {
+		bool changed = Changed(memory, IIR::MemoryReader::GetInstance().Latest());
+		changed |= Changed(modules, IIR::ModuleMap::GetInstance().Get());
+		changed |= Changed(symbols, IIR::SymbolIndex::GetInstance().Get());
+		changed |= Changed(processes, IIR::ProcessManager::GetInstance().GetProcesses());
+		changed |= Changed(processInfo, IIR::ProcessInfoCollector::GetInstance().Snapshot());
+		// Proposals come in with every sample, they only matter while they are shown
+		if (g_showInference) changed |= Changed(proposal, IIR::FieldAnalyzer::GetInstance().GetProposal());
+		// The region map only matters to the memory map, elsewhere it just feeds the pointer hints, which are rebuilt
+		// with the bytes they belong to
+		if (g_showMemoryMap) {
+			changed |= Changed(regions, IIR::RegionMap::GetInstance().Get());
+			changed |= Changed(statsVersion, IIR::RegionStatsCollector::GetInstance().Version());
+		}
+		if (g_showHexView) changed |= Changed(pageVersion, IIR::PageCache::GetInstance().Version());
+
+		// The profiler's rates move on every second even when nothing else does, and the page cache stops refreshing
+		// the hex view's pages unless it asks for them again every so often
+		auto now = std::chrono::steady_clock::now();
+		if ((g_showProfiler || g_showHexView) && now - lastTickFrame >= std::chrono::seconds(1)) changed = true;
+		if (changed) lastTickFrame = now;
+		return changed;
+	}
 
-				// Hex view (variable bytes)
-				{
-					int hexLen = std::min(field.size, 32); // safety
-					std::string hexBytes;
-					hexBytes.reserve(3 * hexLen + 1);
-					for (int j = 0; j < hexLen; ++j) {
-						char buf[4];
-						snprintf(buf, sizeof(buf), "%02X ", ((const unsigned char*)data)[j]);
-						hexBytes += buf;
-					}
-					ImGui::TextColored(om.textColour, "%s", hexBytes.c_str());
-				}
-				ImGui::SameLine();
+private:
+	template<typename T>
+	static bool Changed(std::shared_ptr<const T>& seen, std::shared_ptr<const T> latest) {
+		if (seen == latest) return false;
+		seen = std::move(latest);
+		return true;
+	}
 
-				// Numeric view (show as int and hex)
-				if (field.size == 8) {
-					ImGui::TextColored(om.numberColour, "%lld (0x%016llX)", data->i64, data->u64);
-				}
-				else if (field.size == 4) {
-					ImGui::TextColored(om.numberColour, "%d (0x%08X)", data->i32, data->u32);
-				}
-				else if (field.size == 2) {
-					ImGui::TextColored(om.numberColour, "%d (0x%04X)", data->i16, data->u16);
-				}
-				else if (field.size == 1) {
-					ImGui::TextColored(om.numberColour, "%d (0x%02X)", data->i8, data->u8);
-				}
-				else {
-					ImGui::TextColored(om.numberColour, "(%d bytes)", field.size);
-				}
+	static bool Changed(uint64_t& seen, uint64_t latest) {
+		if (seen == latest) return false;
+		seen = latest;
+		return true;
+	}
 
-				if (field.size == 8 && IsProbablyPointer(pm.GetHandle(), data->u64)) {
-					ImGui::SameLine();
-					ImGui::TextColored(om.offsetColour, "-> %llX", data->u64);
+	// Held on to rather than compared by address, a freed snapshot's address could be reused by the next one
+	std::shared_ptr<const IIR::MemorySnapshot> memory;
+	std::shared_ptr<const IIR::ModuleSnapshot> modules;
+	std::shared_ptr<const IIR::SymbolSnapshot> symbols;
+	std::shared_ptr<const IIR::ProcessList> processes;
+	std::shared_ptr<const IIR::ProcessInfoCollector::InfoMap> processInfo;
+	std::shared_ptr<const IIR::LayoutProposal> proposal;
+	std::shared_ptr<const IIR::RegionSnapshot> regions;
+	uint64_t pageVersion = 0;
+	uint64_t statsVersion = 0;
+	std::chrono::steady_clock::time_point lastTickFrame;
+};
+
+/// <summary>
+/// Draws the main window headless for structures of many sizes and prints frame time percentiles of each part.
+/// The target is this process itself: the fields lie over a buffer of generated values, which the reader polls like any
+/// other target's memory while the benchmark keeps changing some of them and scrolling through the pane.
+/// </summary>
+/// <returns>The process exit code.</returns>
+int RunBenchmark(int argc, char* argv[]) {
+	int frames = 600;
+	std::vector<size_t> sizes = { 1000, 100000, 1000000 };
+	for (int i = 0; i + 1 < argc; i += 2) {
+		std::string_view option = argv[i], value = argv[i + 1];
+		if (option == "--frames") {
+			auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), frames);
+			// Percentiles of no samples are meaningless
+			if (ec != std::errc() || end != value.data() + value.size() || frames <= 0) {
+				spdlog::error("--frames expects a positive number, got {}", value);
+				return 1;
+			}
+		}
+		else if (option == "--fields") {
+			sizes.clear();
+			for (size_t pos = 0; pos <= value.size();) {
+				size_t end = std::min(value.find(',', pos), value.size());
+				size_t size = 0;
+				auto [last, ec] = std::from_chars(value.data() + pos, value.data() + end, size);
+				// A benchmark of some other workload than the one asked for would be misleading
+				if (ec != std::errc() || last != value.data() + end || size == 0) {
+					spdlog::error("--fields expects positive numbers separated by commas, got {}", value);
+					return 1;
 				}
+				sizes.push_back(size);
+				pos = end + 1;
+			}
+		}
+		else {
+			spdlog::error("Unknown benchmark option {}, expected --frames N or --fields N[,N...]", option);
+			return 1;
+		}
+	}
 
-				ImGui::EndGroup();
+	auto& pm = IIR::ProcessManager::GetInstance();
+	auto& sm = IIR::StructureManager::GetInstance();
+	auto& om = IIR::OptionsManager::GetInstance();
+	auto& reader = IIR::MemoryReader::GetInstance();
+	if (!pm.OpenProcess(GetCurrentProcessId())) {
+		spdlog::error("Benchmark could not open its own process");
+		return 1;
+	}
 
-				ImGui::PopID();
+	constexpr int width = 1600, height = 900;
+	HeadlessImGui ui(width, height);
+	WindowBuilderImGui::ApplyStyle();
+	ui.MouseMove(width / 2.0f, height / 2.0f);
+
+	struct Samples {
+		const char* name;
+		std::vector<float> ms;
+	};
+
+	std::printf("%10s  %-12s %9s %9s %9s %9s\n", "fields", "step", "p50 ms", "p95 ms", "p99 ms", "max ms");
+	for (size_t size : sizes) {
+		// Counters, doubles, pointers back into the buffer and text, one 8 byte field each
+		std::vector<uint64_t> memory(size);
+		std::vector<IIR::Field> layout(size);
+		for (size_t i = 0; i < size; i++) {
+			static constexpr IIR::FieldType types[] = { IIR::FieldType::i64, IIR::FieldType::f64, IIR::FieldType::pointer, IIR::FieldType::unk };
+			layout[i] = { types[i % 4], i * sizeof(uint64_t), sizeof(uint64_t) };
+			switch (i % 4) {
+			case 0: memory[i] = i; break;
+			case 1: memory[i] = std::bit_cast<uint64_t>(i * 0.25); break;
+			case 2: memory[i] = reinterpret_cast<uintptr_t>(&memory[(i * 7) % size]); break;
+			case 3: std::memcpy(&memory[i], "ImInRev", 8); break;
 			}
 		}
+
+		char address[32];
+		IIR::TextWriter(address, sizeof(address)).Hex(reinterpret_cast<uintptr_t>(memory.data())).Length();
+
+		std::vector<IIR::Structure> classes(1);
+		classes[0].name = "benchmark";
+		classes[0].address = address;
+		classes[0].fields = IIR::FieldList().Insert(0, layout);
+		sm.LoadClasses(std::move(classes), 0, reinterpret_cast<uintptr_t>(memory.data()));
+		g_classesReplaced = true;
+
+		Samples frame{ "frame" }, ribbon{ "ribbon" }, pane{ "memory pane" }, render{ "render" };
+		int warmup = 60;
+		for (int f = -warmup; f < frames; f++) {
+			// Some values change every frame like a live target's, and the pane scrolls down and back up
+			for (size_t i = static_cast<size_t>(f + warmup) % 64; i < size; i += 64)
+				if (i % 4 == 0) memory[i]++;
+			ui.MouseWheel((f / 200) % 2 ? 3.0f : -3.0f);
+
+			float ribbonMs = 0.0f, paneMs = 0.0f;
+			auto timings = ui.Frame([&] {
+				using Clock = std::chrono::steady_clock;
+				reader.BeginFrame();
+
+				ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+				ImGui::SetNextWindowSize(ImVec2((float)width, (float)height));
+				ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
+				ImGui::Begin("ImInReverse", nullptr, windowFlags);
+
+				auto start = Clock::now();
+				Ribbon((float)width, sm);
+				auto ribbonEnd = Clock::now();
+				MemoryPane(sm, om, pm);
+				auto paneEnd = Clock::now();
+				ribbonMs = std::chrono::duration<float, std::milli>(ribbonEnd - start).count();
+				paneMs = std::chrono::duration<float, std::milli>(paneEnd - ribbonEnd).count();
+
+				IIR::FieldTextCache::GetInstance().EndFrame();
+				ImGui::End();
+				ImGui::PopStyleVar();
+
+				reader.Submit();
+			});
+			if (f < 0) continue;
+
+			frame.ms.push_back(timings.newFrame + timings.build + timings.render);
+			ribbon.ms.push_back(ribbonMs);
+			pane.ms.push_back(paneMs);
+			render.ms.push_back(timings.render);
+		}
+
+		for (auto* samples : { &frame, &ribbon, &pane, &render }) {
+			auto& ms = samples->ms;
+			std::sort(ms.begin(), ms.end());
+			auto percentile = [&](double p) { return ms[static_cast<size_t>(p * (ms.size() - 1))]; };
+			std::printf("%10zu  %-12s %9.3f %9.3f %9.3f %9.3f\n", size, samples->name, percentile(0.5), percentile(0.95), percentile(0.99), ms.back());
+		}
 	}
-	clipper.End();
 
-	ImGui::Unindent();
+	pm.CloseProcess();
+	return 0;
 }
 
-void Render(const Window& window) {
+/// <summary>
+/// Drives the memory pane headless through UI paths that have broken before and checks where it ends up.
+/// </summary>
+/// <returns>The process exit code, 1 if a check failed.</returns>
+int RunSelfTest() {
 	auto& pm = IIR::ProcessManager::GetInstance();
 	auto& sm = IIR::StructureManager::GetInstance();
 	auto& om = IIR::OptionsManager::GetInstance();
+	auto& reader = IIR::MemoryReader::GetInstance();
+
+	constexpr int width = 1200, height = 600;
+	HeadlessImGui ui(width, height);
+	WindowBuilderImGui::ApplyStyle();
+
+	auto frames = [&](int count) {
+		for (int f = 0; f < count; f++) {
+			ui.Frame([&] {
+				reader.BeginFrame();
+				ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
+				ImGui::SetNextWindowSize(ImVec2((float)width, (float)height));
+				ImGui::Begin("ImInReverse", nullptr, windowFlags);
+				MemoryPane(sm, om, pm);
+				IIR::FieldTextCache::GetInstance().EndFrame();
+				ImGui::End();
+				reader.Submit();
+			});
+		}
+	};
 
-	MenuBar(window, pm);
-
-	static auto origin = ImVec2(0.0f, 0.0f);
-	ImGui::SetNextWindowPos(origin);
-	ImGui::SetNextWindowSize(ImVec2((float)window.width, (float)window.height));
-	ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0.0f);
-	ImGui::Begin("ImInReverse", nullptr, windowFlags | ImGuiWindowFlags_MenuBar);
-	Ribbon(window, sm);
-	MemoryPane(window, sm, om, pm);
-	ImGui::End();
-	ImGui::PopStyleVar();
+	int failed = 0;
+	auto check = [&](bool ok, const char* what) {
+		if (!ok) {
+			spdlog::error("Self test failed: {}", what);
+			failed++;
+		}
+	};
+
+	// Two classes that were last viewed at different addresses
+	std::vector<IIR::Structure> classes(2);
+	classes[0].name = "first";
+	classes[0].address = "1000";
+	classes[1].name = "second";
+	classes[1].address = "2000";
+	sm.LoadClasses(std::move(classes), 0, 0x1000);
+	g_classesReplaced = true;
+	frames(2);
+	check(sm.GetCurrentClass() == 0 && sm.GetBase() == 0x1000, "the pane is not at the first class' address");
+
+	// Viewing an instance of the other class has to stay on the instance, not go to the class' saved address
+	IIR::ShowInstance(sm, { 1, 0x5000 });
+	frames(3);
+	check(sm.GetCurrentClass() == 1, "showing an instance did not switch to its class");
+	check(sm.GetBase() == 0x5000, "showing an instance of another class moved to the class' address");
+
+	if (!failed) spdlog::info("Self test passed");
+	return failed ? 1 : 0;
 }
 
 int main(int argc, char* argv[]) {
@@ -425,6 +1215,19 @@ int main(int argc, char* argv[]) {
 	auto& sm = IIR::StructureManager::GetInstance();
 	pm.Init();
 	sm.Init();
+	IIR::MemoryReader::GetInstance().Init();
+	IIR::RegionMap::GetInstance().Init();
+	IIR::PageCache::GetInstance().Init();
+	IIR::RegionStatsCollector::GetInstance().Init();
+	IIR::ModuleMap::GetInstance().Init();
+	IIR::SymbolIndex::GetInstance().Init();
+	IIR::FieldAnalyzer::GetInstance().Init();
+	IIR::ProcessInfoCollector::GetInstance().Init();
+
+	if (argc > 1 && std::string_view(argv[1]) == "--bench")
+		return RunBenchmark(argc - 2, argv + 2);
+	if (argc > 1 && std::string_view(argv[1]) == "--selftest")
+		return RunSelfTest();
 
 	auto window = WindowBuilder()
 		.Name("ImInReverse", "ImInReverseClass")
@@ -432,6 +1235,7 @@ int main(int argc, char* argv[]) {
 		.VSync(true)
 		.ImmersiveTitlebar()
 		.Plugin<WindowBuilderImGui>()
+		.Plugin<SnapshotRedraw>()
 		.OnRender(Render)
 		.Build();
 
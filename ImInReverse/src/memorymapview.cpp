@@ -0,0 +1,255 @@
+#include "pch.h"
+#include "iir/views.h"
+#include "iir/regions.h"
+#include "iir/regionstats.h"
+#include "iir/modules.h"
+#include "iir/textformat.h"
+
+using namespace IIR;
+
+namespace {
+	enum Column : int { addressColumn, sizeColumn, protectionColumn, typeColumn, ownerColumn, residentColumn, zeroPagesColumn, entropyColumn };
+
+	struct MemoryMapState {
+		char searchBuf[256] = "";
+		int typeFilter = 0; // Index into typeFilters.
+		bool readableOnly = false;
+
+		// The snapshots the rows were made from, they are remade when either is replaced
+		std::shared_ptr<const RegionSnapshot> regions;
+		std::shared_ptr<const ModuleSnapshot> modules;
+		std::vector<uint32_t> rows; // Indices into regions->regions, filtered and sorted.
+		bool dirty = true;
+
+		Column sortColumn = addressColumn;
+		bool descending = false;
+	};
+
+	MemoryMapState state;
+
+	const char* typeFilters[] = { "All types", "Image", "Mapped", "Private" };
+	const DWORD typeFilterValues[] = { 0, MEM_IMAGE, MEM_MAPPED, MEM_PRIVATE };
+
+	const char* TypeName(DWORD type) {
+		switch (type) {
+		case MEM_IMAGE: return "Image";
+		case MEM_MAPPED: return "Mapped";
+		case MEM_PRIVATE: return "Private";
+		default: return "?";
+		}
+	}
+
+	const char* ProtectionName(DWORD protect) {
+		switch (protect & 0xFF) {
+		case PAGE_NOACCESS: return "---";
+		case PAGE_READONLY: return "R--";
+		case PAGE_READWRITE: return "RW-";
+		case PAGE_WRITECOPY: return "RC-";
+		case PAGE_EXECUTE: return "--X";
+		case PAGE_EXECUTE_READ: return "R-X";
+		case PAGE_EXECUTE_READWRITE: return "RWX";
+		case PAGE_EXECUTE_WRITECOPY: return "RCX";
+		default: return "?";
+		}
+	}
+
+	/// The module an image region belongs to, or the file name of a mapped one. Empty for anything else.
+	std::string_view OwnerName(const MemoryRegion& region) {
+		if (region.IsImage()) {
+			const Module* module = state.modules->Find(region.allocationBase);
+			return module ? std::string_view(module->name) : std::string_view();
+		}
+
+		const std::string* path = state.regions->MappedFile(region);
+		if (!path) return {};
+		std::string_view name = *path;
+		return name.substr(name.find_last_of('\\') + 1);
+	}
+
+	/// Scales a byte count to KB/MB/GB.
+	void FormatSize(char* out, size_t outSize, size_t bytes) {
+		const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+		double value = static_cast<double>(bytes);
+		int unit = 0;
+		while (value >= 1024.0 && unit < 4) {
+			value /= 1024.0;
+			unit++;
+		}
+		if (unit == 0) snprintf(out, outSize, "%zu B", bytes);
+		else snprintf(out, outSize, "%.1f %s", value, units[unit]);
+	}
+
+	bool ContainsIgnoringCase(std::string_view text, std::string_view search) {
+		auto it = std::search(text.begin(), text.end(), search.begin(), search.end(),
+			[](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
+		return it != text.end();
+	}
+
+	/// Filters and sorts every region of the snapshot. Only runs when something it depends on changed, which for a
+	/// process with 100k regions is the difference between a few milliseconds once and a few milliseconds every frame.
+	void UpdateRows() {
+		const auto& all = state.regions->regions;
+		std::string_view search = state.searchBuf;
+		DWORD typeFilter = typeFilterValues[state.typeFilter];
+
+		state.rows.clear();
+		for (uint32_t i = 0; i < all.size(); i++) {
+			const MemoryRegion& region = all[i];
+			if (typeFilter && region.type != typeFilter) continue;
+			if (state.readableOnly && !region.IsReadable()) continue;
+
+			if (!search.empty()) {
+				char addressText[20];
+				auto hex = TextWriter(addressText, sizeof(addressText)).Hex(region.base).View();
+				if (!ContainsIgnoringCase(hex, search) && !ContainsIgnoringCase(OwnerName(region), search)) continue;
+			}
+
+			state.rows.push_back(i);
+		}
+
+		auto less = [&](uint32_t a, uint32_t b) {
+			const MemoryRegion& x = all[a];
+			const MemoryRegion& y = all[b];
+			switch (state.sortColumn) {
+			case sizeColumn: return x.size < y.size;
+			case protectionColumn: return x.protect < y.protect;
+			case typeColumn: return x.type < y.type;
+			case ownerColumn: return OwnerName(x) < OwnerName(y);
+			default: return x.base < y.base;
+			}
+		};
+		// Stable, so regions that compare equal stay in address order
+		if (state.descending) std::stable_sort(state.rows.begin(), state.rows.end(), [&](uint32_t a, uint32_t b) { return less(b, a); });
+		else std::stable_sort(state.rows.begin(), state.rows.end(), less);
+
+		state.dirty = false;
+	}
+
+	void StatsColumns(OptionsManager& om, const MemoryRegion& region) {
+		auto stats = RegionStatsCollector::GetInstance().Get(region);
+
+		ImGui::TableSetColumnIndex(residentColumn);
+		if (!stats) {
+			ImGui::TextDisabled("...");
+			return;
+		}
+
+		char buf[32];
+		FormatSize(buf, sizeof(buf), stats->resident);
+		ImGui::TextColored(om.numberColour, "%s", buf);
+
+		ImGui::TableSetColumnIndex(zeroPagesColumn);
+		if (stats->sampled == 0) {
+			ImGui::TextDisabled("-");
+			return;
+		}
+		ImGui::TextColored(om.numberColour, "%.0f%%", stats->zeroFraction * 100.0f);
+		if (ImGui::BeginItemTooltip()) {
+			FormatSize(buf, sizeof(buf), stats->sampled);
+			ImGui::Text("Of %s read from the resident pages", buf);
+			ImGui::EndTooltip();
+		}
+
+		ImGui::TableSetColumnIndex(entropyColumn);
+		snprintf(buf, sizeof(buf), "%.2f", stats->entropy);
+		ImGui::ProgressBar(stats->entropy / 8.0f, ImVec2(-FLT_MIN, 0.0f), buf);
+		ImGui::SetItemTooltip("Bits per byte: near 0 is mostly one value, near 8 is compressed, encrypted or random");
+	}
+}
+
+void IIR::MemoryMapView(StructureManager& sm, OptionsManager& om, bool* open) {
+	ImGui::SetNextWindowSize(ImVec2(960, 560), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin(ICON_LC_MAP " Memory map", open)) {
+		ImGui::End();
+		return;
+	}
+
+	auto regions = RegionMap::GetInstance().Get();
+	auto modules = ModuleMap::GetInstance().Get();
+	if (regions != state.regions || modules != state.modules) {
+		state.regions = std::move(regions);
+		state.modules = std::move(modules);
+		state.dirty = true;
+	}
+
+	ImGui::SetNextItemWidth(240.0f);
+	state.dirty |= ImGui::InputTextWithHint("##search", "Search addresses and modules", state.searchBuf, sizeof(state.searchBuf));
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(120.0f);
+	state.dirty |= ImGui::Combo("##type", &state.typeFilter, typeFilters, IM_ARRAYSIZE(typeFilters));
+	ImGui::SameLine();
+	state.dirty |= ImGui::Checkbox("Readable", &state.readableOnly);
+
+	constexpr ImGuiTableFlags flags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV |
+		ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable | ImGuiTableFlags_SizingFixedFit;
+	if (ImGui::BeginTable("regions", 8, flags, ImVec2(0.0f, -ImGui::GetTextLineHeightWithSpacing()))) {
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Address", ImGuiTableColumnFlags_DefaultSort, 0.0f, addressColumn);
+		ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, sizeColumn);
+		ImGui::TableSetupColumn("Protection", 0, 0.0f, protectionColumn);
+		ImGui::TableSetupColumn("Type", 0, 0.0f, typeColumn);
+		ImGui::TableSetupColumn("Module / file", ImGuiTableColumnFlags_WidthStretch, 0.0f, ownerColumn);
+		// Stats only exist for rows that have been on screen, there is nothing to sort them by
+		ImGui::TableSetupColumn("Resident", ImGuiTableColumnFlags_NoSort, 0.0f, residentColumn);
+		ImGui::TableSetupColumn("Zero pages", ImGuiTableColumnFlags_NoSort, 0.0f, zeroPagesColumn);
+		ImGui::TableSetupColumn("Entropy", ImGuiTableColumnFlags_NoSort | ImGuiTableColumnFlags_WidthFixed, 90.0f, entropyColumn);
+		ImGui::TableHeadersRow();
+
+		if (ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs(); sortSpecs && sortSpecs->SpecsDirty) {
+			if (sortSpecs->SpecsCount > 0) {
+				state.sortColumn = static_cast<Column>(sortSpecs->Specs[0].ColumnUserID);
+				state.descending = sortSpecs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+			}
+			sortSpecs->SpecsDirty = false;
+			state.dirty = true;
+		}
+
+		if (state.dirty) UpdateRows();
+
+		const auto& all = state.regions->regions;
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(state.rows.size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+				const MemoryRegion& region = all[state.rows[i]];
+				ImGui::PushID(i);
+				ImGui::TableNextRow();
+
+				char buf[32];
+				ImGui::TableSetColumnIndex(addressColumn);
+				TextWriter(buf, sizeof(buf)).Hex(region.base, 16).Length();
+				ImGui::PushStyleColor(ImGuiCol_Text, om.addressColour);
+				if (ImGui::Selectable(buf, false, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick) && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))
+					sm.SetBase(region.base);
+				ImGui::PopStyleColor();
+				ImGui::SetItemTooltip("Double click to show the current class here");
+
+				ImGui::TableSetColumnIndex(sizeColumn);
+				FormatSize(buf, sizeof(buf), region.size);
+				ImGui::TextColored(om.numberColour, "%s", buf);
+
+				ImGui::TableSetColumnIndex(protectionColumn);
+				if (region.protect & PAGE_GUARD) ImGui::Text("%s guard", ProtectionName(region.protect));
+				else ImGui::TextUnformatted(ProtectionName(region.protect));
+
+				ImGui::TableSetColumnIndex(typeColumn);
+				ImGui::TextColored(om.typeColour, "%s", TypeName(region.type));
+
+				ImGui::TableSetColumnIndex(ownerColumn);
+				std::string_view ownerName = OwnerName(region);
+				ImGui::TextColored(om.nameColour, "%.*s", static_cast<int>(ownerName.size()), ownerName.data());
+				if (const std::string* path = state.regions->MappedFile(region); path && !path->empty()) ImGui::SetItemTooltip("%s", path->c_str());
+
+				StatsColumns(om, region);
+				ImGui::PopID();
+			}
+		}
+		clipper.End();
+
+		ImGui::EndTable();
+	}
+
+	ImGui::TextDisabled("%zu of %zu regions", state.rows.size(), state.regions->regions.size());
+
+	ImGui::End();
+}
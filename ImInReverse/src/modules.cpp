@@ -0,0 +1,200 @@
+#include "pch.h"
+#include "iir/modules.h"
+#include "iir/process.h"
+
+using namespace IIR;
+
+namespace {
+	std::string Lowercase(std::string_view text) {
+		std::string result(text);
+		for (char& c : result) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		return result;
+	}
+
+	template <typename T>
+	bool ReadRemote(HANDLE handle, uintptr_t address, T& out) {
+		SIZE_T sizeRead = 0;
+		return ReadProcessMemory(handle, reinterpret_cast<LPCVOID>(address), &out, sizeof(T), &sizeRead) && sizeRead == sizeof(T);
+	}
+
+	/// <summary>
+	/// The link time and size from the PE headers of the image mapped at `base`. Two small reads, far cheaper than asking
+	/// the loader about the module again.
+	/// </summary>
+	std::optional<std::pair<uint32_t, size_t>> ReadImageStamp(HANDLE handle, uintptr_t base) {
+		IMAGE_DOS_HEADER dos;
+		if (!ReadRemote(handle, base, dos) || dos.e_magic != IMAGE_DOS_SIGNATURE) return std::nullopt;
+
+		// SizeOfImage is at the same place in 32 and 64-bit optional headers
+		IMAGE_NT_HEADERS64 nt;
+		if (!ReadRemote(handle, base + dos.e_lfanew, nt) || nt.Signature != IMAGE_NT_SIGNATURE) return std::nullopt;
+		return std::make_pair(static_cast<uint32_t>(nt.FileHeader.TimeDateStamp), static_cast<size_t>(nt.OptionalHeader.SizeOfImage));
+	}
+
+	/// <summary>
+	/// Reads the PDB signature from the CodeView record of the image mapped at `base`, formatted the way symbol servers
+	/// key it: the GUID's hex digits followed by the age. Works for 32 and 64-bit images alike.
+	/// </summary>
+	std::string ReadBuildId(HANDLE handle, uintptr_t base) {
+		IMAGE_DOS_HEADER dos;
+		if (!ReadRemote(handle, base, dos) || dos.e_magic != IMAGE_DOS_SIGNATURE) return {};
+
+		// The headers only differ from the optional header on, read the larger one and pick by its magic
+		IMAGE_NT_HEADERS64 nt;
+		if (!ReadRemote(handle, base + dos.e_lfanew, nt) || nt.Signature != IMAGE_NT_SIGNATURE) return {};
+
+		IMAGE_DATA_DIRECTORY directory;
+		if (nt.OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+			directory = nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG];
+		else
+			directory = reinterpret_cast<const IMAGE_NT_HEADERS32&>(nt).OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG];
+
+		struct CodeViewRecord {
+			DWORD signature; // "RSDS"
+			GUID guid;
+			DWORD age;
+		};
+
+		size_t count = directory.Size / sizeof(IMAGE_DEBUG_DIRECTORY);
+		for (size_t i = 0; i < count && i < 16; i++) {
+			IMAGE_DEBUG_DIRECTORY debug;
+			if (!ReadRemote(handle, base + directory.VirtualAddress + i * sizeof(IMAGE_DEBUG_DIRECTORY), debug)) break;
+			if (debug.Type != IMAGE_DEBUG_TYPE_CODEVIEW || debug.AddressOfRawData == 0) continue;
+
+			CodeViewRecord record;
+			if (!ReadRemote(handle, base + debug.AddressOfRawData, record) || record.signature != 0x53445352) continue;
+
+			const GUID& g = record.guid;
+			return std::format("{:08X}{:04X}{:04X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}{:X}",
+				g.Data1, g.Data2, g.Data3, g.Data4[0], g.Data4[1], g.Data4[2], g.Data4[3], g.Data4[4], g.Data4[5], g.Data4[6], g.Data4[7], record.age);
+		}
+		return {};
+	}
+}
+
+const Module* ModuleSnapshot::FindByName(std::string_view name) const {
+	auto key = Lowercase(name);
+	if (auto it = byName.find(key); it != byName.end()) return &modules[it->second];
+
+	// Allow the extension to be left out
+	for (const auto& [moduleName, index] : byName) {
+		if (moduleName.size() > key.size() && moduleName.starts_with(key) && moduleName[key.size()] == '.')
+			return &modules[index];
+	}
+	return nullptr;
+}
+
+ModuleMap& ModuleMap::GetInstance() {
+	static ModuleMap instance;
+	return instance;
+}
+
+ModuleMap::ModuleMap() {
+	latest.store(std::make_shared<const ModuleSnapshot>());
+}
+
+ModuleMap::~ModuleMap() {
+	this->running = false;
+	if (this->hUpdateThread.joinable()) {
+		this->hUpdateThread.join();
+	}
+}
+
+void ModuleMap::Init() {
+	this->running = true;
+	this->hUpdateThread = std::thread(&ModuleMap::UpdateFunction, this);
+}
+
+std::shared_ptr<ModuleSnapshot> ModuleMap::Refresh(HANDLE handle, const ModuleSnapshot& previous) {
+	if (handles.empty()) handles.resize(256);
+
+	DWORD needed = 0;
+	while (true) {
+		DWORD bytes = static_cast<DWORD>(handles.size() * sizeof(HMODULE));
+		if (!EnumProcessModulesEx(handle, handles.data(), bytes, &needed, LIST_MODULES_ALL)) return nullptr;
+		if (needed <= bytes) break;
+		handles.resize(needed / sizeof(HMODULE) + 32);
+	}
+	size_t count = needed / sizeof(HMODULE);
+	if (count == 0) return nullptr;
+
+	// The executable always comes first
+	uintptr_t mainBase = reinterpret_cast<uintptr_t>(handles[0]);
+
+	std::vector<uintptr_t> bases(count);
+	for (size_t i = 0; i < count; i++) bases[i] = reinterpret_cast<uintptr_t>(handles[i]);
+	std::sort(bases.begin(), bases.end());
+
+	auto snapshot = std::make_shared<ModuleSnapshot>();
+	snapshot->version = previous.version + 1;
+	snapshot->modules.reserve(count);
+
+	bool same = bases.size() == previous.modules.size() && previous.Main() && previous.Main()->base == mainBase;
+	for (uintptr_t base : bases) {
+		// Modules that stayed loaded keep what was read about them, both lists are sorted by base. A module can be
+		// unloaded and another loaded at the same base between refreshes, the PE header tells them apart. Headers that
+		// cannot be read say nothing either way.
+		auto stamp = ReadImageStamp(handle, base);
+		if (const Module* known = previous.Find(base); known && known->base == base &&
+			(!stamp || (stamp->first == known->timeDateStamp && stamp->second == known->size))) {
+			snapshot->modules.push_back(*known);
+			continue;
+		}
+		same = false;
+
+		HMODULE hModule = reinterpret_cast<HMODULE>(base);
+		MODULEINFO info{};
+		if (!GetModuleInformation(handle, hModule, &info, sizeof(info))) continue; // Unloaded since it was listed
+
+		Module& module = snapshot->modules.emplace_back();
+		module.base = base;
+		module.size = info.SizeOfImage;
+		module.timeDateStamp = stamp ? stamp->first : 0;
+
+		char path[MAX_PATH];
+		DWORD length = GetModuleFileNameExA(handle, hModule, path, sizeof(path));
+		module.path.assign(path, length);
+		size_t slash = module.path.find_last_of("\\/");
+		module.name = slash == std::string::npos ? module.path : module.path.substr(slash + 1);
+
+		module.buildId = ReadBuildId(handle, base);
+	}
+	if (same) return nullptr;
+
+	for (size_t i = 0; i < snapshot->modules.size(); i++) {
+		const Module& module = snapshot->modules[i];
+		if (module.base == mainBase) snapshot->mainModule = i;
+		// The same file name can be loaded twice (e.g. from two directories), the first one wins
+		snapshot->byName.emplace(Lowercase(module.name), i);
+	}
+
+	return snapshot;
+}
+
+void ModuleMap::UpdateFunction() {
+	auto& pm = IIR::ProcessManager::GetInstance();
+	HANDLE lastHandle = nullptr;
+	auto lastRefresh = std::chrono::steady_clock::time_point{};
+
+	while (this->running) {
+		auto handle = pm.GetHandle();
+		auto now = std::chrono::steady_clock::now();
+
+		if (handle != lastHandle) {
+			// Never let an address resolve against another process' modules
+			auto empty = std::make_shared<ModuleSnapshot>();
+			empty->version = latest.load()->version + 1;
+			latest.store(std::move(empty));
+			lastHandle = handle;
+			stale = true;
+		}
+
+		if (handle && (stale || now - lastRefresh >= refreshInterval)) {
+			stale = false;
+			if (auto next = Refresh(handle, *latest.load())) latest.store(std::move(next));
+			lastRefresh = now;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+}
@@ -0,0 +1,192 @@
+#include "pch.h"
+#include "iir/pagecache.h"
+#include "iir/process.h"
+#include "iir/profiler.h"
+
+using namespace IIR;
+
+namespace {
+	const ReadMetrics& Metrics() {
+		static const ReadMetrics metrics{
+			Profiler::GetInstance().GetTimer("Page cache read"),
+			Profiler::GetInstance().GetCounter("Page cache reads"),
+			Profiler::GetInstance().GetCounter("Page cache bytes"),
+			Profiler::GetInstance().GetCounter("Page cache failed pages"),
+		};
+		return metrics;
+	}
+}
+
+PageCache& PageCache::GetInstance() {
+	static PageCache instance;
+	return instance;
+}
+
+PageCache::PageCache() = default;
+
+PageCache::~PageCache() {
+	this->running = false;
+	if (this->hUpdateThread.joinable()) {
+		this->hUpdateThread.join();
+	}
+}
+
+void PageCache::Init() {
+	this->running = true;
+	this->hUpdateThread = std::thread(&PageCache::UpdateFunction, this);
+}
+
+void PageCache::Want(const void* owner, const Request& request) {
+	std::lock_guard<std::mutex> lock(mtx);
+	requests[owner] = { request, std::chrono::steady_clock::now() };
+}
+
+std::shared_ptr<const MemoryPage> PageCache::Get(uintptr_t address) {
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = pages.find(address);
+	if (it == pages.end()) return nullptr;
+
+	lru.splice(lru.begin(), lru, it->second);
+	return it->second->page;
+}
+
+std::vector<uintptr_t> PageCache::NextBatch(std::chrono::steady_clock::time_point now) {
+	std::lock_guard<std::mutex> lock(mtx);
+	std::erase_if(requests, [&](const auto& wanted) { return now - wanted.second.lastSeen > idleTimeout; });
+
+	std::vector<uintptr_t> batch;
+
+	// What is on screen comes first, whether it was never read or is due for a refresh
+	for (const auto& [owner, wanted] : requests) {
+		const Request& request = wanted.request;
+		for (uintptr_t page = request.first; page <= request.last && batch.size() < batchPages; page += MemoryPage::size) {
+			auto it = pages.find(page);
+			if (it == pages.end() || now - it->second->readAt >= refreshInterval) batch.push_back(page);
+			if (page == request.last) break; // The last page of the address space
+		}
+	}
+	if (!batch.empty()) return batch;
+
+	// Then whatever is about to scroll into view. Read ahead pages are only read once, they are refreshed when shown.
+	for (const auto& [owner, wanted] : requests) {
+		const Request& request = wanted.request;
+		uintptr_t lowest = PageOf(request.limitBegin);
+
+		size_t below = request.first > lowest ? (request.first - lowest) / MemoryPage::size : 0;
+		size_t above = request.limitEnd > request.last + MemoryPage::size ? (request.limitEnd - request.last - 1) / MemoryPage::size : 0;
+		size_t down = request.direction >= 0 ? std::min(above, prefetchPages) : 0;
+		size_t up = request.direction <= 0 ? std::min(below, prefetchPages) : 0;
+
+		for (size_t i = 1; i <= std::max(down, up) && batch.size() < batchPages; i++) {
+			if (i <= down && !pages.contains(request.last + i * MemoryPage::size)) batch.push_back(request.last + i * MemoryPage::size);
+			if (i <= up && !pages.contains(request.first - i * MemoryPage::size)) batch.push_back(request.first - i * MemoryPage::size);
+		}
+	}
+
+	return batch;
+}
+
+void PageCache::ReadPages(HANDLE handle, const RegionSnapshot* regions, uintptr_t first, size_t count, std::vector<std::shared_ptr<const MemoryPage>>& out) {
+	// Pages the region map knows are unreadable are not worth a syscall. Before the first walk every page is tried.
+	auto readable = [&](uintptr_t page) {
+		if (!regions || regions->regions.empty()) return true;
+		const MemoryRegion* region = regions->Find(page);
+		return region && region->IsReadable();
+	};
+
+	bool allReadable = true;
+	for (size_t i = 0; i < count && allReadable; i++) allReadable = readable(first + i * MemoryPage::size);
+
+	if (count > 1 && allReadable) {
+		std::vector<uint8_t> buffer(count * MemoryPage::size);
+		if (TimedRead(handle, first, buffer.data(), buffer.size(), Metrics(), true)) {
+			for (size_t i = 0; i < count; i++) {
+				auto page = std::make_shared<MemoryPage>();
+				page->address = first + i * MemoryPage::size;
+				page->data.assign(buffer.begin() + i * MemoryPage::size, buffer.begin() + (i + 1) * MemoryPage::size);
+				out.push_back(std::move(page));
+			}
+			return;
+		}
+		// Something in the run went away since the last walk, find out which pages one by one
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		auto page = std::make_shared<MemoryPage>();
+		page->address = first + i * MemoryPage::size;
+		if (readable(page->address)) {
+			page->data.resize(MemoryPage::size);
+			if (!TimedRead(handle, page->address, page->data.data(), page->data.size(), Metrics())) page->data.clear();
+		}
+		out.push_back(std::move(page));
+	}
+}
+
+void PageCache::Store(std::vector<std::shared_ptr<const MemoryPage>>& read, std::chrono::steady_clock::time_point now) {
+	std::lock_guard<std::mutex> lock(mtx);
+	bool changed = false;
+
+	for (auto& page : read) {
+		auto it = pages.find(page->address);
+		if (it != pages.end()) {
+			// A refresh keeps the page where it is in the LRU order, only being looked at counts as a use
+			Entry& entry = *it->second;
+			entry.readAt = now;
+			if (entry.page->data == page->data) continue;
+			entry.page = std::move(page);
+		}
+		else {
+			uintptr_t address = page->address;
+			lru.push_front({ std::move(page), now });
+			pages.emplace(address, lru.begin());
+		}
+		changed = true;
+	}
+
+	while (lru.size() > capacity) {
+		pages.erase(lru.back().page->address);
+		lru.pop_back();
+	}
+
+	if (changed) version.fetch_add(1, std::memory_order_release);
+}
+
+void PageCache::Clear() {
+	std::lock_guard<std::mutex> lock(mtx);
+	lru.clear();
+	pages.clear();
+	version.fetch_add(1, std::memory_order_release);
+}
+
+void PageCache::UpdateFunction() {
+	auto& pm = IIR::ProcessManager::GetInstance();
+	HANDLE lastHandle = nullptr;
+
+	while (this->running) {
+		auto handle = pm.GetHandle();
+		if (handle != lastHandle) {
+			// Never show one process' bytes at another's addresses
+			Clear();
+			lastHandle = handle;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		auto batch = handle ? NextBatch(now) : std::vector<uintptr_t>();
+		if (batch.empty()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+
+		// Consecutive pages are read with one call
+		auto regions = RegionMap::GetInstance().Get();
+		std::vector<std::shared_ptr<const MemoryPage>> read;
+		for (size_t i = 0; i < batch.size();) {
+			size_t run = 1;
+			while (i + run < batch.size() && batch[i + run] == batch[i] + run * MemoryPage::size) run++;
+			ReadPages(handle, regions.get(), batch[i], run, read);
+			i += run;
+		}
+
+		Store(read, now);
+	}
+}
@@ -0,0 +1,82 @@
+// Linux implementation of the process control functions. Not part of the Windows project, it does not use the precompiled header.
+#ifdef __linux__
+
+#include "iir/processcontrol.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace IIR;
+
+namespace {
+	/// The state letter from /proc/<pid>/task/<tid>/stat, 0 if it could not be read.
+	char ReadTaskState(int taskDir, const char* tid) {
+		char path[64];
+		snprintf(path, sizeof(path), "%s/stat", tid);
+
+		int fd = openat(taskDir, path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return 0;
+
+		char buffer[512];
+		ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+		close(fd);
+		if (length <= 0) return 0;
+		buffer[length] = '\0';
+
+		// The name in parentheses can contain anything, the state follows its closing parenthesis
+		const char* close = strrchr(buffer, ')');
+		return close && close[1] == ' ' ? close[2] : 0;
+	}
+
+	bool Signal(uint32_t pid, int signal) {
+		if (kill(static_cast<pid_t>(pid), signal) != 0) {
+			spdlog::error("Failed to send {} to process {}: {}", strsignal(signal), pid, strerror(errno));
+			return false;
+		}
+		return true;
+	}
+}
+
+RunState IIR::QueryRunState(uint32_t pid) {
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%u/task", pid);
+
+	DIR* dir = opendir(path);
+	if (!dir) return RunState::unknown;
+
+	size_t tasks = 0;
+	size_t stopped = 0;
+	while (auto entry = readdir(dir)) {
+		if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+
+		char state = ReadTaskState(dirfd(dir), entry->d_name);
+		if (!state) continue; // Exited while we looked.
+		tasks++;
+		if (state == 'T' || state == 't') stopped++;
+	}
+	closedir(dir);
+
+	if (tasks == 0) return RunState::unknown;
+	if (stopped == 0) return RunState::running;
+	return stopped == tasks ? RunState::suspended : RunState::partial;
+}
+
+// A group stop covers every thread at once. A cgroup freezer would hide the stop from the target's parent,
+// but it needs a cgroup of our own around the target, which we cannot assume
+bool IIR::FreezeProcess(uint32_t pid) {
+	return Signal(pid, SIGSTOP);
+}
+
+bool IIR::ThawProcess(uint32_t pid) {
+	return Signal(pid, SIGCONT);
+}
+
+#endif
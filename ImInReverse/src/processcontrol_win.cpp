@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "iir/processcontrol.h"
+
+using namespace IIR;
+
+namespace {
+	// The parts of ntdll's process and thread information this needs, laid out as the kernel returns them
+	struct NtUnicodeString {
+		USHORT Length;
+		USHORT MaximumLength;
+		PWSTR Buffer;
+	};
+
+	struct NtThreadInformation {
+		LARGE_INTEGER KernelTime;
+		LARGE_INTEGER UserTime;
+		LARGE_INTEGER CreateTime;
+		ULONG WaitTime;
+		PVOID StartAddress;
+		HANDLE UniqueProcess;
+		HANDLE UniqueThread;
+		LONG Priority;
+		LONG BasePriority;
+		ULONG ContextSwitches;
+		ULONG ThreadState;
+		ULONG WaitReason;
+	};
+
+	struct NtProcessInformation {
+		ULONG NextEntryOffset;
+		ULONG NumberOfThreads;
+		BYTE Reserved1[48];
+		NtUnicodeString ImageName;
+		LONG BasePriority;
+		HANDLE UniqueProcessId;
+		HANDLE InheritedFromUniqueProcessId;
+		ULONG HandleCount;
+		ULONG SessionId;
+		ULONG_PTR UniqueProcessKey;
+		SIZE_T Reserved2[12];
+		LARGE_INTEGER Reserved3[6];
+		// Followed by NumberOfThreads NtThreadInformation
+	};
+
+	constexpr ULONG systemProcessInformation = 5;
+	constexpr ULONG threadStateWaiting = 5;
+	constexpr ULONG waitReasonSuspended = 5;
+	constexpr NTSTATUS statusInfoLengthMismatch = static_cast<NTSTATUS>(0xC0000004);
+
+	using NtQuerySystemInformationFn = NTSTATUS(NTAPI*)(ULONG, PVOID, ULONG, PULONG);
+	using NtProcessFn = NTSTATUS(NTAPI*)(HANDLE);
+
+	struct Ntdll {
+		NtQuerySystemInformationFn querySystemInformation = nullptr;
+		NtProcessFn suspendProcess = nullptr;
+		NtProcessFn resumeProcess = nullptr;
+
+		Ntdll() {
+			HMODULE ntdll = GetModuleHandleA("ntdll.dll");
+			if (!ntdll) return;
+			querySystemInformation = reinterpret_cast<NtQuerySystemInformationFn>(GetProcAddress(ntdll, "NtQuerySystemInformation"));
+			suspendProcess = reinterpret_cast<NtProcessFn>(GetProcAddress(ntdll, "NtSuspendProcess"));
+			resumeProcess = reinterpret_cast<NtProcessFn>(GetProcAddress(ntdll, "NtResumeProcess"));
+		}
+	};
+
+	const Ntdll& GetNtdll() {
+		static const Ntdll ntdll;
+		return ntdll;
+	}
+
+	bool CallWithProcess(uint32_t pid, NtProcessFn fn) {
+		if (!fn) return false;
+
+		HANDLE process = ::OpenProcess(PROCESS_SUSPEND_RESUME, FALSE, pid);
+		if (!process) {
+			spdlog::error("Failed to open process {} to suspend or resume it: {}", pid, GetLastError());
+			return false;
+		}
+
+		NTSTATUS status = fn(process);
+		CloseHandle(process);
+		if (status < 0) {
+			spdlog::error("Failed to suspend or resume process {}: 0x{:X}", pid, static_cast<uint32_t>(status));
+			return false;
+		}
+		return true;
+	}
+}
+
+RunState IIR::QueryRunState(uint32_t pid) {
+	auto query = GetNtdll().querySystemInformation;
+	if (!query) return RunState::unknown;
+
+	// One call lists every thread of every process along with its state. The buffer is kept for next time, the
+	// process list only grows a little between calls
+	static std::vector<uint8_t> buffer(1 << 20);
+	ULONG needed = 0;
+	NTSTATUS status;
+	while ((status = query(systemProcessInformation, buffer.data(), static_cast<ULONG>(buffer.size()), &needed)) == statusInfoLengthMismatch)
+		buffer.resize(std::max<size_t>(needed + (needed >> 3), buffer.size() * 2));
+	if (status < 0) return RunState::unknown;
+
+	for (size_t offset = 0;;) {
+		auto process = reinterpret_cast<const NtProcessInformation*>(buffer.data() + offset);
+		if (static_cast<uint32_t>(reinterpret_cast<uintptr_t>(process->UniqueProcessId)) == pid) {
+			auto threads = reinterpret_cast<const NtThreadInformation*>(process + 1);
+			ULONG suspended = 0;
+			for (ULONG i = 0; i < process->NumberOfThreads; i++) {
+				if (threads[i].ThreadState == threadStateWaiting && threads[i].WaitReason == waitReasonSuspended) suspended++;
+			}
+
+			if (suspended == 0) return RunState::running;
+			return suspended == process->NumberOfThreads ? RunState::suspended : RunState::partial;
+		}
+
+		if (process->NextEntryOffset == 0) return RunState::unknown;
+		offset += process->NextEntryOffset;
+	}
+}
+
+bool IIR::FreezeProcess(uint32_t pid) {
+	return CallWithProcess(pid, GetNtdll().suspendProcess);
+}
+
+bool IIR::ThawProcess(uint32_t pid) {
+	return CallWithProcess(pid, GetNtdll().resumeProcess);
+}
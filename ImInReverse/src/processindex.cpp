@@ -0,0 +1,272 @@
+#include "pch.h"
+#include "iir/processindex.h"
+
+#include <charconv>
+#include <climits>
+
+using namespace IIR;
+
+namespace {
+	std::string ToLower(std::string_view text) {
+		std::string lower(text);
+		for (auto& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		return lower;
+	}
+
+	uint32_t Trigram(const char* text) {
+		return static_cast<uint8_t>(text[0]) | static_cast<uint8_t>(text[1]) << 8 | static_cast<uint8_t>(text[2]) << 16;
+	}
+
+	/// One bit per letter and digit, everything else shares the remaining bits.
+	uint64_t CharMask(std::string_view text) {
+		uint64_t mask = 0;
+		for (char c : text) {
+			if (c >= 'a' && c <= 'z') mask |= 1ull << (c - 'a');
+			else if (c >= '0' && c <= '9') mask |= 1ull << (26 + c - '0');
+			else mask |= 1ull << (36 + static_cast<uint8_t>(c) % 28);
+		}
+		return mask;
+	}
+
+	/// 0 if the decimal form of `pid` does not start with `digits`, 1 if it does, 2 if it is `digits`.
+	int MatchPid(uint32_t pid, std::string_view digits) {
+		char text[16];
+		auto end = std::to_chars(text, text + sizeof(text), pid).ptr;
+		std::string_view pidText(text, end - text);
+		if (!pidText.starts_with(digits)) return 0;
+		return pidText.size() == digits.size() ? 2 : 1;
+	}
+
+	bool IsWordStart(std::string_view text, size_t pos) {
+		if (pos == 0) return true;
+		char prev = text[pos - 1];
+		return prev == ' ' || prev == '.' || prev == '-' || prev == '_' || prev == '\\' || prev == '/';
+	}
+
+	constexpr int noMatch = INT_MIN;
+
+	// Command lines are only searched for queries at least this long, a trigram
+	constexpr size_t minCommandLineQuery = 3;
+
+	/// Scores `query` as a subsequence of `text`, rewarding runs of consecutive characters and matches at the start of words.
+	/// Returns noMatch if `text` does not contain every character of `query` in order.
+	int FuzzyScore(std::string_view text, std::string_view query) {
+		int score = 0;
+		size_t pos = 0;
+		size_t last = SIZE_MAX;
+		for (char c : query) {
+			pos = text.find(c, pos);
+			if (pos == std::string_view::npos) return noMatch;
+
+			if (last != SIZE_MAX && pos == last + 1) score += 5;
+			else if (last != SIZE_MAX) score -= static_cast<int>(std::min<size_t>(pos - last, 10));
+			if (IsWordStart(text, pos)) score += 10;
+
+			last = pos++;
+		}
+		return score;
+	}
+}
+
+void ProcessIndex::Update(const ProcessList& list) {
+	if (list.version == listVersion) return;
+	listVersion = list.version;
+
+	for (const auto& process : list.processes) {
+		auto it = byPid.find(process.pid);
+		if (it != byPid.end()) {
+			auto& entry = entries[it->second];
+			if (entry.process.name == process.name && entry.process.commandLine == process.commandLine) {
+				entry.seen = list.version;
+				continue;
+			}
+
+			// The PID was reused or the process exec'd, index it afresh
+			Remove(it->second);
+		}
+		Add(process, list.version);
+	}
+
+	// Whatever this version did not mention has exited
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		if (entries[i].used && entries[i].seen != list.version) Remove(i);
+	}
+
+	if (staleEntries > Size()) RebuildTrigrams();
+}
+
+void ProcessIndex::Add(const Process& process, uint64_t version) {
+	uint32_t index;
+	if (!freeEntries.empty()) {
+		index = freeEntries.back();
+		freeEntries.pop_back();
+	}
+	else {
+		index = static_cast<uint32_t>(entries.size());
+		entries.emplace_back();
+		nameChars.push_back(0);
+		pids.push_back(0);
+		nameRanks.push_back(0);
+	}
+
+	auto& entry = entries[index];
+	entry.process = process;
+	entry.name = ToLower(process.name);
+	entry.commandLine = ToLower(process.commandLine);
+	nameChars[index] = CharMask(entry.name);
+	pids[index] = process.pid;
+	entry.seen = version;
+	entry.used = true;
+
+	byPid[process.pid] = index;
+	IndexTrigrams(index);
+	indexVersion++;
+}
+
+void ProcessIndex::Remove(uint32_t index) {
+	auto& entry = entries[index];
+	byPid.erase(entry.process.pid);
+	entry = Entry{};
+	nameChars[index] = 0;
+	freeEntries.push_back(index);
+
+	staleEntries++;
+	indexVersion++;
+}
+
+void ProcessIndex::IndexTrigrams(uint32_t index) {
+	const auto& text = entries[index].commandLine;
+	if (text.size() < 3) return;
+
+	// Each entry appears at most once per trigram
+	std::vector<uint32_t> keys;
+	keys.reserve(text.size() - 2);
+	for (size_t i = 0; i + 3 <= text.size(); i++) keys.push_back(Trigram(text.data() + i));
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	for (uint32_t key : keys) trigrams[key].push_back(index);
+}
+
+void ProcessIndex::RebuildTrigrams() {
+	trigrams.clear();
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		if (entries[i].used) IndexTrigrams(i);
+	}
+	staleEntries = 0;
+}
+
+int ProcessIndex::Score(const Entry& entry, const Query& query, bool commandLine) const {
+	int score = -1;
+	std::string_view text = query.text;
+
+	size_t index = &entry - entries.data();
+
+	// A name missing any of the query's characters can neither contain it nor match it fuzzily
+	if ((query.chars & ~nameChars[index]) == 0) {
+		size_t pos = entry.name.find(text);
+		if (entry.name == text) score = 1000;
+		else if (pos == 0) score = 800 - static_cast<int>(std::min<size_t>(entry.name.size() - text.size(), 100));
+		else if (pos != std::string::npos) score = (IsWordStart(entry.name, pos) ? 600 : 500) - static_cast<int>(std::min<size_t>(pos, 100));
+		else {
+			int fuzzy = FuzzyScore(entry.name, text);
+			if (fuzzy != noMatch) score = 300 + std::clamp(fuzzy, -50, 150);
+		}
+	}
+
+	if (query.digits) {
+		int pid = MatchPid(pids[index], text);
+		if (pid == 2) score = std::max(score, 950);
+		else if (pid == 1) score = std::max(score, 700);
+	}
+
+	if (score < 0 && commandLine && text.size() >= minCommandLineQuery && entry.commandLine.find(text) != std::string::npos) score = 200;
+
+	return score;
+}
+
+void ProcessIndex::RankNames() {
+	std::vector<uint32_t> order;
+	order.reserve(Size());
+	for (uint32_t i = 0; i < entries.size(); i++) {
+		if (entries[i].used) order.push_back(i);
+	}
+
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		const auto& ea = entries[a];
+		const auto& eb = entries[b];
+		if (ea.name != eb.name) return ea.name < eb.name;
+		return ea.process.pid < eb.process.pid;
+	});
+
+	for (uint32_t rank = 0; rank < order.size(); rank++) nameRanks[order[rank]] = rank;
+	rankedVersion = indexVersion;
+}
+
+std::span<const ProcessIndex::Match> ProcessIndex::Search(std::string_view rawQuery) {
+	Query query;
+	query.text = ToLower(rawQuery);
+	query.chars = CharMask(query.text);
+	query.digits = !query.text.empty() && std::all_of(query.text.begin(), query.text.end(), [](char c) { return c >= '0' && c <= '9'; });
+
+	// A longer query only ever matches a subset of what the shorter one did, unless the shorter one was too short to
+	// search command lines
+	bool addsCommandLines = lastQuery.size() < minCommandLineQuery && query.text.size() >= minCommandLineQuery;
+	bool refine = lastIndexVersion == indexVersion && !lastQuery.empty() && query.text.starts_with(lastQuery) && !addsCommandLines;
+	if (query.text == lastQuery && lastIndexVersion == indexVersion) return results;
+
+	std::vector<Match> previous;
+	previous.swap(results);
+	lastQuery = query.text;
+	lastIndexVersion = indexVersion;
+
+	if (refine) {
+		for (const auto& match : previous) {
+			int score = Score(entries[match.entry], query, true);
+			if (score >= 0) results.push_back({ match.entry, score });
+		}
+	}
+	else {
+		// Names and PIDs are short enough to check every entry, only command lines go through the trigrams
+		std::vector<uint8_t> checked(entries.size(), 0);
+		for (uint32_t i = 0; i < entries.size(); i++) {
+			if (!query.text.empty() && (query.chars & ~nameChars[i]) != 0 && !(query.digits && MatchPid(pids[i], query.text))) continue;
+
+			const auto& entry = entries[i];
+			if (!entry.used) continue;
+			int score = query.text.empty() ? 0 : Score(entry, query, false);
+			if (score >= 0) {
+				results.push_back({ i, score });
+				checked[i] = 1;
+			}
+		}
+
+		if (query.text.size() >= minCommandLineQuery) {
+			// The rarest trigram of the query bounds the candidates
+			const std::vector<uint32_t>* rarest = nullptr;
+			for (size_t i = 0; i + 3 <= query.text.size(); i++) {
+				auto it = trigrams.find(Trigram(query.text.data() + i));
+				if (it == trigrams.end()) {
+					rarest = nullptr;
+					break;
+				}
+				if (!rarest || it->second.size() < rarest->size()) rarest = &it->second;
+			}
+
+			if (rarest) {
+				for (uint32_t index : *rarest) {
+					if (checked[index] || !entries[index].used) continue;
+					checked[index] = 1;
+					if (entries[index].commandLine.find(query.text) != std::string::npos) results.push_back({ index, 200 });
+				}
+			}
+		}
+	}
+
+	if (rankedVersion != indexVersion) RankNames();
+	std::sort(results.begin(), results.end(), [&](const Match& a, const Match& b) {
+		if (a.score != b.score) return a.score > b.score;
+		return nameRanks[a.entry] < nameRanks[b.entry];
+	});
+	return results;
+}
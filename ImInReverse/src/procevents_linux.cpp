@@ -0,0 +1,285 @@
+// Linux backend for ProcessWatcher. Not part of the Windows project, it does not use the precompiled header.
+#ifdef __linux__
+
+#include "iir/procevents.h"
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace IIR;
+
+namespace {
+	/// The name of a process the way Windows would show it: the file name of its image.
+	std::string ReadProcessName(uint32_t pid) {
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/%u/exe", pid);
+
+		char target[4096];
+		ssize_t length = readlink(path, target, sizeof(target) - 1);
+		if (length > 0) {
+			std::string_view image(target, length);
+			constexpr std::string_view deleted = " (deleted)";
+			if (image.ends_with(deleted)) image.remove_suffix(deleted.size());
+			return std::string(image.substr(image.rfind('/') + 1));
+		}
+
+		// Kernel threads and other users' processes have no readable image, comm is always readable but truncated to 15 characters
+		snprintf(path, sizeof(path), "/proc/%u/comm", pid);
+		std::ifstream comm(path);
+		std::string name;
+		std::getline(comm, name);
+		return name;
+	}
+
+	/// The arguments of a process joined by spaces, empty for kernel threads.
+	std::string ReadCommandLine(uint32_t pid) {
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/%u/cmdline", pid);
+
+		std::ifstream file(path, std::ios::binary);
+		std::string line((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		while (!line.empty() && line.back() == '\0') line.pop_back();
+		std::replace(line.begin(), line.end(), '\0', ' ');
+		return line;
+	}
+
+	Process ReadProcess(uint32_t pid) {
+		return { ReadProcessName(pid), pid, ReadCommandLine(pid) };
+	}
+
+	/// Calls `fn` with the PID of every process in /proc.
+	template <typename Fn>
+	void ForEachPid(Fn&& fn) {
+		DIR* dir = opendir("/proc");
+		if (!dir) return;
+
+		while (auto entry = readdir(dir)) {
+			uint32_t pid = 0;
+			auto name = entry->d_name;
+			auto end = name + strlen(name);
+			auto [ptr, ec] = std::from_chars(name, end, pid);
+			if (ec == std::errc() && ptr == end) fn(pid);
+		}
+		closedir(dir);
+	}
+
+	/// <summary>
+	/// Subscribes to the kernel's proc connector, which reports every fork, exec and exit as it happens.
+	/// Listening needs CAP_NET_ADMIN, without it ProcessWatcher::Create falls back to PollingWatcher.
+	/// </summary>
+	class ConnectorWatcher : public ProcessWatcher {
+	public:
+		~ConnectorWatcher() override {
+			Stop();
+			if (sock >= 0) close(sock);
+		}
+
+		/// Opens the socket and asks for events, false if the kernel or our privileges do not allow it.
+		bool Connect() {
+			sock = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+			if (sock < 0) return false;
+
+			sockaddr_nl addr{};
+			addr.nl_family = AF_NETLINK;
+			addr.nl_groups = CN_IDX_PROC;
+			addr.nl_pid = 0; // Let the kernel pick.
+			if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) return false;
+
+			return SetListening(true);
+		}
+
+		std::vector<Process> Scan() override {
+			std::vector<Process> found;
+			ForEachPid([&](uint32_t pid) { found.push_back(ReadProcess(pid)); });
+			return found;
+		}
+
+		bool Start(Callback cb) override {
+			Stop();
+			callback = std::move(cb);
+			running = true;
+			hUpdateThread = std::thread(&ConnectorWatcher::UpdateFunction, this);
+			return true;
+		}
+
+		void Stop() override {
+			running = false;
+			if (hUpdateThread.joinable()) hUpdateThread.join();
+		}
+
+		const char* Describe() const override { return "proc connector"; }
+
+	private:
+		int sock = -1;
+		Callback callback;
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+
+		bool SetListening(bool listen) {
+			// A netlink header, then a connector message carrying the op
+			alignas(nlmsghdr) char buffer[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))] = {};
+
+			auto header = reinterpret_cast<nlmsghdr*>(buffer);
+			header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+			header->nlmsg_type = NLMSG_DONE;
+			header->nlmsg_pid = getpid();
+
+			auto message = static_cast<cn_msg*>(NLMSG_DATA(header));
+			message->id = { CN_IDX_PROC, CN_VAL_PROC };
+			message->len = sizeof(proc_cn_mcast_op);
+
+			proc_cn_mcast_op op = listen ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+			std::memcpy(message->data, &op, sizeof(op));
+
+			return send(sock, buffer, header->nlmsg_len, 0) == static_cast<ssize_t>(header->nlmsg_len);
+		}
+
+		void UpdateFunction() {
+			alignas(nlmsghdr) char buffer[8192];
+			std::vector<ProcessEvent> events;
+
+			while (running) {
+				// Wake up now and then to notice Stop
+				pollfd pfd{ sock, POLLIN, 0 };
+				if (poll(&pfd, 1, 100) <= 0) continue;
+
+				ssize_t received = recv(sock, buffer, sizeof(buffer), 0);
+				if (received <= 0) {
+					if (errno == ENOBUFS) {
+						// The socket overflowed, there is no telling which events were in it
+						spdlog::warn("Process events were dropped, rescanning");
+						if (resync) resync(Scan());
+					}
+					continue;
+				}
+
+				events.clear();
+				for (auto header = reinterpret_cast<nlmsghdr*>(buffer); NLMSG_OK(header, received); header = NLMSG_NEXT(header, received)) {
+					if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP) continue;
+
+					auto message = static_cast<cn_msg*>(NLMSG_DATA(header));
+					if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) continue;
+
+					auto event = reinterpret_cast<const proc_event*>(message->data);
+					switch (event->what) {
+					case proc_event::PROC_EVENT_FORK: {
+						// Threads are reported as forks too, only new thread groups are processes
+						const auto& fork = event->event_data.fork;
+						if (fork.child_pid != fork.child_tgid) break;
+						uint32_t pid = static_cast<uint32_t>(fork.child_tgid);
+						events.push_back({ ProcessEvent::Kind::created, ReadProcess(pid) });
+						break;
+					}
+					case proc_event::PROC_EVENT_EXEC: {
+						uint32_t pid = static_cast<uint32_t>(event->event_data.exec.process_tgid);
+						events.push_back({ ProcessEvent::Kind::exec, ReadProcess(pid) });
+						break;
+					}
+					case proc_event::PROC_EVENT_EXIT: {
+						const auto& exit = event->event_data.exit;
+						if (exit.process_pid != exit.process_tgid) break;
+						events.push_back({ ProcessEvent::Kind::exited, { std::string(), static_cast<uint32_t>(exit.process_tgid) } });
+						break;
+					}
+					default:
+						break;
+					}
+				}
+
+				if (!events.empty()) callback(events);
+			}
+		}
+	};
+
+	/// <summary>
+	/// Diffs /proc against the last pass every few milliseconds. Works without privileges, but a process that starts
+	/// and exits between two passes is never seen.
+	/// </summary>
+	class PollingWatcher : public ProcessWatcher {
+	public:
+		~PollingWatcher() override { Stop(); }
+
+		std::vector<Process> Scan() override {
+			std::vector<Process> found;
+			ForEachPid([&](uint32_t pid) { found.push_back(ReadProcess(pid)); });
+			return found;
+		}
+
+		bool Start(Callback cb) override {
+			Stop();
+			callback = std::move(cb);
+			running = true;
+			hUpdateThread = std::thread(&PollingWatcher::UpdateFunction, this);
+			return true;
+		}
+
+		void Stop() override {
+			running = false;
+			if (hUpdateThread.joinable()) hUpdateThread.join();
+		}
+
+		const char* Describe() const override { return "/proc polling (run with CAP_NET_ADMIN for instant events)"; }
+
+	private:
+		static constexpr auto pollInterval = std::chrono::milliseconds(50);
+
+		Callback callback;
+		std::thread hUpdateThread;
+		std::atomic<bool> running = false;
+
+		void UpdateFunction() {
+			// Value is the pass a PID was last seen in
+			std::unordered_map<uint32_t, uint64_t> known;
+			uint64_t pass = 0;
+			ForEachPid([&](uint32_t pid) { known[pid] = pass; });
+
+			std::vector<ProcessEvent> events;
+			while (running) {
+				std::this_thread::sleep_for(pollInterval);
+				pass++;
+				events.clear();
+
+				// Only new PIDs pay for reading a name
+				ForEachPid([&](uint32_t pid) {
+					auto [it, inserted] = known.try_emplace(pid, pass);
+					it->second = pass;
+					if (inserted) events.push_back({ ProcessEvent::Kind::created, ReadProcess(pid) });
+				});
+
+				std::erase_if(known, [&](const auto& entry) {
+					if (entry.second == pass) return false;
+					events.push_back({ ProcessEvent::Kind::exited, { std::string(), entry.first } });
+					return true;
+				});
+
+				if (!events.empty()) callback(events);
+			}
+		}
+	};
+}
+
+std::unique_ptr<ProcessWatcher> ProcessWatcher::Create() {
+	auto connector = std::make_unique<ConnectorWatcher>();
+	if (connector->Connect()) return connector;
+
+	spdlog::info("Proc connector unavailable ({}), polling /proc instead", strerror(errno));
+	return std::make_unique<PollingWatcher>();
+}
+
+#endif
@@ -0,0 +1,211 @@
+#include "pch.h"
+#include "iir/procevents.h"
+
+#pragma comment(lib, "wbemuuid.lib")
+
+using namespace IIR;
+
+namespace {
+	std::string ReadString(IWbemClassObject* object, const wchar_t* property) {
+		VARIANT vt;
+		std::string result;
+		if (SUCCEEDED(object->Get(property, 0, &vt, nullptr, nullptr)) && vt.vt == VT_BSTR) {
+			std::wstring wname(vt.bstrVal);
+			result.assign(wname.begin(), wname.end());
+		}
+		VariantClear(&vt);
+		return result;
+	}
+
+	uint32_t ReadPid(IWbemClassObject* object, const wchar_t* property) {
+		VARIANT vt;
+		uint32_t pid = 0;
+		if (SUCCEEDED(object->Get(property, 0, &vt, nullptr, nullptr))) pid = vt.uintVal;
+		VariantClear(&vt);
+		return pid;
+	}
+
+	/// <summary>
+	/// Receives process events from WMI. Handles both the trace events, which arrive as soon as a process starts or stops,
+	/// and the polled instance events used when the trace events are not available.
+	/// </summary>
+	class EventSink : public IWbemObjectSink {
+		LONG m_lRef;
+		ProcessWatcher::Callback callback;
+
+	public:
+		EventSink(ProcessWatcher::Callback cb) : m_lRef(0), callback(std::move(cb)) {}
+		virtual ~EventSink() {}
+
+		ULONG STDMETHODCALLTYPE AddRef() override {
+			return InterlockedIncrement(&m_lRef);
+		}
+		ULONG STDMETHODCALLTYPE Release() override {
+			LONG lRef = InterlockedDecrement(&m_lRef);
+			if (lRef == 0) delete this;
+			return lRef;
+		}
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) override {
+			if (riid == IID_IUnknown || riid == IID_IWbemObjectSink) {
+				*ppv = static_cast<IWbemObjectSink*>(this);
+				AddRef();
+				return WBEM_S_NO_ERROR;
+			} else {
+				*ppv = nullptr;
+				return E_NOINTERFACE;
+			}
+		}
+		HRESULT STDMETHODCALLTYPE Indicate(LONG lObjectCount, IWbemClassObject** apObjArray) override {
+			// The whole batch is handed over at once so the list is only rebuilt once
+			std::vector<ProcessEvent> events;
+			events.reserve(lObjectCount);
+
+			for (int i = 0; i < lObjectCount; ++i) {
+				std::string eventClass = ReadString(apObjArray[i], L"__Class");
+
+				if (eventClass == "Win32_ProcessStartTrace" || eventClass == "Win32_ProcessStopTrace") {
+					auto kind = eventClass == "Win32_ProcessStartTrace" ? ProcessEvent::Kind::created : ProcessEvent::Kind::exited;
+					// Traces do not carry the command line
+					events.push_back({ kind, { ReadString(apObjArray[i], L"ProcessName"), ReadPid(apObjArray[i], L"ProcessID") } });
+					continue;
+				}
+
+				VARIANT vtInst;
+				if (FAILED(apObjArray[i]->Get(L"TargetInstance", 0, &vtInst, nullptr, nullptr)) || vtInst.vt != VT_UNKNOWN) {
+					VariantClear(&vtInst);
+					continue;
+				}
+				IWbemClassObject* pInst = (IWbemClassObject*)vtInst.pdispVal;
+				Process p{ ReadString(pInst, L"Name"), ReadPid(pInst, L"ProcessId"), ReadString(pInst, L"CommandLine") };
+				VariantClear(&vtInst);
+
+				if (eventClass == "__InstanceCreationEvent") events.push_back({ ProcessEvent::Kind::created, std::move(p) });
+				else if (eventClass == "__InstanceDeletionEvent") events.push_back({ ProcessEvent::Kind::exited, std::move(p) });
+			}
+
+			if (!events.empty()) callback(events);
+			return WBEM_S_NO_ERROR;
+		}
+		HRESULT STDMETHODCALLTYPE SetStatus(LONG, HRESULT, BSTR, IWbemClassObject*) override {
+			return WBEM_S_NO_ERROR;
+		}
+	};
+
+	class WmiProcessWatcher : public ProcessWatcher {
+	public:
+		WmiProcessWatcher() {
+			HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+			if (FAILED(hr)) throw std::runtime_error("CoInitializeEx failed");
+
+			hr = CoInitializeSecurity(nullptr, -1, nullptr, nullptr,
+				RPC_C_AUTHN_LEVEL_DEFAULT, RPC_C_IMP_LEVEL_IMPERSONATE,
+				nullptr, EOAC_NONE, nullptr);
+			if (FAILED(hr)) throw std::runtime_error("CoInitializeSecurity failed");
+
+			hr = CoCreateInstance(CLSID_WbemLocator, nullptr, CLSCTX_INPROC_SERVER, IID_IWbemLocator, (void**)&pLoc);
+			if (FAILED(hr)) throw std::runtime_error("CoCreateInstance failed");
+
+			hr = pLoc->ConnectServer(_bstr_t(L"ROOT\\CIMV2"), nullptr, nullptr, 0, 0, 0, 0, &pSvc);
+			if (FAILED(hr)) throw std::runtime_error("ConnectServer failed");
+
+			hr = CoSetProxyBlanket(pSvc, RPC_C_AUTHN_WINNT, RPC_C_AUTHZ_NONE, nullptr,
+				RPC_C_AUTHN_LEVEL_CALL, RPC_C_IMP_LEVEL_IMPERSONATE, nullptr, EOAC_NONE);
+			if (FAILED(hr)) throw std::runtime_error("CoSetProxyBlanket failed");
+		}
+
+		~WmiProcessWatcher() override {
+			Stop();
+			if (pSvc) pSvc->Release();
+			if (pLoc) pLoc->Release();
+			CoUninitialize();
+		}
+
+		std::vector<Process> Scan() override {
+			std::vector<Process> found;
+
+			IEnumWbemClassObject* pEnumerator = nullptr;
+			HRESULT hr = pSvc->ExecQuery(
+				_bstr_t("WQL"),
+				_bstr_t("SELECT Name, ProcessId, CommandLine FROM Win32_Process"),
+				WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
+				nullptr,
+				&pEnumerator
+			);
+
+			if (FAILED(hr)) {
+				throw std::runtime_error("ExecQuery failed for initial scan");
+			}
+
+			IWbemClassObject* pClassObject = nullptr;
+			ULONG uReturn = 0;
+
+			while (pEnumerator) {
+				hr = pEnumerator->Next(WBEM_INFINITE, 1, &pClassObject, &uReturn);
+				if (FAILED(hr) || uReturn == 0) break;
+
+				found.push_back({ ReadString(pClassObject, L"Name"), ReadPid(pClassObject, L"ProcessId"), ReadString(pClassObject, L"CommandLine") });
+				pClassObject->Release();
+			}
+
+			if (pEnumerator) pEnumerator->Release();
+			return found;
+		}
+
+		bool Start(Callback callback) override {
+			Stop();
+
+			// The trace events are pushed by the kernel as they happen but need elevation, the instance events
+			// work for everyone but WMI only polls for them once a second
+			constexpr const char* traceQueries[] = { "SELECT * FROM Win32_ProcessStartTrace", "SELECT * FROM Win32_ProcessStopTrace" };
+			constexpr const char* pollQuery = "SELECT * FROM __InstanceOperationEvent WITHIN 1 WHERE TargetInstance ISA 'Win32_Process'";
+
+			traced = true;
+			for (auto query : traceQueries) {
+				if (!Subscribe(query, callback)) {
+					traced = false;
+					break;
+				}
+			}
+			if (traced) return true;
+
+			Stop();
+			return Subscribe(pollQuery, callback);
+		}
+
+		void Stop() override {
+			for (auto sink : sinks) {
+				pSvc->CancelAsyncCall(sink);
+				sink->Release();
+			}
+			sinks.clear();
+		}
+
+		const char* Describe() const override {
+			return traced ? "WMI process traces" : "WMI instance events (polled every second, run elevated for instant events)";
+		}
+
+	private:
+		IWbemLocator* pLoc = nullptr;
+		IWbemServices* pSvc = nullptr;
+		std::vector<IWbemObjectSink*> sinks;
+		bool traced = false;
+
+		bool Subscribe(const char* query, const Callback& callback) {
+			auto sink = new EventSink(callback);
+			sink->AddRef();
+
+			HRESULT hr = pSvc->ExecNotificationQueryAsync(_bstr_t("WQL"), _bstr_t(query), WBEM_FLAG_SEND_STATUS, nullptr, sink);
+			if (FAILED(hr)) {
+				sink->Release();
+				return false;
+			}
+
+			sinks.push_back(sink);
+			return true;
+		}
+	};
+}
+
+std::unique_ptr<ProcessWatcher> ProcessWatcher::Create() {
+	return std::make_unique<WmiProcessWatcher>();
+}
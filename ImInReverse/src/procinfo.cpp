@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "iir/procinfo.h"
+
+using namespace IIR;
+
+ProcessInfoCollector& ProcessInfoCollector::GetInstance() {
+	static ProcessInfoCollector instance;
+	return instance;
+}
+
+ProcessInfoCollector::ProcessInfoCollector() {
+	published.store(std::make_shared<const InfoMap>());
+}
+
+ProcessInfoCollector::~ProcessInfoCollector() {
+	{
+		std::lock_guard<std::mutex> lock(wantedMtx);
+		this->running = false;
+	}
+	wantedChanged.notify_all();
+	if (this->hUpdateThread.joinable()) {
+		this->hUpdateThread.join();
+	}
+}
+
+void ProcessInfoCollector::Init() {
+	this->running = true;
+	this->hUpdateThread = std::thread(&ProcessInfoCollector::UpdateFunction, this);
+}
+
+void ProcessInfoCollector::Submit() {
+	std::sort(pending.begin(), pending.end());
+	pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+	// Scrolling changes the set, most frames do not
+	if (pending != lastSubmitted) {
+		lastSubmitted = pending;
+		{
+			std::lock_guard<std::mutex> lock(wantedMtx);
+			wanted = pending;
+			dirty = true;
+		}
+		wantedChanged.notify_one();
+	}
+	pending.clear();
+}
+
+void ProcessInfoCollector::UpdateFunction() {
+	std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> lastWanted;
+	std::vector<uint32_t> current;
+	std::vector<uint32_t> stale;
+	std::vector<ProcessInfo> collected;
+
+	while (this->running) {
+		{
+			// Wake up for new PIDs straight away, otherwise often enough to notice expired details
+			std::unique_lock<std::mutex> lock(wantedMtx);
+			wantedChanged.wait_for(lock, std::chrono::milliseconds(250), [this] { return dirty || !running; });
+			if (!this->running) break;
+			current = wanted;
+			dirty = false;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		auto infos = published.load();
+
+		stale.clear();
+		for (uint32_t pid : current) {
+			lastWanted[pid] = now;
+			auto it = infos->find(pid);
+			if (it == infos->end() || now - it->second.collected >= timeToLive) stale.push_back(pid);
+		}
+
+		bool forget = std::any_of(infos->begin(), infos->end(), [&](const auto& entry) {
+			return now - lastWanted[entry.first] >= forgetAfter;
+		});
+		if (stale.empty() && !forget) continue;
+
+		collected.clear();
+		if (!stale.empty()) QueryProcessInfo(stale, collected);
+
+		auto next = std::make_shared<InfoMap>(*infos);
+		std::erase_if(*next, [&](const auto& entry) { return now - lastWanted[entry.first] >= forgetAfter; });
+		std::erase_if(lastWanted, [&](const auto& entry) { return now - entry.second >= forgetAfter; });
+		for (auto& info : collected) {
+			info.collected = now;
+			(*next)[info.pid] = std::move(info);
+		}
+		published.store(std::move(next));
+	}
+}
@@ -0,0 +1,128 @@
+// Linux implementation of QueryProcessInfo. Not part of the Windows project, it does not use the precompiled header.
+#ifdef __linux__
+
+#include "iir/procinfo.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <elf.h>
+#include <pwd.h>
+#include <unistd.h>
+
+using namespace IIR;
+
+namespace {
+	std::string ReadFile(const char* path) {
+		std::ifstream file(path, std::ios::binary);
+		return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	}
+
+	/// The value after "`key`:" in /proc/<pid>/status, e.g. "VmRSS:	  1234 kB" gives "1234 kB".
+	std::string_view StatusField(std::string_view status, std::string_view key) {
+		size_t pos = 0;
+		while (pos < status.size()) {
+			size_t end = status.find('\n', pos);
+			if (end == std::string_view::npos) end = status.size();
+
+			auto line = status.substr(pos, end - pos);
+			if (line.size() > key.size() && line.starts_with(key) && line[key.size()] == ':') {
+				auto value = line.substr(key.size() + 1);
+				value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
+				return value;
+			}
+			pos = end + 1;
+		}
+		return {};
+	}
+
+	std::string UserName(uid_t uid) {
+		passwd entry;
+		passwd* result = nullptr;
+		char buffer[1024];
+		if (getpwuid_r(uid, &entry, buffer, sizeof(buffer), &result) == 0 && result) return result->pw_name;
+		return std::to_string(uid);
+	}
+
+	/// The machine the process's image was built for, read from its ELF header.
+	ProcessArch ReadArch(uint32_t pid) {
+		char path[64];
+		snprintf(path, sizeof(path), "/proc/%u/exe", pid);
+
+		std::ifstream file(path, std::ios::binary);
+		Elf64_Ehdr header{};
+		if (!file.read(reinterpret_cast<char*>(&header), EI_NIDENT + sizeof(Elf64_Half) * 2)) return ProcessArch::unknown;
+		if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0) return ProcessArch::unknown;
+
+		// e_machine sits at the same offset in 32 and 64-bit headers
+		switch (header.e_machine) {
+		case EM_386: return ProcessArch::x86;
+		case EM_X86_64: return ProcessArch::x64;
+		case EM_ARM: return ProcessArch::arm;
+		case EM_AARCH64: return ProcessArch::arm64;
+		default: return ProcessArch::unknown;
+		}
+	}
+
+	/// When the system booted, start times in /proc/<pid>/stat are relative to it.
+	std::chrono::system_clock::time_point BootTime() {
+		auto stat = ReadFile("/proc/stat");
+		size_t pos = stat.find("\nbtime ");
+		if (pos == std::string::npos) return {};
+		return std::chrono::system_clock::from_time_t(static_cast<time_t>(std::strtoll(stat.c_str() + pos + 7, nullptr, 10)));
+	}
+}
+
+void IIR::QueryProcessInfo(std::span<const uint32_t> pids, std::vector<ProcessInfo>& out) {
+	static const auto bootTime = BootTime();
+	static const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+	static const long pageSize = sysconf(_SC_PAGESIZE);
+
+	char path[64];
+	for (uint32_t pid : pids) {
+		ProcessInfo& info = out.emplace_back();
+		info.pid = pid;
+
+		snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+		auto stat = ReadFile(path);
+		if (stat.empty()) continue;
+		info.valid = true;
+
+		// The name in parentheses can contain anything, the fields after it are counted from its closing parenthesis
+		size_t close = stat.rfind(')');
+		if (close != std::string::npos) {
+			std::istringstream fields(stat.substr(close + 2));
+			std::string field;
+			unsigned long long startTicks = 0;
+			long long rssPages = 0;
+			long long threads = 0;
+			// Fields 3 onwards, see proc(5): threads is 20, start time 22 and rss 24
+			for (int i = 3; fields >> field && i <= 24; i++) {
+				if (i == 20) threads = std::strtoll(field.c_str(), nullptr, 10);
+				else if (i == 22) startTicks = std::strtoull(field.c_str(), nullptr, 10);
+				else if (i == 24) rssPages = std::strtoll(field.c_str(), nullptr, 10);
+			}
+
+			info.threads = static_cast<uint32_t>(threads);
+			info.memory = static_cast<uint64_t>(rssPages) * pageSize;
+			if (ticksPerSecond > 0)
+				info.started = bootTime + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(static_cast<double>(startTicks) / ticksPerSecond));
+		}
+
+		snprintf(path, sizeof(path), "/proc/%u/status", pid);
+		auto status = ReadFile(path);
+		auto uid = StatusField(status, "Uid");
+		if (!uid.empty()) info.user = UserName(static_cast<uid_t>(std::strtoul(std::string(uid).c_str(), nullptr, 10)));
+
+		snprintf(path, sizeof(path), "/proc/%u/cmdline", pid);
+		info.commandLine = ReadFile(path);
+		while (!info.commandLine.empty() && info.commandLine.back() == '\0') info.commandLine.pop_back();
+		std::replace(info.commandLine.begin(), info.commandLine.end(), '\0', ' ');
+
+		info.arch = ReadArch(pid);
+	}
+}
+
+#endif
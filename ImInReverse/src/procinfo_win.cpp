@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "iir/procinfo.h"
+
+using namespace IIR;
+
+namespace {
+	ProcessArch ArchFromMachine(USHORT machine) {
+		switch (machine) {
+		case IMAGE_FILE_MACHINE_I386: return ProcessArch::x86;
+		case IMAGE_FILE_MACHINE_AMD64: return ProcessArch::x64;
+		case IMAGE_FILE_MACHINE_ARMNT: return ProcessArch::arm;
+		case IMAGE_FILE_MACHINE_ARM64: return ProcessArch::arm64;
+		default: return ProcessArch::unknown;
+		}
+	}
+
+	ProcessArch QueryArch(HANDLE process) {
+		USHORT processMachine = IMAGE_FILE_MACHINE_UNKNOWN;
+		USHORT nativeMachine = IMAGE_FILE_MACHINE_UNKNOWN;
+		if (!IsWow64Process2(process, &processMachine, &nativeMachine)) return ProcessArch::unknown;
+
+		// Not running under WOW64, so it is native
+		return ArchFromMachine(processMachine == IMAGE_FILE_MACHINE_UNKNOWN ? nativeMachine : processMachine);
+	}
+
+	std::string QueryUser(HANDLE process) {
+		HANDLE token = nullptr;
+		if (!OpenProcessToken(process, TOKEN_QUERY, &token)) return {};
+
+		std::string result;
+		alignas(TOKEN_USER) BYTE buffer[256];
+		DWORD size = 0;
+		if (GetTokenInformation(token, TokenUser, buffer, sizeof(buffer), &size)) {
+			char name[256];
+			char domain[256];
+			DWORD nameSize = sizeof(name);
+			DWORD domainSize = sizeof(domain);
+			SID_NAME_USE use;
+			if (LookupAccountSidA(nullptr, reinterpret_cast<TOKEN_USER*>(buffer)->User.Sid, name, &nameSize, domain, &domainSize, &use))
+				result = std::format("{}\\{}", domain, name);
+		}
+
+		CloseHandle(token);
+		return result;
+	}
+
+	std::chrono::system_clock::time_point QueryStartTime(HANDLE process) {
+		FILETIME creation, exit, kernel, user;
+		if (!GetProcessTimes(process, &creation, &exit, &kernel, &user)) return {};
+
+		// FILETIME counts 100ns intervals since 1601
+		constexpr uint64_t unixEpoch = 116444736000000000ull;
+		uint64_t ticks = static_cast<uint64_t>(creation.dwHighDateTime) << 32 | creation.dwLowDateTime;
+		if (ticks < unixEpoch) return {};
+		return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds((ticks - unixEpoch) * 100)));
+	}
+}
+
+void IIR::QueryProcessInfo(std::span<const uint32_t> pids, std::vector<ProcessInfo>& out) {
+	// Thread counts come from one snapshot of every process rather than one per PID
+	std::unordered_map<uint32_t, uint32_t> threadCounts;
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot != INVALID_HANDLE_VALUE) {
+		PROCESSENTRY32 entry;
+		entry.dwSize = sizeof(entry);
+		if (Process32First(snapshot, &entry)) {
+			do {
+				threadCounts[entry.th32ProcessID] = entry.cntThreads;
+			} while (Process32Next(snapshot, &entry));
+		}
+		CloseHandle(snapshot);
+	}
+
+	for (uint32_t pid : pids) {
+		ProcessInfo& info = out.emplace_back();
+		info.pid = pid;
+
+		auto threads = threadCounts.find(pid);
+		if (threads != threadCounts.end()) info.threads = threads->second;
+
+		// Limited information is all that is needed, and it can be had for far more processes than PROCESS_ALL_ACCESS
+		HANDLE process = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+		if (!process) continue;
+		info.valid = true;
+
+		PROCESS_MEMORY_COUNTERS counters{};
+		if (GetProcessMemoryInfo(process, &counters, sizeof(counters))) info.memory = counters.WorkingSetSize;
+
+		info.arch = QueryArch(process);
+		info.started = QueryStartTime(process);
+		info.user = QueryUser(process);
+
+		CloseHandle(process);
+	}
+}
@@ -0,0 +1,46 @@
+#include "pch.h"
+#include "iir/profiler.h"
+
+using namespace IIR;
+
+size_t TimingSeries::Copy(std::span<float, capacity> out) const {
+	uint64_t total = count.load(std::memory_order_acquire);
+	size_t copied = static_cast<size_t>(std::min<uint64_t>(total, capacity));
+	// A sample written while copying can land in the oldest slot, a profiler can live with that
+	for (size_t i = 0; i < copied; i++)
+		out[i] = samples[(total - copied + i) % capacity].load(std::memory_order_relaxed);
+	return copied;
+}
+
+Profiler& Profiler::GetInstance() {
+	static Profiler instance;
+	return instance;
+}
+
+TimingSeries& Profiler::GetTimer(std::string_view name) {
+	std::lock_guard<std::mutex> lock(mtx);
+	for (auto& timer : timers)
+		if (timer.Name() == name) return timer;
+	return timers.emplace_back(name);
+}
+
+Counter& Profiler::GetCounter(std::string_view name) {
+	std::lock_guard<std::mutex> lock(mtx);
+	for (auto& counter : counters)
+		if (counter.Name() == name) return counter;
+	return counters.emplace_back(name);
+}
+
+std::vector<const TimingSeries*> Profiler::Timers() {
+	std::lock_guard<std::mutex> lock(mtx);
+	std::vector<const TimingSeries*> result;
+	for (const auto& timer : timers) result.push_back(&timer);
+	return result;
+}
+
+std::vector<const Counter*> Profiler::Counters() {
+	std::lock_guard<std::mutex> lock(mtx);
+	std::vector<const Counter*> result;
+	for (const auto& counter : counters) result.push_back(&counter);
+	return result;
+}
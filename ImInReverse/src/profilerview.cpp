@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "iir/views.h"
+#include "iir/profiler.h"
+
+using namespace IIR;
+
+namespace {
+	struct SeriesStats {
+		size_t count = 0;
+		float last = 0.0f, p50 = 0.0f, p99 = 0.0f;
+	};
+
+	/// Copies a series out, `samples` keeps them oldest first for plotting.
+	SeriesStats Measure(const TimingSeries& series, std::span<float, TimingSeries::capacity> samples) {
+		SeriesStats stats;
+		stats.count = series.Copy(samples);
+		if (stats.count == 0) return stats;
+		stats.last = samples[stats.count - 1];
+
+		std::array<float, TimingSeries::capacity> sorted;
+		std::copy_n(samples.begin(), stats.count, sorted.begin());
+		auto percentile = [&](float p) {
+			auto nth = sorted.begin() + static_cast<size_t>(p * (stats.count - 1));
+			std::nth_element(sorted.begin(), nth, sorted.begin() + stats.count);
+			return *nth;
+		};
+		stats.p50 = percentile(0.5f);
+		stats.p99 = percentile(0.99f);
+		return stats;
+	}
+
+	/// A counter's per second rate over the last minute, sampled about once a second while the view is open.
+	struct RateHistory {
+		static constexpr size_t length = 60;
+
+		const Counter* counter = nullptr;
+		uint64_t lastTotal = 0;
+		std::array<float, length> values{};
+		size_t count = 0;
+
+		void Sample(float seconds) {
+			uint64_t total = counter->Total();
+			float rate = static_cast<float>(total - lastTotal) / seconds;
+			lastTotal = total;
+
+			if (count == length) std::rotate(values.begin(), values.begin() + 1, values.end());
+			else count++;
+			values[count - 1] = rate;
+		}
+
+		float Current() const { return count ? values[count - 1] : 0.0f; }
+	};
+
+	/// Scales a rate to K/M/G, in steps of 1024 for bytes and 1000 otherwise.
+	void FormatRate(char* out, size_t outSize, double value, bool bytes) {
+		const char* prefixes[] = { "", "K", "M", "G" };
+		double step = bytes ? 1024.0 : 1000.0;
+		int prefix = 0;
+		while (value >= step && prefix < 3) {
+			value /= step;
+			prefix++;
+		}
+		snprintf(out, outSize, "%.1f %s%s/s", value, prefixes[prefix], bytes ? "B" : "");
+	}
+
+	void TimingRow(OptionsManager& om, const TimingSeries& series) {
+		std::array<float, TimingSeries::capacity> samples;
+		auto stats = Measure(series, samples);
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(series.Name().c_str());
+		ImGui::TableNextColumn();
+		ImGui::TextColored(om.numberColour, "%.3f", stats.last);
+		ImGui::TableNextColumn();
+		ImGui::TextColored(om.numberColour, "%.3f", stats.p50);
+		ImGui::TableNextColumn();
+		ImGui::TextColored(om.numberColour, "%.3f", stats.p99);
+		ImGui::TableNextColumn();
+		ImGui::PushID(&series);
+		ImGui::PlotHistogram("##samples", samples.data(), static_cast<int>(stats.count), 0, nullptr, 0.0f, FLT_MAX, ImVec2(-FLT_MIN, 24.0f));
+		ImGui::PopID();
+	}
+}
+
+void IIR::ProfilerView(OptionsManager& om, bool* open) {
+	ImGui::SetNextWindowSize(ImVec2(560, 520), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin(ICON_LC_GAUGE " Profiler", open)) {
+		ImGui::End();
+		return;
+	}
+
+	auto& profiler = Profiler::GetInstance();
+
+	ImGui::SeparatorText("Timings (ms)");
+	if (ImGui::BeginTable("timings", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit)) {
+		ImGui::TableSetupColumn("Step");
+		ImGui::TableSetupColumn("Last");
+		ImGui::TableSetupColumn("p50");
+		ImGui::TableSetupColumn("p99");
+		ImGui::TableSetupColumn("Recent", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableHeadersRow();
+
+		for (const auto* series : profiler.Timers())
+			TimingRow(om, *series);
+
+		ImGui::EndTable();
+	}
+
+	// Rates are taken over about a second, the window is redrawn at least that often while it is open
+	static std::vector<RateHistory> rates;
+	static auto lastSample = std::chrono::steady_clock::now();
+	auto counters = profiler.Counters();
+	for (size_t i = rates.size(); i < counters.size(); i++)
+		rates.push_back({ counters[i], counters[i]->Total() });
+
+	auto now = std::chrono::steady_clock::now();
+	float elapsed = std::chrono::duration<float>(now - lastSample).count();
+	if (elapsed >= 1.0f) {
+		for (auto& rate : rates) rate.Sample(elapsed);
+		lastSample = now;
+	}
+
+	ImGui::SeparatorText("Counters");
+	if (ImGui::BeginTable("counters", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit)) {
+		ImGui::TableSetupColumn("Counter");
+		ImGui::TableSetupColumn("Total");
+		ImGui::TableSetupColumn("Per second", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableHeadersRow();
+
+		for (const auto& rate : rates) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(rate.counter->Name().c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextColored(om.numberColour, "%llu", static_cast<unsigned long long>(rate.counter->Total()));
+			ImGui::TableNextColumn();
+
+			char current[32];
+			FormatRate(current, sizeof(current), rate.Current(), rate.counter->Name().ends_with("bytes"));
+			ImGui::PushID(&rate);
+			ImGui::PlotLines("##rate", rate.values.data(), static_cast<int>(rate.count), 0, current, 0.0f, FLT_MAX, ImVec2(-FLT_MIN, 32.0f));
+			ImGui::PopID();
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
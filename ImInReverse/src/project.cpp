@@ -0,0 +1,336 @@
+#include "pch.h"
+#include "iir/project.h"
+
+#include <fstream>
+#include <map>
+
+using namespace IIR;
+
+namespace {
+	/// Appends strings to the string table, identical strings are stored once.
+	class StringTable {
+	public:
+		ProjectFile::StringRef Add(std::string_view str) {
+			if (str.empty()) return { 0, 0 };
+
+			auto it = known.find(std::string(str));
+			if (it != known.end()) return it->second;
+
+			ProjectFile::StringRef ref{ static_cast<uint32_t>(data.size()), static_cast<uint32_t>(str.size()) };
+			data.insert(data.end(), str.begin(), str.end());
+			known.emplace(std::string(str), ref);
+			return ref;
+		}
+
+		const std::vector<char>& Data() const { return data; }
+
+	private:
+		std::vector<char> data;
+		std::map<std::string, ProjectFile::StringRef> known;
+	};
+
+	template<typename T>
+	void WriteArray(std::ofstream& out, const std::vector<T>& values) {
+		out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+	}
+
+	void WriteJsonString(std::ofstream& out, std::string_view str) {
+		out << '"';
+		for (char c : str) {
+			switch (c) {
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			case '\r': out << "\\r"; break;
+			case '\t': out << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04X", static_cast<unsigned char>(c));
+					out << escaped;
+				}
+				else {
+					out << c;
+				}
+			}
+		}
+		out << '"';
+	}
+}
+
+std::shared_ptr<const ProjectFile> ProjectFile::Open(const std::filesystem::path& path) {
+	std::shared_ptr<ProjectFile> project(new ProjectFile());
+
+	project->file = MappedFile::Open(path);
+	if (!project->file) return nullptr;
+
+	if (project->file->Size() < sizeof(Header)) {
+		spdlog::error("{} is not a project file", path.string());
+		return nullptr;
+	}
+
+	const uint8_t* view = project->file->Data();
+	const auto* header = reinterpret_cast<const Header*>(view);
+	if (header->magic != magic || header->version == 0 || header->version > version) {
+		spdlog::error("{} is not a project file, or was written by a newer version", path.string());
+		return nullptr;
+	}
+
+	// Make sure every table is inside the file before anything is read from it
+	if (header->version == 1) project->fieldStride = offsetof(FieldRecord, name);
+
+	uint64_t remaining = project->file->Size() - sizeof(Header);
+	auto take = [&](uint64_t count, uint64_t elementSize) -> bool {
+		if (count > remaining / elementSize) return false;
+		remaining -= count * elementSize;
+		return true;
+	};
+	if (!take(header->typeCount, sizeof(TypeName)) || !take(header->classCount, sizeof(ClassRecord)) ||
+		!take(header->fieldCount, project->fieldStride) || !take(header->stringBytes, 1)) {
+		spdlog::error("Project {} is truncated", path.string());
+		return nullptr;
+	}
+
+	project->header = header;
+	project->typeNames = reinterpret_cast<const TypeName*>(view + sizeof(Header));
+	project->classRecords = reinterpret_cast<const ClassRecord*>(project->typeNames + header->typeCount);
+	project->fieldRecords = reinterpret_cast<const uint8_t*>(project->classRecords + header->classCount);
+	project->strings = reinterpret_cast<const char*>(project->fieldRecords + header->fieldCount * project->fieldStride);
+
+	auto validString = [&](StringRef ref) { return static_cast<uint64_t>(ref.offset) + ref.length <= header->stringBytes; };
+	for (uint32_t c = 0; c < header->classCount; c++) {
+		const auto& record = project->classRecords[c];
+		if (!validString(record.name) || !validString(record.address) || !validString(record.notes) ||
+			record.firstField > header->fieldCount || record.fieldCount > header->fieldCount - record.firstField) {
+			spdlog::error("Project {} is corrupt (class {})", path.string(), c);
+			return nullptr;
+		}
+	}
+
+	// Types the file knows about but we do not are loaded as untyped bytes
+	project->types.resize(header->typeCount, FieldType::unk);
+	for (uint32_t t = 0; t < header->typeCount; t++) {
+		std::string_view name(project->typeNames[t].name, strnlen(project->typeNames[t].name, sizeof(TypeName::name)));
+		for (size_t known = 0; known < fieldTypeCount; known++) {
+			if (name == fieldTypeTable[known].name) project->types[t] = static_cast<FieldType>(known);
+		}
+	}
+
+	return project;
+}
+
+ProjectFile::FieldRecord ProjectFile::GetFieldRecord(uint64_t index) const {
+	FieldRecord f{};
+	std::memcpy(&f, fieldRecords + index * fieldStride, fieldStride);
+	return f;
+}
+
+int32_t ProjectFile::EmbeddedClass(const FieldRecord& f) const {
+	bool instance = f.size > 0 && f.type < types.size() && types[f.type] == FieldType::instance;
+	return instance && f.classIndex >= 0 && static_cast<uint32_t>(f.classIndex) < header->classCount ? f.classIndex : -1;
+}
+
+bool ProjectFile::EmbedsRecord(uint32_t from, uint32_t target, std::vector<uint8_t>& visited) const {
+	// Iterative, a corrupt file can chain as many classes as it likes
+	std::vector<uint32_t> stack = { from };
+	while (!stack.empty()) {
+		uint32_t c = stack.back();
+		stack.pop_back();
+		if (c == target) return true;
+		if (visited[c]) continue;
+		visited[c] = true;
+
+		const auto& record = classRecords[c];
+		for (uint32_t i = 0; i < record.fieldCount; i++) {
+			int32_t embedded = EmbeddedClass(GetFieldRecord(record.firstField + i));
+			if (embedded >= 0) stack.push_back(static_cast<uint32_t>(embedded));
+		}
+	}
+	return false;
+}
+
+FieldList ProjectFile::ReadFields(size_t classIndex) const {
+	const auto& record = classRecords[classIndex];
+
+	std::vector<Field> fields;
+	fields.reserve(record.fieldCount);
+
+	size_t offset = 0;
+	std::vector<uint8_t> visited; // Classes that do not lead back to this one, see EmbedsRecord.
+	for (uint32_t i = 0; i < record.fieldCount; i++) {
+		uint64_t index = record.firstField + i;
+		FieldRecord f = GetFieldRecord(index);
+		if (f.size <= 0) continue;
+
+		FieldType type = f.type < types.size() ? types[f.type] : FieldType::unk;
+		int32_t target = f.classIndex >= 0 && static_cast<uint32_t>(f.classIndex) < header->classCount ? f.classIndex : -1;
+		// An embedded class that leads back here would make this one infinitely large, e.g. in a hand edited file
+		if (int32_t embedded = EmbeddedClass(f); embedded >= 0) {
+			if (visited.empty()) visited.resize(header->classCount);
+			if (EmbedsRecord(static_cast<uint32_t>(embedded), static_cast<uint32_t>(classIndex), visited)) {
+				spdlog::warn("Field {} of class {} embeds a class that embeds it back, loading it as bytes", i, classIndex);
+				type = FieldType::unk;
+				target = -1;
+				visited.clear(); // The walk stopped early, what it marked may still lead back.
+			}
+		}
+
+		// Fields are always contiguous, the stored offset is only a sanity check
+		if (f.offset != offset)
+			spdlog::warn("Field {} of class {} is at 0x{:X}, expected 0x{:X}", i, classIndex, f.offset, offset);
+
+		std::string name;
+		if (static_cast<uint64_t>(f.name.offset) + f.name.length <= header->stringBytes) name = GetString(f.name);
+
+		fields.push_back(Field{ type, offset, f.size, target, std::move(name) });
+		offset += f.size;
+	}
+
+	return FieldList().Insert(0, fields);
+}
+
+size_t ProjectFile::ClassSize(size_t classIndex) const {
+	const auto& record = classRecords[classIndex];
+	if (record.fieldCount == 0) return 0;
+
+	// Saved fields are contiguous, so the last one ends where the class does
+	FieldRecord last = GetFieldRecord(record.firstField + record.fieldCount - 1);
+	return static_cast<size_t>(last.offset) + std::max(last.size, 0);
+}
+
+bool IIR::SaveProject(const StructureManager& sm, const std::filesystem::path& path) {
+	std::vector<ProjectFile::TypeName> typeNames(fieldTypeCount);
+	for (size_t t = 0; t < fieldTypeCount; t++) {
+		strncpy_s(typeNames[t].name, fieldTypeTable[t].name, sizeof(typeNames[t].name) - 1);
+	}
+
+	StringTable strings;
+	std::vector<ProjectFile::ClassRecord> classRecords;
+	std::vector<ProjectFile::FieldRecord> fieldRecords;
+	classRecords.reserve(sm.ClassCount());
+
+	for (size_t c = 0; c < sm.ClassCount(); c++) {
+		const auto& cls = sm.GetClass(c);
+
+		ProjectFile::ClassRecord record{};
+		record.name = strings.Add(cls.name);
+		record.address = strings.Add(cls.address);
+		record.notes = strings.Add(cls.notes);
+		record.firstField = fieldRecords.size();
+		record.fieldCount = static_cast<uint32_t>(cls.fields.Size());
+		classRecords.push_back(record);
+
+		cls.fields.ForEach([&](const Field& f) {
+			fieldRecords.push_back({ f.offset, f.size, f.classIndex, static_cast<uint32_t>(f.fieldType), 0, strings.Add(f.name) });
+		});
+	}
+
+	ProjectFile::Header header{};
+	header.magic = ProjectFile::magic;
+	header.version = ProjectFile::version;
+	header.typeCount = static_cast<uint32_t>(typeNames.size());
+	header.classCount = static_cast<uint32_t>(classRecords.size());
+	header.fieldCount = fieldRecords.size();
+	header.stringBytes = strings.Data().size();
+	header.base = sm.GetBase();
+	header.currentClass = static_cast<uint32_t>(sm.GetCurrentClass());
+
+	// Write next to the project and swap it in, a crash halfway through keeps the old file intact
+	auto temp = path;
+	temp += ".tmp";
+	{
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			spdlog::error("Failed to write {}", temp.string());
+			return false;
+		}
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WriteArray(out, typeNames);
+		WriteArray(out, classRecords);
+		WriteArray(out, fieldRecords);
+		WriteArray(out, strings.Data());
+
+		if (!out) {
+			spdlog::error("Failed to write {}", temp.string());
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temp, path, ec);
+	if (ec) {
+		spdlog::error("Failed to save {}: {}", path.string(), ec.message());
+		return false;
+	}
+
+	spdlog::info("Saved {} classes to {}", classRecords.size(), path.string());
+	return true;
+}
+
+bool IIR::LoadProject(StructureManager& sm, const std::filesystem::path& path) {
+	auto project = ProjectFile::Open(path);
+	if (!project) return false;
+
+	const auto& header = project->GetHeader();
+
+	std::vector<Structure> classes(header.classCount);
+	for (uint32_t c = 0; c < header.classCount; c++) {
+		const auto& record = project->GetClassRecord(c);
+		auto& cls = classes[c];
+		cls.name = project->GetString(record.name);
+		cls.address = project->GetString(record.address);
+		cls.notes = project->GetString(record.notes);
+
+		// The mapping stays open for as long as any class still needs it
+		cls.loadFields = [project, c]() { return project->ReadFields(c); };
+		cls.loadedSize = project->ClassSize(c);
+	}
+
+	sm.LoadClasses(std::move(classes), header.currentClass, static_cast<uintptr_t>(header.base));
+
+	spdlog::info("Loaded {} classes from {}", header.classCount, path.string());
+	return true;
+}
+
+bool IIR::ExportProjectJson(const StructureManager& sm, const std::filesystem::path& path) {
+	std::ofstream out(path, std::ios::trunc);
+	if (!out) {
+		spdlog::error("Failed to write {}", path.string());
+		return false;
+	}
+
+	out << "{\n  \"classes\": [";
+	for (size_t c = 0; c < sm.ClassCount(); c++) {
+		const auto& cls = sm.GetClass(c);
+
+		out << (c ? ",\n" : "\n") << "    {\n      \"name\": ";
+		WriteJsonString(out, cls.name);
+		out << ",\n      \"address\": ";
+		WriteJsonString(out, cls.address);
+		out << ",\n      \"notes\": ";
+		WriteJsonString(out, cls.notes);
+		out << ",\n      \"size\": " << cls.TotalSize() << ",\n      \"fields\": [";
+
+		bool first = true;
+		cls.fields.ForEach([&](const Field& f) {
+			out << (first ? "\n" : ",\n") << "        { \"offset\": " << f.offset << ", \"size\": " << f.size << ", \"type\": ";
+			WriteJsonString(out, GetFieldTypeInfo(f.fieldType).name);
+			if (!f.name.empty()) {
+				out << ", \"name\": ";
+				WriteJsonString(out, f.name);
+			}
+			if (f.classIndex >= 0 && static_cast<size_t>(f.classIndex) < sm.ClassCount()) {
+				out << ", \"class\": ";
+				WriteJsonString(out, sm.ClassName(static_cast<size_t>(f.classIndex)));
+			}
+			out << " }";
+			first = false;
+		});
+
+		out << (first ? "]\n    }" : "\n      ]\n    }");
+	}
+	out << "\n  ]\n}\n";
+
+	return static_cast<bool>(out);
+}
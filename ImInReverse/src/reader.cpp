@@ -0,0 +1,213 @@
+#include "pch.h"
+#include "iir/reader.h"
+#include "iir/process.h"
+#include "iir/symbols.h"
+#include "iir/profiler.h"
+
+using namespace IIR;
+
+namespace {
+	/// Every ReadProcessMemory of the reader thread records into these, so it shows up in the profiler.
+	const ReadMetrics& Metrics() {
+		static const ReadMetrics metrics{
+			Profiler::GetInstance().GetTimer("Reader read"),
+			Profiler::GetInstance().GetCounter("Reader reads"),
+			Profiler::GetInstance().GetCounter("Reader bytes"),
+			Profiler::GetInstance().GetCounter("Reader failed pages"),
+		};
+		return metrics;
+	}
+}
+
+MemoryReader& MemoryReader::GetInstance() {
+	static MemoryReader instance;
+	return instance;
+}
+
+MemoryReader::MemoryReader() {
+	auto empty = std::make_shared<const MemorySnapshot>();
+	latest.store(empty);
+	frame = empty;
+}
+
+MemoryReader::~MemoryReader() {
+	this->running = false;
+	if (this->hUpdateThread.joinable()) {
+		this->hUpdateThread.join();
+	}
+}
+
+void MemoryReader::Init() {
+	this->running = true;
+	this->hUpdateThread = std::thread(&MemoryReader::UpdateFunction, this);
+}
+
+void MemoryReader::Submit() {
+	{
+		std::lock_guard<std::mutex> lock(requestMtx);
+		submitted.swap(pending);
+		submittedExpressions.swap(pendingExpressions);
+	}
+	pending.clear();
+	pendingExpressions.clear();
+}
+
+std::shared_ptr<MemorySnapshot> MemoryReader::ReadRanges(HANDLE handle, std::vector<Range> ranges) {
+	auto snapshot = std::make_shared<MemorySnapshot>();
+
+	std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.address < b.address; });
+
+	// Coalesce overlapping and nearby requests
+	std::vector<Range> merged;
+	for (const auto& range : ranges) {
+		if (!merged.empty()) {
+			auto& last = merged.back();
+			uintptr_t lastEnd = last.address + last.size;
+			if (range.address <= lastEnd + mergeGap) {
+				last.size = std::max(lastEnd, range.address + range.size) - last.address;
+				continue;
+			}
+		}
+		merged.push_back(range);
+	}
+
+	auto readSpan = [&](uintptr_t address, size_t size, bool retried) {
+		MemorySnapshot::Span span{ address, size, snapshot->data.size(), false };
+		snapshot->data.resize(span.dataOffset + size);
+
+		span.valid = TimedRead(handle, address, snapshot->data.data() + span.dataOffset, size, Metrics(), retried);
+		snapshot->spans.push_back(span);
+		return span.valid;
+	};
+
+	size_t next = 0;
+	for (const auto& range : merged) {
+		size_t firstSpan = snapshot->spans.size();
+		size_t firstByte = snapshot->data.size();
+		if (readSpan(range.address, range.size, true)) {
+			while (next < ranges.size() && ranges[next].address < range.address + range.size) next++;
+			continue;
+		}
+
+		// Part of the merged range is unreadable, fall back to the individual requests so the readable ones still show up
+		snapshot->spans.resize(firstSpan);
+		snapshot->data.resize(firstByte);
+
+		while (next < ranges.size() && ranges[next].address < range.address + range.size) {
+			// Only overlapping requests are joined here, never gaps
+			uintptr_t start = ranges[next].address;
+			uintptr_t end = start + ranges[next].size;
+			for (next++; next < ranges.size() && ranges[next].address < end; next++)
+				end = std::max(end, ranges[next].address + ranges[next].size);
+
+			readSpan(start, end - start, false);
+		}
+	}
+
+	// Padding so a MemoryData can always be read from the last byte of a span
+	snapshot->data.resize(snapshot->data.size() + sizeof(uint64_t));
+
+	return snapshot;
+}
+
+void MemoryReader::ReadScatter(HANDLE handle, std::span<ScatterRead> reads) {
+	std::vector<uint32_t> order(reads.size());
+	for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return reads[a].address < reads[b].address; });
+
+	std::vector<uint8_t> buffer;
+	for (size_t first = 0; first < order.size();) {
+		// Gather the run of pointers close enough to the first to be read through
+		uintptr_t start = reads[order[first]].address;
+		uintptr_t end = start + sizeof(uintptr_t);
+		size_t last = first + 1;
+		while (last < order.size() && reads[order[last]].address <= end + mergeGap) {
+			end = std::max(end, reads[order[last]].address + sizeof(uintptr_t));
+			last++;
+		}
+
+		buffer.resize(end - start);
+		bool ok = TimedRead(handle, start, buffer.data(), buffer.size(), Metrics(), true);
+
+		for (size_t i = first; i < last; i++) {
+			auto& read = reads[order[i]];
+			if (ok) {
+				std::memcpy(&read.value, buffer.data() + (read.address - start), sizeof(uintptr_t));
+				read.valid = true;
+			}
+			else {
+				// Part of the run is unreadable, read the pointers one by one so the readable ones still resolve
+				read.valid = TimedRead(handle, read.address, &read.value, sizeof(uintptr_t), Metrics());
+			}
+		}
+		first = last;
+	}
+}
+
+std::vector<MemorySnapshot::Resolved> MemoryReader::ResolveExpressions(HANDLE handle, std::vector<std::shared_ptr<const AddressExpression>> expressions) {
+	std::sort(expressions.begin(), expressions.end());
+	expressions.erase(std::unique(expressions.begin(), expressions.end()), expressions.end());
+
+	std::vector<const AddressExpression*> compiled(expressions.size());
+	for (size_t i = 0; i < expressions.size(); i++) compiled[i] = expressions[i].get();
+
+	std::vector<std::optional<uintptr_t>> values(expressions.size());
+	auto modules = ModuleMap::GetInstance().Get();
+	auto symbols = SymbolIndex::GetInstance().Get();
+	AddressExpression::Evaluate(compiled,
+		[&](std::string_view name) { return ResolveName(*modules, *symbols, name); },
+		[&](std::span<ScatterRead> reads) { ReadScatter(handle, reads); },
+		values);
+
+	std::vector<MemorySnapshot::Resolved> resolved(expressions.size());
+	for (size_t i = 0; i < expressions.size(); i++) resolved[i] = { std::move(expressions[i]), values[i] };
+	return resolved;
+}
+
+void MemoryReader::UpdateFunction() {
+	auto& pm = IIR::ProcessManager::GetInstance();
+	std::vector<Range> ranges;
+	std::vector<std::shared_ptr<const AddressExpression>> expressions;
+
+	while (this->running) {
+		auto handle = pm.GetHandle();
+		if (handle == nullptr) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(requestMtx);
+			ranges = submitted;
+			expressions = submittedExpressions;
+		}
+
+		static auto& passTimer = Profiler::GetInstance().GetTimer("Reader pass");
+		std::shared_ptr<MemorySnapshot> snapshot;
+		{
+			ScopedTimer timer(passTimer);
+			snapshot = ReadRanges(handle, std::move(ranges));
+			ranges.clear();
+			snapshot->resolved = ResolveExpressions(handle, std::move(expressions));
+			expressions.clear();
+		}
+
+		auto previous = latest.load();
+		bool changed = snapshot->data != previous->data || snapshot->spans.size() != previous->spans.size() ||
+			!std::equal(snapshot->spans.begin(), snapshot->spans.end(), previous->spans.begin(),
+				[](const MemorySnapshot::Span& a, const MemorySnapshot::Span& b) {
+					return a.address == b.address && a.size == b.size && a.valid == b.valid;
+				}) ||
+			!std::equal(snapshot->resolved.begin(), snapshot->resolved.end(), previous->resolved.begin(), previous->resolved.end(),
+				[](const MemorySnapshot::Resolved& a, const MemorySnapshot::Resolved& b) {
+					return a.expression == b.expression && a.value == b.value;
+				});
+
+		if (changed) {
+			snapshot->generation = previous->generation + 1;
+			latest.store(std::move(snapshot));
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
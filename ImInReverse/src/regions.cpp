@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "iir/regions.h"
+#include "iir/process.h"
+
+using namespace IIR;
+
+RegionMap& RegionMap::GetInstance() {
+	static RegionMap instance;
+	return instance;
+}
+
+RegionMap::RegionMap() {
+	latest.store(std::make_shared<const RegionSnapshot>());
+}
+
+RegionMap::~RegionMap() {
+	this->running = false;
+	if (this->hUpdateThread.joinable()) {
+		this->hUpdateThread.join();
+	}
+}
+
+void RegionMap::Init() {
+	this->running = true;
+	this->hUpdateThread = std::thread(&RegionMap::UpdateFunction, this);
+}
+
+std::shared_ptr<RegionSnapshot> RegionMap::Walk(HANDLE handle, const RegionSnapshot& previous) {
+	auto snapshot = std::make_shared<RegionSnapshot>();
+
+	MEMORY_BASIC_INFORMATION mbi;
+	uintptr_t address = 0;
+	while (VirtualQueryEx(handle, reinterpret_cast<LPCVOID>(address), &mbi, sizeof(mbi)) == sizeof(mbi)) {
+		uintptr_t base = reinterpret_cast<uintptr_t>(mbi.BaseAddress);
+		if (mbi.State == MEM_COMMIT) {
+			uintptr_t allocationBase = reinterpret_cast<uintptr_t>(mbi.AllocationBase);
+			snapshot->regions.push_back({ base, mbi.RegionSize, allocationBase, mbi.Protect, mbi.Type });
+
+			if (mbi.Type == MEM_MAPPED && !snapshot->mappedFiles.contains(allocationBase)) {
+				auto known = previous.mappedFiles.find(allocationBase);
+				if (known != previous.mappedFiles.end()) {
+					snapshot->mappedFiles.emplace(allocationBase, known->second);
+				}
+				else {
+					char path[MAX_PATH];
+					DWORD length = GetMappedFileNameA(handle, mbi.AllocationBase, path, sizeof(path));
+					// Pagefile backed sections have no file, they are remembered as such so they are not asked about again
+					snapshot->mappedFiles.emplace(allocationBase, std::string(path, length));
+				}
+			}
+		}
+
+		uintptr_t next = base + mbi.RegionSize;
+		if (next <= address) break; // Wrapped around the top of the address space
+		address = next;
+	}
+
+	return snapshot;
+}
+
+void RegionMap::UpdateFunction() {
+	auto& pm = IIR::ProcessManager::GetInstance();
+	HANDLE lastHandle = nullptr;
+	auto lastRefresh = std::chrono::steady_clock::time_point{};
+
+	while (this->running) {
+		auto handle = pm.GetHandle();
+		auto now = std::chrono::steady_clock::now();
+
+		if (handle != lastHandle) {
+			// Never let a pointer be classified against another process' address space
+			latest.store(std::make_shared<const RegionSnapshot>());
+			lastHandle = handle;
+			stale = true;
+		}
+
+		if (handle && (stale || now - lastRefresh >= refreshInterval)) {
+			stale = false;
+			latest.store(Walk(handle, *latest.load()));
+			lastRefresh = now;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+}
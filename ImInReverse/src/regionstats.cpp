@@ -0,0 +1,155 @@
+#include "pch.h"
+#include "iir/regionstats.h"
+#include "iir/process.h"
+
+#include <cmath>
+
+using namespace IIR;
+
+RegionStatsCollector& RegionStatsCollector::GetInstance() {
+	static RegionStatsCollector instance;
+	return instance;
+}
+
+RegionStatsCollector::RegionStatsCollector() = default;
+
+RegionStatsCollector::~RegionStatsCollector() {
+	this->running = false;
+	if (this->hUpdateThread.joinable()) {
+		this->hUpdateThread.join();
+	}
+}
+
+void RegionStatsCollector::Init() {
+	this->running = true;
+	this->hUpdateThread = std::thread(&RegionStatsCollector::UpdateFunction, this);
+}
+
+std::shared_ptr<const RegionStats> RegionStatsCollector::Get(const MemoryRegion& region) {
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = entries.find(region.base);
+	if (it != entries.end() && SameRegion(it->second.region, region)) {
+		if (it->second.stats) return it->second.stats;
+	}
+	else {
+		entries[region.base] = { region, nullptr };
+	}
+
+	// Asked again while still pending, e.g. because the request was dropped: it goes to the front of the line
+	pending.push_back(region);
+	if (pending.size() > maxPending) pending.pop_front();
+	return nullptr;
+}
+
+std::shared_ptr<const RegionStats> RegionStatsCollector::Measure(HANDLE handle, const MemoryRegion& region) {
+	constexpr uintptr_t pageSize = 0x1000;
+	// Working set entries asked about per call
+	constexpr size_t queryPages = 4096;
+
+	auto stats = std::make_shared<RegionStats>();
+
+	size_t pageCount = region.size / pageSize;
+	std::vector<uintptr_t> residentPages;
+	std::vector<PSAPI_WORKING_SET_EX_INFORMATION> info(std::min(pageCount, queryPages));
+	for (size_t first = 0; first < pageCount; first += queryPages) {
+		size_t count = std::min(queryPages, pageCount - first);
+		for (size_t i = 0; i < count; i++)
+			info[i].VirtualAddress = reinterpret_cast<PVOID>(region.base + (first + i) * pageSize);
+
+		if (!QueryWorkingSetEx(handle, info.data(), static_cast<DWORD>(count * sizeof(info[0])))) break;
+		for (size_t i = 0; i < count; i++)
+			if (info[i].VirtualAttributes.Valid) residentPages.push_back(region.base + (first + i) * pageSize);
+	}
+
+	stats->resident = residentPages.size() * pageSize;
+	if (!region.IsReadable() || residentPages.empty()) return stats;
+
+	// Large regions are sampled, every step'th resident page is read
+	size_t step = std::max<size_t>((residentPages.size() + maxSampledPages - 1) / maxSampledPages, 1);
+	std::array<uint64_t, 256> histogram{};
+	std::vector<uint8_t> page(pageSize);
+	size_t sampledPages = 0, zeroPages = 0;
+
+	for (size_t i = 0; i < residentPages.size(); i += step) {
+		SIZE_T sizeRead = 0;
+		if (!ReadProcessMemory(handle, reinterpret_cast<LPCVOID>(residentPages[i]), page.data(), page.size(), &sizeRead) || sizeRead != page.size()) continue;
+
+		uint64_t zerosBefore = histogram[0];
+		for (uint8_t byte : page) histogram[byte]++;
+		if (histogram[0] - zerosBefore == pageSize) zeroPages++;
+		sampledPages++;
+	}
+
+	stats->sampled = sampledPages * pageSize;
+	if (sampledPages == 0) return stats;
+
+	stats->zeroFraction = static_cast<float>(zeroPages) / sampledPages;
+	double total = static_cast<double>(stats->sampled), entropy = 0.0;
+	for (uint64_t count : histogram) {
+		if (count == 0) continue;
+		double p = count / total;
+		entropy -= p * std::log2(p);
+	}
+	stats->entropy = static_cast<float>(entropy);
+	return stats;
+}
+
+void RegionStatsCollector::Prune(const RegionSnapshot& regions) {
+	std::lock_guard<std::mutex> lock(mtx);
+	size_t dropped = std::erase_if(entries, [&](const auto& entry) {
+		const MemoryRegion* current = regions.Find(entry.first);
+		return !current || !SameRegion(*current, entry.second.region);
+	});
+	if (dropped) version.fetch_add(1, std::memory_order_release);
+}
+
+void RegionStatsCollector::UpdateFunction() {
+	auto& pm = IIR::ProcessManager::GetInstance();
+	HANDLE lastHandle = nullptr;
+	std::shared_ptr<const RegionSnapshot> lastRegions;
+
+	while (this->running) {
+		auto handle = pm.GetHandle();
+		if (handle != lastHandle) {
+			std::lock_guard<std::mutex> lock(mtx);
+			entries.clear();
+			pending.clear();
+			version.fetch_add(1, std::memory_order_release);
+			lastHandle = handle;
+		}
+
+		// Every walk is a new snapshot, whether or not anything in it changed
+		auto regions = RegionMap::GetInstance().Get();
+		if (regions != lastRegions) {
+			Prune(*regions);
+			lastRegions = regions;
+		}
+
+		std::optional<MemoryRegion> next;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			while (!pending.empty() && !next) {
+				MemoryRegion region = pending.back();
+				pending.pop_back();
+
+				// Skip requests that were measured already or are for a region that has changed since
+				auto it = entries.find(region.base);
+				if (it != entries.end() && !it->second.stats && SameRegion(it->second.region, region)) next = region;
+			}
+		}
+
+		if (!handle || !next) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			continue;
+		}
+
+		auto stats = Measure(handle, *next);
+
+		std::lock_guard<std::mutex> lock(mtx);
+		auto it = entries.find(next->base);
+		if (it != entries.end() && SameRegion(it->second.region, *next)) {
+			it->second.stats = std::move(stats);
+			version.fetch_add(1, std::memory_order_release);
+		}
+	}
+}
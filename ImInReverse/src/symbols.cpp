@@ -0,0 +1,367 @@
+#include "pch.h"
+#include "iir/symbols.h"
+#include "iir/mappedfile.h"
+#include "iir/process.h"
+
+#include <fstream>
+
+using namespace IIR;
+
+namespace {
+	char Lower(char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); }
+
+	bool EqualsIgnoringCase(std::string_view a, std::string_view b) {
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return Lower(x) == Lower(y); });
+	}
+
+	template <typename T>
+	const T* As(std::span<const uint8_t> bytes, size_t count = 1) {
+		return bytes.size() >= sizeof(T) * count ? reinterpret_cast<const T*>(bytes.data()) : nullptr;
+	}
+
+	/// <summary>
+	/// An image file mapped from disk, addressed by RVA. Sections are laid out differently on disk than in memory,
+	/// so every RVA goes through the section headers.
+	/// </summary>
+	class ImageFile {
+	public:
+		bool Open(const std::filesystem::path& path) {
+			std::error_code ec;
+			if (!std::filesystem::is_regular_file(path, ec)) return false;
+
+			file = MappedFile::Open(path);
+			if (!file || file->Size() < sizeof(IMAGE_DOS_HEADER)) return false;
+
+			auto dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(file->Data());
+			if (dos->e_magic != IMAGE_DOS_SIGNATURE || !file->Contains(dos->e_lfanew, sizeof(IMAGE_NT_HEADERS32))) return false;
+
+			auto nt = reinterpret_cast<const IMAGE_NT_HEADERS32*>(file->Data() + dos->e_lfanew);
+			if (nt->Signature != IMAGE_NT_SIGNATURE) return false;
+
+			uint64_t sectionsOffset = dos->e_lfanew + offsetof(IMAGE_NT_HEADERS32, OptionalHeader) + nt->FileHeader.SizeOfOptionalHeader;
+			uint32_t count = nt->FileHeader.NumberOfSections;
+			if (!file->Contains(sectionsOffset, uint64_t(count) * sizeof(IMAGE_SECTION_HEADER))) return false;
+			sections = std::span(reinterpret_cast<const IMAGE_SECTION_HEADER*>(file->Data() + sectionsOffset), count);
+
+			if (nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+				if (!file->Contains(dos->e_lfanew, sizeof(IMAGE_NT_HEADERS64))) return false;
+				exports = reinterpret_cast<const IMAGE_NT_HEADERS64*>(nt)->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+			}
+			else {
+				exports = nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+			}
+			return true;
+		}
+
+		std::span<const uint8_t> At(uint32_t rva) const {
+			for (const auto& section : sections) {
+				if (rva < section.VirtualAddress || rva - section.VirtualAddress >= section.SizeOfRawData) continue;
+
+				uint64_t offset = uint64_t(section.PointerToRawData) + (rva - section.VirtualAddress);
+				if (offset >= file->Size()) return {};
+				uint64_t available = std::min<uint64_t>(section.SizeOfRawData - (rva - section.VirtualAddress), file->Size() - offset);
+				return std::span(file->Data() + offset, static_cast<size_t>(available));
+			}
+			return {};
+		}
+
+		IMAGE_DATA_DIRECTORY exports{};
+
+	private:
+		std::shared_ptr<const MappedFile> file;
+		std::span<const IMAGE_SECTION_HEADER> sections;
+	};
+
+	/// Reads the export directory of the image mapped at `base` in the target, for images whose file cannot be opened.
+	std::shared_ptr<SymbolTable> ReadExportsFromMemory(HANDLE handle, uintptr_t base) {
+		auto read = [&](uintptr_t address, void* out, size_t size) {
+			SIZE_T sizeRead = 0;
+			return ReadProcessMemory(handle, reinterpret_cast<LPCVOID>(address), out, size, &sizeRead) && sizeRead == size;
+		};
+
+		IMAGE_DOS_HEADER dos;
+		IMAGE_NT_HEADERS64 nt;
+		if (!read(base, &dos, sizeof(dos)) || dos.e_magic != IMAGE_DOS_SIGNATURE) return nullptr;
+		if (!read(base + dos.e_lfanew, &nt, sizeof(nt)) || nt.Signature != IMAGE_NT_SIGNATURE) return nullptr;
+
+		IMAGE_DATA_DIRECTORY directory = nt.OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC ?
+			nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT] :
+			reinterpret_cast<const IMAGE_NT_HEADERS32&>(nt).OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+		if (directory.VirtualAddress == 0 || directory.Size == 0 || directory.Size > 64 * 1024 * 1024) return nullptr;
+
+		// The tables and the names live inside the directory's range, so one read gets all of them
+		std::vector<uint8_t> bytes(directory.Size);
+		if (!read(base + directory.VirtualAddress, bytes.data(), bytes.size())) return nullptr;
+
+		return SymbolTable::FromExports(directory.VirtualAddress, directory.Size, [&](uint32_t rva) -> std::span<const uint8_t> {
+			if (rva < directory.VirtualAddress || rva - directory.VirtualAddress >= bytes.size()) return {};
+			return std::span<const uint8_t>(bytes).subspan(rva - directory.VirtualAddress);
+		});
+	}
+}
+
+uint64_t SymbolTable::HashName(std::string_view name) {
+	// FNV-1a over the lowercase name, so names differing only in case land in the same chain
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (char c : name) {
+		hash ^= static_cast<uint8_t>(Lower(c));
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+std::shared_ptr<SymbolTable> SymbolTable::FromExports(uint32_t directoryRva, uint32_t directorySize,
+	const std::function<std::span<const uint8_t>(uint32_t rva)>& at) {
+	auto directory = As<IMAGE_EXPORT_DIRECTORY>(at(directoryRva));
+	if (!directory) return nullptr;
+
+	auto functions = As<DWORD>(at(directory->AddressOfFunctions), directory->NumberOfFunctions);
+	auto names = As<DWORD>(at(directory->AddressOfNames), directory->NumberOfNames);
+	auto ordinals = As<WORD>(at(directory->AddressOfNameOrdinals), directory->NumberOfNames);
+	if (!functions || !names || !ordinals) return nullptr;
+
+	auto table = std::make_shared<SymbolTable>();
+	table->symbols.reserve(directory->NumberOfNames);
+	for (DWORD i = 0; i < directory->NumberOfNames; i++) {
+		if (ordinals[i] >= directory->NumberOfFunctions) continue;
+
+		// Forwarders point back into the directory at a "dll.Function" string rather than at code
+		uint32_t rva = functions[ordinals[i]];
+		if (rva == 0 || (rva >= directoryRva && rva - directoryRva < directorySize)) continue;
+
+		auto name = at(names[i]);
+		size_t length = strnlen(reinterpret_cast<const char*>(name.data()), name.size());
+		if (length == 0 || length == name.size()) continue;
+
+		table->symbols.push_back({ rva, static_cast<uint32_t>(table->strings.size()), static_cast<uint32_t>(length) });
+		table->strings.insert(table->strings.end(), name.data(), name.data() + length);
+	}
+
+	table->Finish();
+	return table;
+}
+
+void SymbolTable::Finish() {
+	// Aliases share an address, keep the order stable so the same one labels it every time
+	std::stable_sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) { return a.rva < b.rva; });
+
+	size_t capacity = 16;
+	while (capacity < symbols.size() * 2) capacity *= 2;
+	slots.assign(capacity, emptySlot);
+
+	size_t mask = capacity - 1;
+	for (uint32_t i = 0; i < symbols.size(); i++) {
+		size_t slot = HashName(Name(symbols[i])) & mask;
+		while (slots[slot] != emptySlot) slot = (slot + 1) & mask;
+		slots[slot] = i;
+	}
+}
+
+const SymbolTable::Symbol* SymbolTable::Find(std::string_view name) const {
+	if (slots.empty()) return nullptr;
+
+	const Symbol* caseless = nullptr;
+	size_t mask = slots.size() - 1;
+	for (size_t slot = HashName(name) & mask; slots[slot] != emptySlot; slot = (slot + 1) & mask) {
+		const Symbol& symbol = symbols[slots[slot]];
+		std::string_view candidate = Name(symbol);
+		if (candidate == name) return &symbol;
+		if (!caseless && EqualsIgnoringCase(candidate, name)) caseless = &symbol;
+	}
+	return caseless;
+}
+
+namespace {
+	struct CacheHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t symbolCount;
+		uint64_t stringBytes;
+	};
+}
+
+std::shared_ptr<SymbolTable> SymbolTable::Load(const std::filesystem::path& path) {
+	std::error_code ec;
+	if (!std::filesystem::is_regular_file(path, ec)) return nullptr;
+
+	auto file = MappedFile::Open(path);
+	if (!file || !file->Contains(0, sizeof(CacheHeader))) return nullptr;
+
+	CacheHeader header;
+	std::memcpy(&header, file->Data(), sizeof(header));
+	if (header.magic != fileMagic || header.version != fileVersion) return nullptr;
+
+	uint64_t symbolBytes = header.symbolCount * sizeof(Symbol);
+	if (header.symbolCount > UINT32_MAX || !file->Contains(sizeof(header), symbolBytes) || !file->Contains(sizeof(header) + symbolBytes, header.stringBytes))
+		return nullptr;
+
+	auto table = std::make_shared<SymbolTable>();
+	table->symbols.resize(header.symbolCount);
+	std::memcpy(table->symbols.data(), file->Data() + sizeof(header), symbolBytes);
+	const char* strings = reinterpret_cast<const char*>(file->Data() + sizeof(header) + symbolBytes);
+	table->strings.assign(strings, strings + header.stringBytes);
+
+	for (const auto& symbol : table->symbols) {
+		if (uint64_t(symbol.nameOffset) + symbol.nameLength > header.stringBytes) return nullptr;
+	}
+
+	table->Finish();
+	return table;
+}
+
+bool SymbolTable::Save(const std::filesystem::path& path) const {
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+
+	// Write next to it and swap it in, two instances saving the same table never see half a file
+	auto temp = path;
+	temp += std::format(".{}.tmp", GetCurrentProcessId());
+	{
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		if (!out) return false;
+
+		CacheHeader header{ fileMagic, fileVersion, symbols.size(), strings.size() };
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(symbols.data()), static_cast<std::streamsize>(symbols.size() * sizeof(Symbol)));
+		out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+		if (!out) return false;
+	}
+
+	std::filesystem::rename(temp, path, ec);
+	if (ec) {
+		std::filesystem::remove(temp, ec);
+		return false;
+	}
+	return true;
+}
+
+SymbolIndex& SymbolIndex::GetInstance() {
+	static SymbolIndex instance;
+	return instance;
+}
+
+SymbolIndex::SymbolIndex() {
+	latest.store(std::make_shared<const SymbolSnapshot>());
+}
+
+SymbolIndex::~SymbolIndex() {
+	{
+		std::lock_guard<std::mutex> lock(wantedMtx);
+		this->running = false;
+	}
+	wantedChanged.notify_all();
+	if (this->hUpdateThread.joinable()) {
+		this->hUpdateThread.join();
+	}
+}
+
+void SymbolIndex::Init() {
+	this->running = true;
+	this->hUpdateThread = std::thread(&SymbolIndex::UpdateFunction, this);
+}
+
+void SymbolIndex::Want(const Module& module) {
+	{
+		std::lock_guard<std::mutex> lock(wantedMtx);
+		if (!requested.insert(SymbolSnapshot::Key(module)).second) return;
+		wanted.push_back(module);
+	}
+	wantedChanged.notify_one();
+}
+
+std::filesystem::path SymbolIndex::CachePath(const Module& module) {
+	std::error_code ec;
+	auto temp = std::filesystem::temp_directory_path(ec);
+	if (ec || module.buildId.empty()) return {};
+	return temp / "ImInReverse" / "symbols" / (module.buildId + ".syms");
+}
+
+std::shared_ptr<SymbolTable> SymbolIndex::LoadTable(const Module& module) {
+	auto cachePath = CachePath(module);
+	if (!cachePath.empty()) {
+		if (auto table = SymbolTable::Load(cachePath)) return table;
+	}
+
+	std::shared_ptr<SymbolTable> table;
+	ImageFile image;
+	if (image.Open(std::filesystem::path(module.path))) {
+		table = image.exports.VirtualAddress == 0 ? std::make_shared<SymbolTable>() :
+			SymbolTable::FromExports(image.exports.VirtualAddress, image.exports.Size, [&](uint32_t rva) { return image.At(rva); });
+	}
+	else if (HANDLE handle = ProcessManager::GetInstance().GetHandle()) {
+		table = ReadExportsFromMemory(handle, module.base);
+	}
+
+	// Images without exports are cached too, so they are not opened again next session
+	if (table && !cachePath.empty() && !table->Save(cachePath)) spdlog::warn("Failed to cache the symbols of {}", module.name);
+	return table;
+}
+
+void SymbolIndex::UpdateFunction() {
+	std::vector<Module> batch;
+
+	while (this->running) {
+		{
+			std::unique_lock<std::mutex> lock(wantedMtx);
+			wantedChanged.wait(lock, [this] { return !wanted.empty() || !running; });
+			if (!this->running) break;
+			batch.swap(wanted);
+		}
+
+		for (const auto& module : batch) {
+			auto table = LoadTable(module);
+			if (!table) {
+				spdlog::warn("Could not read the exports of {}", module.name);
+				table = std::make_shared<SymbolTable>();
+			}
+
+			auto current = latest.load();
+			auto next = std::make_shared<SymbolSnapshot>(*current);
+			next->version = current->version + 1;
+			next->tables[SymbolSnapshot::Key(module)] = std::move(table);
+			latest.store(std::move(next));
+		}
+		batch.clear();
+	}
+}
+
+std::optional<uintptr_t> IIR::ResolveName(const ModuleSnapshot& modules, const SymbolSnapshot& symbols, std::string_view name) {
+	size_t bang = name.find('!');
+	if (bang == std::string_view::npos) return modules.Resolve(name);
+
+	const Module* module = modules.FindByName(name.substr(0, bang));
+	if (!module) return std::nullopt;
+
+	const SymbolTable* table = symbols.Find(*module);
+	if (!table) {
+		SymbolIndex::GetInstance().Want(*module);
+		return std::nullopt;
+	}
+
+	const auto* symbol = table->Find(name.substr(bang + 1));
+	if (!symbol) return std::nullopt;
+	return module->base + symbol->rva;
+}
+
+int PointerLabels::Label(uintptr_t address, char* out, size_t outSize) const {
+	const Module* module = modules->Find(address);
+	if (!module || outSize == 0) return 0;
+
+	uintptr_t offset = address - module->base;
+	const SymbolTable* table = symbols->Find(*module);
+	if (!table) SymbolIndex::GetInstance().Want(*module);
+
+	int written = 0;
+	const SymbolTable::Symbol* symbol = table ? table->Nearest(static_cast<uint32_t>(offset)) : nullptr;
+	if (symbol && offset - symbol->rva < maxSymbolDistance) {
+		auto name = table->Name(*symbol);
+		uint32_t delta = static_cast<uint32_t>(offset - symbol->rva);
+		written = delta ?
+			snprintf(out, outSize, "%s!%.*s+0x%X", module->name.c_str(), static_cast<int>(name.size()), name.data(), delta) :
+			snprintf(out, outSize, "%s!%.*s", module->name.c_str(), static_cast<int>(name.size()), name.data());
+	}
+	else {
+		written = snprintf(out, outSize, "%s+0x%llX", module->name.c_str(), static_cast<unsigned long long>(offset));
+	}
+	return written < 0 ? 0 : std::min(written, static_cast<int>(outSize - 1));
+}
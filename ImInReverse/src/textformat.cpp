@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "iir/textformat.h"
+
+#include <array>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define IIR_TARGET_SSSE3
+#else
+#include <cpuid.h>
+#define IIR_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+using namespace IIR;
+
+namespace {
+	constexpr char hexDigits[] = "0123456789ABCDEF";
+
+	bool HasSsse3() {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		return info[2] & (1 << 9);
+#else
+		unsigned int eax, ebx, ecx, edx;
+		return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3);
+#endif
+	}
+
+	/// <summary>
+	/// Shuffle controls that spread 16 bytes of hex digit pairs (32 digits, split over two registers) into 48 characters
+	/// of "XX " groups, as three 16-byte stores. Lanes that take no digit are 0x80, which pshufb turns into zero.
+	/// </summary>
+	struct SpreadMasks {
+		alignas(16) std::array<std::array<uint8_t, 16>, 3> low{}; // Digits from the first 8 bytes.
+		alignas(16) std::array<std::array<uint8_t, 16>, 3> high{}; // Digits from the last 8 bytes.
+		alignas(16) std::array<std::array<uint8_t, 16>, 3> spaces{}; // ' ' where a group ends.
+	};
+
+	constexpr SpreadMasks MakeSpreadMasks() {
+		SpreadMasks masks;
+		for (int position = 0; position < 48; position++) {
+			int store = position / 16, lane = position % 16;
+			int byte = position / 3, column = position % 3;
+			int digit = byte * 2 + column;
+
+			masks.low[store][lane] = column != 2 && digit < 16 ? static_cast<uint8_t>(digit) : 0x80;
+			masks.high[store][lane] = column != 2 && digit >= 16 ? static_cast<uint8_t>(digit - 16) : 0x80;
+			masks.spaces[store][lane] = column == 2 ? ' ' : 0;
+		}
+		return masks;
+	}
+
+	constexpr SpreadMasks spreadMasks = MakeSpreadMasks();
+
+	size_t FormatHexBytesScalar(const uint8_t* data, size_t count, char* out) {
+		for (size_t i = 0; i < count; i++) {
+			out[i * 3] = hexDigits[data[i] >> 4];
+			out[i * 3 + 1] = hexDigits[data[i] & 0xF];
+			out[i * 3 + 2] = ' ';
+		}
+		return count * 3;
+	}
+
+	IIR_TARGET_SSSE3 size_t FormatHexBytesSsse3(const uint8_t* data, size_t count, char* out) {
+		const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hexDigits));
+		const __m128i nibble = _mm_set1_epi8(0x0F);
+		auto load = [](const std::array<uint8_t, 16>& mask) { return _mm_load_si128(reinterpret_cast<const __m128i*>(mask.data())); };
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			__m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+			__m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibble));
+
+			// Digit pairs in byte order, then spread out into groups of three
+			__m128i pairsLow = _mm_unpacklo_epi8(high, low);
+			__m128i pairsHigh = _mm_unpackhi_epi8(high, low);
+			for (int store = 0; store < 3; store++) {
+				__m128i text = _mm_or_si128(
+					_mm_or_si128(_mm_shuffle_epi8(pairsLow, load(spreadMasks.low[store])), _mm_shuffle_epi8(pairsHigh, load(spreadMasks.high[store]))),
+					load(spreadMasks.spaces[store]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 3 + store * 16), text);
+			}
+		}
+
+		return i * 3 + FormatHexBytesScalar(data + i, count - i, out + i * 3);
+	}
+}
+
+size_t IIR::FormatHexBytes(const uint8_t* data, size_t count, char* out) {
+	static const bool ssse3 = HasSsse3();
+	return ssse3 ? FormatHexBytesSsse3(data, count, out) : FormatHexBytesScalar(data, count, out);
+}
+
+size_t IIR::FormatAsciiBytes(const uint8_t* data, size_t count, char* out) {
+	// Printable is 0x20 to 0x7E. Compared as signed bytes, everything from 0x80 up is negative and fails the first test
+	const __m128i firstBelow = _mm_set1_epi8(0x1F);
+	const __m128i lastAbove = _mm_set1_epi8(0x7F);
+	const __m128i dot = _mm_set1_epi8('.');
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		__m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, firstBelow), _mm_cmplt_epi8(bytes, lastAbove));
+		__m128i text = _mm_or_si128(_mm_and_si128(printable, bytes), _mm_andnot_si128(printable, dot));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), text);
+	}
+
+	for (; i < count; i++) {
+		out[i] = data[i] >= 0x20 && data[i] <= 0x7E ? static_cast<char>(data[i]) : '.';
+	}
+	return count;
+}